@@ -0,0 +1,1174 @@
+// micro benchmarks for the hammercfg bench keyword, built by make bench in place of
+// the game's impl.c so game builds don't carry them
+#define HAMMER_ENGINE_IMPLEMENTATION
+#define HAMMER_BENCH
+#include "../hammer.h"
+
+typedef struct hed_bench_model hed_bench_model;
+
+// a frozen copy of hed_model as it was before hed_components, the baseline the entities
+// and collisions benchmarks measure against. it is a fixed historical layout on purpose,
+// don't keep it in step with hed_model or the baseline stops being the old engine
+struct hed_bench_model {
+	hed_asset *asset;
+
+	int currentAnimation;
+	int currentFrame;
+	float animTime;
+	bool animate;
+
+	BoundingBox box, transformedBox;
+	Vector3 center;
+
+	Vector3 position;
+	Vector3 origin;
+	float angle;
+	bool render;
+	bool visible;
+
+	Vector3 prevPosition;
+	float prevAngle;
+
+	const char *name;
+	u16 name_id;
+	u8 type;
+	u8 entity_type;
+	u16 id;
+	u16 batch;
+
+	Vector3 scale;
+	Color tint;
+};
+
+HE_DECL void		he_engine_bench_collisions(void);
+HE_DECL void		he_engine_bench_parse(void);
+HE_DECL void		he_engine_bench_entities(void);
+HE_DECL void		he_engine_bench_jobs(void);
+HE_DECL void		he_engine_bench_mark(void *, u32, u32);
+HE_DECL u64		he_engine_bench_frames(const Vector3 *, u32, u32);
+HE_DECL void		he_engine_bench_skinning(void);
+HE_DECL void		he_engine_bench_skin_raylib(Model, ModelAnimation, int);
+HE_DECL hed_asset *	he_engine_bench_asset(int, u32, u32);
+HE_DECL void		he_engine_bench_free_asset(hed_asset *);
+HE_DECL hed_asset *	he_engine_bench_box_asset(u32);
+HE_DECL hed_level *	he_engine_bench_level(hed_asset *, u32);
+HE_DECL void		he_engine_bench_free_level(hed_level *);
+HE_DECL void		he_engine_bench_animation(void);
+HE_DECL void		he_engine_bench_clips(void);
+HE_DECL void		he_engine_bench_pose_raw(const Model *, const ModelAnimation *, int, float, hed_bone_pose *);
+
+int
+main(void) {
+	return he_engine_run();
+}
+
+u8
+he_engine_run_bench(const char *name) {
+
+	const struct { const char *name; void (*run)(void); } benches[] = {
+		{ "collisions", he_engine_bench_collisions },
+		{ "parse", he_engine_bench_parse },
+		{ "entities", he_engine_bench_entities },
+		{ "jobs", he_engine_bench_jobs },
+		{ "skinning", he_engine_bench_skinning },
+		{ "animation", he_engine_bench_animation },
+		{ "clips", he_engine_bench_clips },
+	};
+
+	for(size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		if(strcmp(name, benches[i].name) == 0) {
+			printf("Running %s benchmark.\n", name);
+			benches[i].run();
+			return 0;
+		}
+	}
+
+	printf("Unknown benchmark '%s'.\n", name);
+	return 1;
+}
+
+void
+he_engine_bench_collisions(void) {
+
+	// random boxes in a 20 unit cube, under one percent of random pairs overlap.
+	// old path dereferences boxes inside models, new one reads level arrays.
+	const u32 count = 4096, pairs = 1 << 20, rounds = 8;
+
+	hed_bench_model *models = calloc(count, sizeof(hed_bench_model));
+	BoundingBox **one = malloc(pairs * sizeof(BoundingBox *));
+	BoundingBox **two = malloc(pairs * sizeof(BoundingBox *));
+	u32 *a = malloc(pairs * sizeof(u32));
+	u32 *b = malloc(pairs * sizeof(u32));
+	u8 *hits = malloc(pairs);
+	hed_boxes boxes;
+
+	if(models == NULL || one == NULL || two == NULL || a == NULL || b == NULL || hits == NULL ||
+	he_engine_alloc_boxes(&boxes, count)) {
+		printf("Out of memory for benchmark.\n");
+		free(models); free(one); free(two); free(a); free(b); free(hits);
+		return;
+	}
+
+	srand(1);
+
+	for(u32 i = 0; i < count; i++) {
+		Vector3 p = { rand() % 2000 / 100.0f, rand() % 2000 / 100.0f, rand() % 2000 / 100.0f };
+		Vector3 size = { 1.0f + rand() % 200 / 100.0f, 1.0f + rand() % 200 / 100.0f, 1.0f + rand() % 200 / 100.0f };
+
+		models[i].transformedBox.min = p;
+		models[i].transformedBox.max = Vector3Add(p, size);
+
+		boxes.min_x[i] = p.x; boxes.min_y[i] = p.y; boxes.min_z[i] = p.z;
+		boxes.max_x[i] = p.x + size.x; boxes.max_y[i] = p.y + size.y; boxes.max_z[i] = p.z + size.z;
+	}
+
+	for(u32 i = 0; i < pairs; i++) {
+		a[i] = rand() % count;
+		b[i] = rand() % count;
+		one[i] = &models[a[i]].transformedBox;
+		two[i] = &models[b[i]].transformedBox;
+	}
+
+	u32 old_hits = 0, new_hits = 0;
+
+	double start = he_engine_clock();
+	for(u32 r = 0; r < rounds; r++) {
+		for(u32 i = 0; i < pairs; i++) {
+			hits[i] = CheckCollisionBoxes(*one[i], *two[i]);
+		}
+
+		for(u32 i = 0; i < pairs; i++) {
+			old_hits += hits[i];
+		}
+	}
+	double old_time = he_engine_clock() - start;
+
+	start = he_engine_clock();
+	for(u32 r = 0; r < rounds; r++) {
+		he_engine_overlap_pairs(&boxes, a, b, pairs, hits);
+
+		for(u32 i = 0; i < pairs; i++) {
+			new_hits += hits[i];
+		}
+	}
+	double new_time = he_engine_clock() - start;
+
+	double total = (double)pairs * rounds;
+
+	printf("%u boxes, %u pairs x %u rounds, %u hits per round\n", count, pairs, rounds, old_hits / rounds);
+	printf("hed_model pointers:  %8.1f Mpairs/s\n", total / old_time / 1e6);
+	printf("soa kernel (%s): %8.1f Mpairs/s, %.2fx\n", HE_SIMD, total / new_time / 1e6, old_time / new_time);
+
+	if(old_hits != new_hits) {
+		printf("Kernel mismatch, %u hits against %u.\n", new_hits, old_hits);
+	}
+
+	free(models); free(one); free(two); free(a); free(b); free(hits);
+	free(boxes.min_x);
+}
+
+void
+he_engine_bench_parse(void) {
+
+	// generated cfg.logic the size of our big levels, 1000 entities,
+	// mostly POSITION lines with some collision rules in between
+	const u32 lines = 50000, entities = 1000, rounds = 5;
+
+	char path[] = "/tmp/hammer_parse_XXXXXX";
+	int fd = mkstemp(path);
+	FILE *fp = fd < 0 ? NULL : fdopen(fd, "w");
+	hed_level *level = calloc(1, sizeof(hed_level));
+
+	if(fp == NULL || level == NULL || he_arena_init(&level->arena, entities * sizeof(hed_model))) {
+		printf("Cannot set up parse benchmark.\n");
+		free(level);
+		return;
+	}
+
+	srand(1);
+	for(u32 i = 0; i < lines; i++) {
+		if(i % 250 == 0) {
+			fprintf(fp, "COLLISION_ENTER hero.glb e%u.glb PRINT entity %u touched\n", i % entities, i);
+		}
+
+		else {
+			fprintf(fp, "POSITION e%u.glb %.3f 0.0 %.3f\n", i % entities,
+			(float)rand() / RAND_MAX * 100.0f, (float)rand() / RAND_MAX * 100.0f);
+		}
+	}
+
+	fclose(fp);
+
+	char tmp[U6];
+
+	engine.current_level = level;
+	(void)he_engine_grow_entities(level, entities);
+	(void)he_engine_alloc_components(level, ENTITY + entities);
+
+	level->hero.name = "hero.glb";
+	level->map.name = "map.glb";
+
+	for(u32 i = 0; i < entities; i++) {
+		u32 len = snprintf(tmp, sizeof(tmp), "e%u.glb", i);
+		level->entities[i].name = he_arena_strdup(&level->arena, tmp, len);
+	}
+
+	level->entities_count = entities;
+	(void)he_engine_build_names(level);
+
+	struct stat source;
+	(void)stat(path, &source);
+
+	// what every parser did before, one fscanf per token
+	u32 old_tokens = 0, new_tokens = 0;
+
+	double start = he_engine_clock();
+	for(u32 r = 0; r < rounds; r++) {
+		fp = fopen(path, "r");
+
+		while(fp != NULL && fscanf(fp, "%60s", tmp) == 1) {
+			old_tokens++;
+		}
+
+		if(fp != NULL) {
+			fclose(fp);
+		}
+	}
+	double old_time = he_engine_clock() - start;
+
+	start = he_engine_clock();
+	for(u32 r = 0; r < rounds; r++) {
+		hed_lexer lex;
+		hed_token tok;
+
+		if(he_lex_open(&lex, path) == 0) {
+			while(he_lex_next(&lex, &tok)) {
+				new_tokens++;
+			}
+
+			he_lex_close(&lex);
+		}
+	}
+	double new_time = he_engine_clock() - start;
+
+	// whole logic parse, model lookups included
+	u8 failed = 0;
+
+	start = he_engine_clock();
+	for(u32 r = 0; r < rounds && !failed; r++) {
+		level->col_count = 0;
+		level->col_wildcards = 0;
+		level->program.count = 0;
+		level->program.strings_size = 0;
+		level->program.number_count = 0;
+		failed = he_engine_parse_logic(level, path);
+	}
+	double parse_time = he_engine_clock() - start;
+
+	// name lookups alone, strcmp over every model as before against the name table
+	u32 linear_found = 0, hashed_found = 0;
+
+	start = he_engine_clock();
+	for(u32 i = 0; i < lines; i++) {
+		const char *name = level->entities[(i * 7919) % entities].name;
+
+		for(u32 j = 0; j < entities; j++) {
+			if(strcmp(name, level->entities[j].name) == 0) {
+				linear_found++;
+				break;
+			}
+		}
+	}
+	double linear_time = he_engine_clock() - start;
+
+	start = he_engine_clock();
+	for(u32 i = 0; i < lines; i++) {
+		const char *name = level->entities[(i * 7919) % entities].name;
+		hashed_found += he_engine_check_model(level, name, strlen(name)) >= 0;
+	}
+	double hashed_time = he_engine_clock() - start;
+
+	double mb = (double)source.st_size * rounds / (1024.0 * 1024.0);
+
+	printf("%u lines, %.1f MB, %u tokens, %u rounds\n", lines,
+	(double)source.st_size / (1024.0 * 1024.0), old_tokens / rounds, rounds);
+	printf("fscanf tokens:  %8.1f MB/s\n", mb / old_time);
+	printf("lexer tokens:   %8.1f MB/s, %.2fx\n", mb / new_time, old_time / new_time);
+	printf("cfg.logic parse: %7.2f ms per file, %u rules\n", parse_time / rounds * 1000.0, level->col_count);
+	printf("%u name lookups, %u models: strcmp scan %.2f ms, name table %.2f ms, %.0fx\n", lines, entities,
+	linear_time * 1000.0, hashed_time * 1000.0, linear_time / hashed_time);
+
+	if(old_tokens != new_tokens || failed || linear_found != hashed_found) {
+		printf("Benchmark mismatch, %u tokens against %u.\n", new_tokens, old_tokens);
+	}
+
+	he_arena_free(&level->arena);
+	engine.current_level = NULL;
+	free(level);
+	(void)unlink(path);
+}
+
+void
+he_engine_bench_entities(void) {
+
+	// 10k static entities with a share of them moving and animated each tick,
+	// the old hed_model array against component arrays with dirty flags
+	const u32 count = 10000, ticks = 600;
+	const float dt = 1.0f / TICKRATE;
+
+	hed_bench_model *models = calloc(count, sizeof(hed_bench_model));
+	hed_asset *asset = he_engine_bench_box_asset(60);
+	hed_level *level = he_engine_bench_level(asset, count);
+	hed_boxes old_boxes = { 0 };
+
+	if(models == NULL || level == NULL || he_engine_alloc_boxes(&old_boxes, count)) {
+		printf("Cannot set up entities benchmark.\n");
+		he_engine_bench_free_level(level);
+		he_engine_bench_free_asset(asset);
+		free(models);
+		return;
+	}
+
+	hed_components *components = &level->components;
+
+	srand(1);
+	for(u32 i = 0; i < count; i++) {
+		Vector3 p = { rand() % 10000 / 100.0f, 0.0f, rand() % 10000 / 100.0f };
+		bool animate = i % 10 == 0;
+
+		models[i] = (hed_bench_model) {
+			.asset = asset, .animate = animate, .box = asset->box, .position = p,
+			.render = true, .visible = true, .type = ENTITY, .id = i, .batch = NO_BATCH,
+			.scale = { 1.0f, 1.0f, 1.0f }, .tint = WHITE
+		};
+
+		// only every tenth one plays its clip
+		if(!animate) {
+			components->flags[ENTITY + i] &= ~MODEL_ANIMATE;
+		}
+
+		he_engine_place_model(level, ENTITY + i, p);
+	}
+
+	const float shares[] = { 0.01f, 1.0f };
+
+	for(u8 s = 0; s < 2; s++) {
+		u32 moving = count * shares[s];
+		bool grid_dirty = false; // what the old pass worked out for the broad phase
+
+		// old tick, every phase walks the whole hed_model array
+		double start = he_engine_clock();
+		for(u32 t = 0; t < ticks; t++) {
+			for(u32 i = 0; i < count; i++) {
+				models[i].prevPosition = models[i].position;
+				models[i].prevAngle = models[i].angle;
+			}
+
+			for(u32 k = 0; k < moving; k++) {
+				models[(t * moving + k) % count].position.x += 0.01f;
+			}
+
+			for(u32 i = 0; i < count; i++) {
+				hed_bench_model *model = &models[i];
+
+				if(model->render && model->visible && model->animate) {
+					int frames = model->asset->animations[model->currentAnimation].frameCount;
+					float duration = frames / (float)ANIM_FPS;
+
+					model->animTime += dt;
+
+					if(model->animTime >= duration) {
+						model->animTime = fmodf(model->animTime, duration);
+					}
+
+					model->currentFrame = (int)(model->animTime * ANIM_FPS) < frames ?
+					(int)(model->animTime * ANIM_FPS) : frames - 1;
+				}
+			}
+
+			for(u32 i = 0; i < count; i++) {
+				hed_bench_model *model = &models[i];
+
+				if(!model->render) {
+					continue;
+				}
+
+				Vector3 min = Vector3Add(model->box.min, model->position);
+				grid_dirty |= min.x != model->transformedBox.min.x ||
+				min.y != model->transformedBox.min.y || min.z != model->transformedBox.min.z;
+
+				model->transformedBox.min = min;
+				model->transformedBox.max = Vector3Add(model->box.max, model->position);
+
+				old_boxes.min_x[i] = model->transformedBox.min.x;
+				old_boxes.min_y[i] = model->transformedBox.min.y;
+				old_boxes.min_z[i] = model->transformedBox.min.z;
+				old_boxes.max_x[i] = model->transformedBox.max.x;
+				old_boxes.max_y[i] = model->transformedBox.max.y;
+				old_boxes.max_z[i] = model->transformedBox.max.z;
+			}
+		}
+		double old_time = he_engine_clock() - start;
+
+		// same ticks through the engine passes
+		start = he_engine_clock();
+		for(u32 t = 0; t < ticks; t++) {
+			he_engine_store_transforms();
+
+			for(u32 k = 0; k < moving; k++) {
+				u16 id = ENTITY + (t * moving + k) % count;
+				Vector3 p = components->position[id];
+				p.x += 0.01f;
+				he_engine_place_model(level, id, p);
+			}
+
+			he_engine_update_animations(dt);
+			he_engine_update_bounds();
+		}
+		double new_time = he_engine_clock() - start;
+
+		u32 mismatch = 0;
+		for(u32 i = 0; i < count; i++) {
+			mismatch += models[i].transformedBox.min.x != components->world[ENTITY + i].min.x ||
+			models[i].currentFrame != components->frame[ENTITY + i];
+		}
+
+		printf("%u entities, %.0f%% moving, %u ticks\n", count, shares[s] * 100.0f, ticks);
+		printf("hed_model array: %7.3f ms per tick\n", old_time / ticks * 1000.0);
+		printf("components:      %7.3f ms per tick, %.2fx\n", new_time / ticks * 1000.0, old_time / new_time);
+
+		if(mismatch > 0 || !grid_dirty) {
+			printf("Benchmark mismatch, %u entities differ.\n", mismatch);
+		}
+	}
+
+	printf("state per entity: hed_model %zu bytes in one struct, components %zu bytes over 14 arrays\n", sizeof(hed_bench_model),
+	3 * sizeof(Vector3) + 4 * sizeof(float) + 2 * sizeof(BoundingBox) + 3 * sizeof(int) + 2);
+
+	he_engine_bench_free_level(level);
+	he_engine_bench_free_asset(asset);
+	free(old_boxes.min_x);
+	free(models);
+}
+
+void
+he_engine_bench_jobs(void) {
+
+	// 60k animated entities all moving, each frame runs animation, bounds, culling
+	// and 1M pair tests through the job graph, the same frames for every thread count
+	const u32 count = 60000, pairs = 1 << 20, frames = 60;
+	const u32 threads[] = { 1, 2, 4, 8, 16 };
+
+	hed_asset *asset = he_engine_bench_box_asset(60);
+	hed_level *level = he_engine_bench_level(asset, count);
+	Vector3 *start = malloc(count * sizeof(Vector3));
+	u32 *a = malloc(pairs * sizeof(u32));
+	u32 *b = malloc(pairs * sizeof(u32));
+	u8 *hits = malloc(pairs);
+
+	if(level == NULL || start == NULL || a == NULL || b == NULL || hits == NULL) {
+		printf("Cannot set up jobs benchmark.\n");
+		he_engine_bench_free_level(level);
+		he_engine_bench_free_asset(asset);
+		free(start); free(a); free(b); free(hits);
+		return;
+	}
+
+	srand(1);
+	for(u32 i = 0; i < count; i++) {
+		start[i] = (Vector3) { rand() % 20000 / 100.0f, 0.0f, rand() % 20000 / 100.0f };
+	}
+
+	for(u32 i = 0; i < pairs; i++) {
+		a[i] = ENTITY + rand() % count;
+		b[i] = ENTITY + rand() % count;
+	}
+
+	level->pairs = (hed_pairs) { .a = a, .b = b, .hits = hits, .count = pairs, .capacity = pairs };
+
+	// camera sees the x < 100 half of the field
+	engine.frustum.planes[0] = (Vector4) { 1.0f, 0.0f, 0.0f, 0.0f };
+	engine.frustum.planes[1] = (Vector4) { -1.0f, 0.0f, 0.0f, 100.0f };
+	engine.frustum.planes[2] = (Vector4) { 0.0f, 1.0f, 0.0f, 100.0f };
+	engine.frustum.planes[3] = (Vector4) { 0.0f, -1.0f, 0.0f, 100.0f };
+	engine.frustum.planes[4] = (Vector4) { 0.0f, 0.0f, 1.0f, 100.0f };
+	engine.frustum.planes[5] = (Vector4) { 0.0f, 0.0f, -1.0f, 300.0f };
+	engine.timestep.alpha = 1.0f;
+
+	double base = 0.0;
+	u64 expected = 0;
+	u8 failed = 0;
+
+	printf("%u entities animated and moving, %u pairs, %u frames, %ld cores online\n", count, pairs, frames,
+	sysconf(_SC_NPROCESSORS_ONLN));
+
+	for(u8 t = 0; t < sizeof(threads) / sizeof(threads[0]) && !failed; t++) {
+		he_jobs_shutdown();
+
+		if(he_jobs_init(threads[t])) {
+			failed = true;
+			break;
+		}
+
+		double time = he_engine_clock();
+		u64 sum = he_engine_bench_frames(start, count, frames);
+		time = he_engine_clock() - time;
+
+		if(t == 0) {
+			base = time;
+			expected = sum;
+		}
+
+		u32 stolen = 0;
+		for(u32 w = 0; w < engine.jobs.count; w++) {
+			stolen += engine.jobs.workers[w].stolen;
+		}
+
+		printf("%2u threads: %7.3f ms per frame, %.2fx, %u jobs stolen\n", engine.jobs.count,
+		time / frames * 1000.0, base / time, stolen);
+
+		if(sum != expected) {
+			printf("Benchmark mismatch, %u threads ended in a different state.\n", engine.jobs.count);
+		}
+
+		// a grain far too small for the ring, every item still has to run once
+		(void)memset(hits, 0, JOB_QUEUE * 8);
+		he_jobs_for(he_engine_bench_mark, hits, JOB_QUEUE * 8, 1);
+
+		u32 missed = 0;
+		for(u32 i = 0; i < JOB_QUEUE * 8; i++) {
+			missed += hits[i] != 1;
+		}
+
+		if(missed > 0) {
+			printf("Benchmark mismatch, %u threads ran %u of %u single item ranges other than once.\n",
+			engine.jobs.count, missed, JOB_QUEUE * 8);
+		}
+	}
+
+	if(failed) {
+		printf("Cannot set up jobs benchmark.\n");
+	}
+
+	// back to the pool hammercfg asked for
+	he_jobs_shutdown();
+	(void)he_jobs_init(engine.threads);
+
+	he_engine_bench_free_level(level);
+	he_engine_bench_free_asset(asset);
+	free(start); free(a); free(b); free(hits);
+}
+
+void
+he_engine_bench_mark(void *arg, u32 first, u32 count) {
+
+	u8 *marks = arg;
+
+	for(u32 i = first; i < first + count; i++) {
+		__atomic_add_fetch(&marks[i], 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+u64
+he_engine_bench_frames(const Vector3 *start, u32 count, u32 frames) {
+
+	hed_level *level = engine.current_level;
+	hed_components *components = &level->components;
+	const float dt = 1.0f / TICKRATE;
+
+	for(u32 i = 0; i < count; i++) {
+		u16 id = ENTITY + i;
+		components->position[id] = components->prev_position[id] = start[i];
+		components->frame[id] = 0;
+		components->clip_time[id] = 0.0f;
+		components->anim_lod[id] = 0;
+		components->flags[id] |= MODEL_VISIBLE | MODEL_DIRTY;
+	}
+
+	u64 sum = 0;
+
+	for(u32 f = 0; f < frames; f++) {
+		he_engine_store_transforms();
+
+		for(u32 i = 0; i < count; i++) {
+			Vector3 p = components->position[ENTITY + i];
+			p.x += 0.5f;
+			he_engine_place_model(level, ENTITY + i, p);
+		}
+
+		// bounds rewrite the flags culling reads, pair tests read the boxes
+		hed_job *animate = he_jobs_create(he_engine_animate_range, (void *)&dt, components->count, JOB_GRAIN);
+		hed_job *bounds = he_jobs_create(he_engine_bounds_range, NULL, components->count, JOB_GRAIN);
+		hed_job *cull = he_jobs_create(he_engine_cull_range, NULL, components->count, JOB_GRAIN);
+		hed_job *overlap = he_jobs_create(he_engine_overlap_range, level, level->pairs.count, JOB_PAIR_GRAIN);
+
+		he_jobs_depend(bounds, animate);
+		he_jobs_depend(cull, bounds);
+		he_jobs_depend(overlap, bounds);
+
+		he_jobs_submit(overlap);
+		he_jobs_submit(cull);
+		he_jobs_submit(bounds);
+		he_jobs_submit(animate);
+
+		he_jobs_wait(cull);
+		he_jobs_wait(overlap);
+
+		for(u32 i = 0; i < level->pairs.count; i++) {
+			sum += level->pairs.hits[i];
+		}
+	}
+
+	for(u32 i = 0; i < count; i++) {
+		u16 id = ENTITY + i;
+		sum = sum * 31 + (u64)components->frame[id] + (components->flags[id] & MODEL_VISIBLE) +
+		(u64)(components->world[id].min.x * 100.0f);
+	}
+
+	return sum;
+}
+
+void
+he_engine_bench_skinning(void) {
+
+	// animated models sharing one skinned mesh with 32 bones, every model on its own frame.
+	// old path skins the shared mesh on the render thread right before each draw like
+	// UpdateModelAnimation, the skin pass does every model at once on the job threads
+	const u32 models = 64, bones = 32, frames = 30, rounds = 10;
+	const int vertex_counts[] = { 2000, 10000 };
+	const u32 threads[] = { 1, 2, 4, 8, 16 };
+
+	for(u8 c = 0; c < sizeof(vertex_counts) / sizeof(vertex_counts[0]); c++) {
+		int vertices = vertex_counts[c];
+
+		hed_asset *asset = he_engine_bench_asset(vertices, bones, frames);
+		hed_level *level = he_engine_bench_level(asset, models);
+
+		if(level == NULL) {
+			printf("Cannot set up skinning benchmark.\n");
+		}
+
+		else {
+			hed_components *components = &level->components;
+			ModelAnimation *animation = asset->animations;
+			Mesh *mesh = asset->model.meshes;
+			double total = (double)models * vertices * rounds;
+
+			printf("%u models, %d vertices each, %u bones, %u rounds, %ld cores online\n", models, vertices,
+			bones, rounds, sysconf(_SC_NPROCESSORS_ONLN));
+
+			// shared mesh skinned per model on the render thread
+			double start = he_engine_clock();
+			for(u32 r = 0; r < rounds; r++) {
+				for(u32 i = 0; i < models; i++) {
+					he_engine_bench_skin_raylib(asset->model, *animation, (r + i) % frames);
+				}
+			}
+			double old_time = he_engine_clock() - start;
+
+			printf("UpdateModelAnimation per draw: %8.3f ms per frame, %6.1f Mvertices/s\n",
+			old_time / rounds * 1000.0, total / old_time / 1e6);
+
+			for(u8 t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+				he_jobs_shutdown();
+
+				if(he_jobs_init(threads[t])) {
+					break;
+				}
+
+				start = he_engine_clock();
+				for(u32 r = 0; r < rounds; r++) {
+					for(u32 i = 0; i < models; i++) {
+						components->frame[ENTITY + i] = (r + i) % frames;
+					}
+
+					he_engine_skin_models();
+				}
+				double time = he_engine_clock() - start;
+
+				printf("skin pass, %2u threads:       %8.3f ms per frame, %6.1f Mvertices/s, %.2fx\n",
+				engine.jobs.count, time / rounds * 1000.0, total / time / 1e6, old_time / time);
+			}
+
+			// last model of the last round is what the old path left in the shared mesh
+			const float *skinned = components->skin[ENTITY + models - 1].vertices;
+			u32 mismatch = 0;
+
+			for(int k = 0; k < vertices * 3; k++) {
+				mismatch += fabsf(skinned[k] - mesh->animVertices[k]) > 1e-3f ||
+				fabsf(skinned[vertices * 3 + k] - mesh->animNormals[k]) > 1e-3f;
+			}
+
+			// poses from the bake, models spread over the clip's 30 frames and then all of them in lockstep
+			he_jobs_shutdown();
+			(void)he_jobs_init(engine.threads);
+
+			asset->pose_cap = POSE_CACHE_KB * 1024;
+			he_engine_bake_clip(asset, 0);
+
+			for(u8 lockstep = 0; lockstep < 2 && asset->clips[0].poses != NULL; lockstep++) {
+				start = he_engine_clock();
+				for(u32 r = 0; r < rounds; r++) {
+					for(u32 i = 0; i < models; i++) {
+						components->frame[ENTITY + i] = lockstep ? r % frames : (r + i) % frames;
+					}
+
+					he_engine_skin_models();
+				}
+				double time = he_engine_clock() - start;
+
+				printf("skin pass, baked, %s %2u threads: %8.3f ms per frame, %.2fx\n", lockstep ? "lockstep," : "         ",
+				engine.jobs.count, time / rounds * 1000.0, old_time / time);
+			}
+
+			he_engine_bench_skin_raylib(asset->model, *animation, (rounds - 1) % frames);
+			skinned = components->skin[ENTITY + models - 1].drawn;
+
+			for(int k = 0; k < vertices * 3 && skinned != NULL; k++) {
+				mismatch += fabsf(skinned[k] - mesh->animVertices[k]) > 1e-3f;
+			}
+
+			if(mismatch > 0 || skinned == NULL) {
+				printf("Benchmark mismatch, %u skinned values differ.\n", mismatch);
+			}
+		}
+
+		he_engine_bench_free_level(level);
+		he_engine_bench_free_asset(asset);
+	}
+
+	// back to the pool hammercfg asked for
+	he_jobs_shutdown();
+	(void)he_jobs_init(engine.threads);
+}
+
+void
+he_engine_bench_animation(void) {
+
+	// a crowd spread over a 300 x 300 field with the camera at one corner looking at half of it,
+	// every tick culls, steps animations and skins like a rendered frame, with LOD and without
+	const u32 models = 1000, bones = 32, frames = 48, ticks = 120;
+	const int vertices = 2000;
+	const float dt = 1.0f / TICKRATE;
+
+	hed_asset *asset = he_engine_bench_asset(vertices, bones, frames);
+	float *rate = malloc(sizeof(float));
+
+	if(asset != NULL && rate != NULL) {
+		// a clip slower than the tickrate, ticks land between keyframes
+		*rate = 24.0f;
+		asset->clip_rate = rate;
+		rate = NULL;
+	}
+
+	hed_level *level = asset != NULL && asset->clip_rate != NULL ? he_engine_bench_level(asset, models) : NULL;
+
+	if(level == NULL) {
+		printf("Cannot set up animation benchmark.\n");
+	}
+
+	else {
+		hed_components *components = &level->components;
+
+		for(u32 i = 0; i < models; i++) {
+			he_engine_place_model(level, ENTITY + i, (Vector3) { rand() % 30000 / 100.0f, 0.0f, rand() % 30000 / 100.0f });
+		}
+
+		he_engine_store_transforms();
+
+		engine.camera.position = (Vector3) { 0.0f, 2.0f, 0.0f };
+		engine.frustum.planes[0] = (Vector4) { 1.0f, 0.0f, 0.0f, 0.0f };
+		engine.frustum.planes[1] = (Vector4) { -1.0f, 0.0f, 0.0f, 150.0f };
+		engine.frustum.planes[2] = (Vector4) { 0.0f, 1.0f, 0.0f, 100.0f };
+		engine.frustum.planes[3] = (Vector4) { 0.0f, -1.0f, 0.0f, 100.0f };
+		engine.frustum.planes[4] = (Vector4) { 0.0f, 0.0f, 1.0f, 0.0f };
+		engine.frustum.planes[5] = (Vector4) { 0.0f, 0.0f, -1.0f, 300.0f };
+		engine.timestep.alpha = 1.0f;
+
+		printf("%u models of %d vertices, %u bones, clip of %u frames at %.0f fps, %u ticks\n", models, vertices,
+		bones, frames, asset->clip_rate[0], ticks);
+
+		double base = 0.0;
+
+		for(u8 lod = 0; lod < 2; lod++) {
+			u32 stepped = 0, skinned = 0;
+
+			for(u32 i = 0; i < models; i++) {
+				components->clip_time[ENTITY + i] = 0.0f;
+				components->frame[ENTITY + i] = 0;
+				components->skin[ENTITY + i].clip = -1;
+			}
+
+			double start = he_engine_clock();
+			for(u32 t = 0; t < ticks; t++) {
+				engine.timestep.ticks = t;
+
+				he_engine_cull_models();
+
+				if(!lod) {
+					(void)memset(components->anim_lod, 0, components->count);
+				}
+
+				for(u32 i = 0; i < models; i++) {
+					stepped += (components->flags[ENTITY + i] & MODEL_VISIBLE) &&
+					((t + ENTITY + i) & ((1u << components->anim_lod[ENTITY + i]) - 1)) == 0;
+				}
+
+				he_engine_update_animations(dt);
+				he_engine_skin_models();
+				skinned += components->skinning_count;
+			}
+			double time = he_engine_clock() - start;
+
+			if(lod == 0) {
+				base = time;
+			}
+
+			printf("%s %7.3f ms per tick, %6.1f models stepped and %6.1f skinned per tick, %.2fx\n",
+			lod ? "animation LOD:" : "full rate:    ", time / ticks * 1000.0, stepped / (float)ticks,
+			skinned / (float)ticks, base / time);
+		}
+	}
+
+	he_engine_bench_free_level(level);
+	he_engine_bench_free_asset(asset);
+	engine.timestep.ticks = 0;
+	free(rate);
+}
+
+void
+he_engine_bench_clips(void) {
+
+	// a walk-like clip, every bone swings on a sine of its own and every third one holds still
+	// like fingers and face bones mostly do, compressed clip against the frame poses it came from
+	const u32 bones = 60, frames = 600, rounds = 3000;
+	hed_asset *asset = he_engine_bench_asset(1, bones, frames);
+	hed_bone_pose *pose = malloc(bones * sizeof(hed_bone_pose));
+
+	if(asset == NULL || pose == NULL) {
+		printf("Cannot set up clips benchmark.\n");
+		he_engine_bench_free_asset(asset);
+		free(pose);
+		return;
+	}
+
+	ModelAnimation *animation = asset->animations;
+
+	for(u32 f = 0; f < frames; f++) {
+		for(u32 b = 0; b < bones; b++) {
+			float t = f / 60.0f, phase = b * 0.37f, swing = 0.0f, sway = 0.0f;
+
+			if(b % 3 != 2) {
+				swing = 0.6f * sinf(t * 2.0f * PI * (0.5f + b % 5 * 0.25f) + phase);
+				sway = 0.05f * sinf(t * PI + phase);
+			}
+
+			animation->framePoses[f][b] = (Transform) { { sway, b / (float)bones, 0.0f },
+				QuaternionFromAxisAngle((Vector3) { 1.0f, b % 2 ? 0.3f : -0.2f, 0.1f }, swing), { 1.0f, 1.0f, 1.0f } };
+		}
+	}
+
+	he_engine_free_clips(asset);
+	asset->raw_bytes = asset->clip_bytes = 0;
+
+	if(he_engine_compress_clips(asset)) {
+		printf("Cannot compress the benchmark clip.\n");
+		he_engine_bench_free_asset(asset);
+		free(pose);
+		return;
+	}
+
+	hed_clip *clip = &asset->clips[0];
+	float translation = 0.0f, rotation = 0.0f;
+
+	for(u32 f = 0; f < frames; f++) {
+		for(u32 b = 0; b < bones; b++) {
+			Transform raw = animation->framePoses[f][b];
+			Transform at = he_clip_sample(clip, b, f, 0.0f);
+			const float *x = &raw.rotation.x, *y = &at.rotation.x;
+			float error = 0.0f, flipped = 0.0f;
+
+			for(int i = 0; i < 4; i++) {
+				error = fmaxf(error, fabsf(x[i] - y[i]));
+				flipped = fmaxf(flipped, fabsf(x[i] + y[i]));
+			}
+
+			rotation = fmaxf(rotation, fminf(error, flipped));
+			translation = fmaxf(translation, Vector3Distance(raw.translation, at.translation));
+		}
+	}
+
+	printf("%u bones, %u frames, %.1f KB of frame poses, %.1f KB compressed, %.1fx\n", bones, frames,
+	asset->raw_bytes / 1024.0, asset->clip_bytes / 1024.0, (double)asset->raw_bytes / asset->clip_bytes);
+	printf("%u of %u keys kept, max error %.5f translation, %.5f rotation\n", clip->keys, frames * bones * 3,
+	translation, rotation);
+
+	double base = 0.0;
+
+	for(u8 compressed = 0; compressed < 2; compressed++) {
+		double start = he_engine_clock();
+		for(u32 r = 0; r < rounds; r++) {
+			if(compressed) {
+				he_engine_pose_bones(&asset->model, clip, r % frames, 0.5f, pose);
+			}
+
+			else {
+				he_engine_bench_pose_raw(&asset->model, animation, r % frames, 0.5f, pose);
+			}
+		}
+		double time = he_engine_clock() - start;
+
+		if(!compressed) {
+			base = time;
+		}
+
+		printf("%s %7.3f us per pose, %.2fx\n", compressed ? "compressed clip:" : "frame poses:    ",
+		time / rounds * 1e6, base / time);
+	}
+
+	he_engine_bench_free_asset(asset);
+	free(pose);
+}
+
+void
+he_engine_bench_pose_raw(const Model *model, const ModelAnimation *anim, int frame, float blend, hed_bone_pose *bones) {
+
+	// posing straight from the frame poses LoadModelAnimations keeps
+	const Transform *pose = anim->framePoses[frame % anim->frameCount];
+	const Transform *next = anim->framePoses[(frame + 1) % anim->frameCount];
+
+	for(int b = 0; b < model->boneCount; b++) {
+		Transform at = {
+			Vector3Lerp(pose[b].translation, next[b].translation, blend),
+			QuaternionSlerp(pose[b].rotation, next[b].rotation, blend),
+			Vector3Lerp(pose[b].scale, next[b].scale, blend)
+		};
+
+		bones[b] = he_engine_bone_pose(model->bindPose[b], at);
+	}
+}
+
+hed_asset *
+he_engine_bench_asset(int vertices, u32 bones, u32 frames) {
+
+	// one skinned mesh, every vertex on one to four of the bones, a clip of random poses
+	hed_asset *asset = calloc(1, sizeof(hed_asset));
+	Mesh *mesh = calloc(1, sizeof(Mesh));
+	ModelAnimation *animation = calloc(1, sizeof(ModelAnimation));
+	Transform *bind = calloc(bones, sizeof(Transform));
+	Transform **poses = calloc(frames, sizeof(Transform *));
+	Transform *pose_data = calloc(frames * bones, sizeof(Transform));
+
+	if(asset == NULL || mesh == NULL || animation == NULL || bind == NULL || poses == NULL || pose_data == NULL) {
+		free(asset); free(mesh); free(animation); free(bind); free(poses); free(pose_data);
+		return NULL;
+	}
+
+	mesh->vertexCount = vertices;
+	mesh->vertices = malloc(vertices * 3 * sizeof(float));
+	mesh->normals = malloc(vertices * 3 * sizeof(float));
+	mesh->animVertices = malloc(vertices * 3 * sizeof(float));
+	mesh->animNormals = malloc(vertices * 3 * sizeof(float));
+	mesh->boneIds = malloc(vertices * 4);
+	mesh->boneWeights = malloc(vertices * 4 * sizeof(float));
+
+	animation->boneCount = bones;
+	animation->frameCount = frames;
+	animation->framePoses = poses;
+
+	asset->model = (Model) { .transform = MatrixIdentity(), .meshCount = 1, .meshes = mesh,
+		.boneCount = bones, .bindPose = bind };
+	asset->animations = animation;
+	asset->animCount = 1;
+	(void)snprintf(asset->path, sizeof(asset->path), "bench.glb");
+
+	if(mesh->vertices == NULL || mesh->normals == NULL || mesh->animVertices == NULL ||
+	mesh->animNormals == NULL || mesh->boneIds == NULL || mesh->boneWeights == NULL) {
+		he_engine_bench_free_asset(asset);
+		return NULL;
+	}
+
+	srand(1);
+
+	for(int v = 0; v < vertices; v++) {
+		Vector3 normal = Vector3Normalize((Vector3) { rand() % 200 - 100.0f, rand() % 200 - 100.0f, 1.0f });
+		float total = 0.0f;
+
+		for(int k = 0; k < 3; k++) {
+			mesh->vertices[v * 3 + k] = rand() % 200 / 100.0f - 1.0f;
+		}
+
+		mesh->normals[v * 3] = normal.x;
+		mesh->normals[v * 3 + 1] = normal.y;
+		mesh->normals[v * 3 + 2] = normal.z;
+
+		for(int j = 0; j < 4; j++) {
+			mesh->boneIds[v * 4 + j] = rand() % bones;
+			mesh->boneWeights[v * 4 + j] = j == 0 || rand() % 2 ? 1.0f + rand() % 100 : 0.0f;
+			total += mesh->boneWeights[v * 4 + j];
+		}
+
+		for(int j = 0; j < 4; j++) {
+			mesh->boneWeights[v * 4 + j] /= total;
+		}
+	}
+
+	for(u32 i = 0; i < frames * bones; i++) {
+		Quaternion rotation = QuaternionNormalize((Quaternion) { rand() % 200 - 100.0f, rand() % 200 - 100.0f,
+			rand() % 200 - 100.0f, rand() % 200 - 100.0f });
+
+		pose_data[i] = (Transform) { { rand() % 100 / 100.0f, rand() % 100 / 100.0f, 0.0f }, rotation,
+			{ 1.0f, 1.0f, 1.0f } };
+
+		if(i < bones) {
+			bind[i] = (Transform) { { 0.0f, i / (float)bones, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } };
+		}
+	}
+
+	for(u32 f = 0; f < frames; f++) {
+		poses[f] = &pose_data[f * bones];
+	}
+
+	// raw frame poses stay for the reference paths to read
+	if(he_engine_compress_clips(asset)) {
+		he_engine_bench_free_asset(asset);
+		return NULL;
+	}
+
+	return asset;
+}
+
+void
+he_engine_bench_free_asset(hed_asset *asset) {
+
+	if(asset == NULL) {
+		return;
+	}
+
+	// a box asset has no mesh and no poses
+	Mesh *mesh = asset->model.meshes;
+
+	if(mesh != NULL) {
+		free(mesh->vertices); free(mesh->normals); free(mesh->animVertices); free(mesh->animNormals);
+		free(mesh->boneIds); free(mesh->boneWeights);
+	}
+
+	if(asset->animations->framePoses != NULL) {
+		free(asset->animations->framePoses[0]);
+		free(asset->animations->framePoses);
+	}
+
+	free(asset->animations);
+	free(asset->model.bindPose);
+	free(asset->clip_rate);
+	he_engine_free_clips(asset);
+	free(mesh);
+	free(asset);
+}
+
+hed_asset *
+he_engine_bench_box_asset(u32 frames) {
+
+	// a unit box playing one clip with no mesh behind it, for passes that never skin
+	hed_asset *asset = calloc(1, sizeof(hed_asset));
+	ModelAnimation *animation = calloc(1, sizeof(ModelAnimation));
+
+	if(asset == NULL || animation == NULL) {
+		free(asset); free(animation);
+		return NULL;
+	}
+
+	animation->frameCount = frames;
+	asset->animations = animation;
+	asset->animCount = 1;
+	asset->box = (BoundingBox) { { -0.5f, 0.0f, -0.5f }, { 0.5f, 1.0f, 0.5f } };
+
+	return asset;
+}
+
+hed_level *
+he_engine_bench_level(hed_asset *asset, u32 count) {
+
+	// the fixture every entity benchmark starts from, count entities of asset bound
+	// in a fresh current level with components and boxes, NULL when any of it fails
+	hed_level *level = asset != NULL ? calloc(1, sizeof(hed_level)) : NULL;
+
+	if(level == NULL || he_arena_init(&level->arena, count * sizeof(hed_model))) {
+		free(level);
+		return NULL;
+	}
+
+	engine.current_level = level;
+
+	if(he_engine_grow_entities(level, count) || he_engine_alloc_components(level, ENTITY + count) ||
+	he_engine_alloc_boxes(&level->boxes, ENTITY + count)) {
+		he_engine_bench_free_level(level);
+		return NULL;
+	}
+
+	level->entities_count = count;
+
+	for(u32 i = 0; i < count; i++) {
+		level->entities[i] = (hed_model) { .asset = asset, .type = ENTITY, .id = ENTITY + i, .batch = NO_BATCH };
+		he_engine_bind_model(&level->entities[i]);
+	}
+
+	return level;
+}
+
+void
+he_engine_bench_free_level(hed_level *level) {
+
+	if(level == NULL) {
+		return;
+	}
+
+	free(level->boxes.min_x);
+	he_arena_free(&level->arena);
+	engine.current_level = NULL;
+	free(level);
+}
+
+void
+he_engine_bench_skin_raylib(Model model, ModelAnimation anim, int frame) {
+
+	// CPU side of raylib 5.0 UpdateModelAnimation, bone transforms redone for every vertex
+	for(int m = 0; m < model.meshCount; m++) {
+		Mesh mesh = model.meshes[m];
+
+		for(int v = 0, bone_counter = 0; v < mesh.vertexCount * 3; v += 3) {
+			mesh.animVertices[v] = mesh.animVertices[v + 1] = mesh.animVertices[v + 2] = 0.0f;
+			mesh.animNormals[v] = mesh.animNormals[v + 1] = mesh.animNormals[v + 2] = 0.0f;
+
+			for(int j = 0; j < 4; j++, bone_counter++) {
+				float weight = mesh.boneWeights[bone_counter];
+
+				if(weight == 0.0f) {
+					continue;
+				}
+
+				int bone = mesh.boneIds[bone_counter];
+				Transform in = model.bindPose[bone];
+				Transform out = anim.framePoses[frame][bone];
+				Quaternion rotation = QuaternionMultiply(out.rotation, QuaternionInvert(in.rotation));
+
+				Vector3 vertex = { mesh.vertices[v], mesh.vertices[v + 1], mesh.vertices[v + 2] };
+				vertex = Vector3Subtract(vertex, in.translation);
+				vertex = Vector3Multiply(vertex, out.scale);
+				vertex = Vector3RotateByQuaternion(vertex, rotation);
+				vertex = Vector3Add(vertex, out.translation);
+
+				mesh.animVertices[v] += vertex.x * weight;
+				mesh.animVertices[v + 1] += vertex.y * weight;
+				mesh.animVertices[v + 2] += vertex.z * weight;
+
+				Vector3 normal = { mesh.normals[v], mesh.normals[v + 1], mesh.normals[v + 2] };
+				normal = Vector3RotateByQuaternion(normal, QuaternionMultiply(out.rotation, QuaternionInvert(in.rotation)));
+
+				mesh.animNormals[v] += normal.x * weight;
+				mesh.animNormals[v + 1] += normal.y * weight;
+				mesh.animNormals[v + 2] += normal.z * weight;
+			}
+		}
+	}
+}
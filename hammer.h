@@ -3,6 +3,11 @@
 
 #ifdef HAMMER_ENGINE_IMPLEMENTATION
 
+// clock_gettime and friends under -std=c99, include hammer.h first
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 // Core C
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,16 +17,44 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <math.h>
+#include <time.h>
+
+// SIMD, HAMMER_NO_SIMD forces the scalar paths
+#if defined(__AVX2__) && !defined(HAMMER_NO_SIMD)
+#include <immintrin.h>
+#define HE_SIMD "avx2"
+#elif defined(__SSE2__) && !defined(HAMMER_NO_SIMD)
+#include <emmintrin.h>
+#define HE_SIMD "sse2"
+#else
+#define HE_SIMD "scalar"
+#endif
 
 // POSIX
 #include <unistd.h>
-#include <libgen.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+
+// level folder watching in DEBUG, other systems poll mtimes
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 // Raylib
 #include <raylib.h>
 #include <raymath.h>
+#include <rlgl.h>
+
+// glTF files are parsed with the cgltf raylib is built with, HAMMER_CGLTF compiles it in here
+// for a raylib that keeps its copy private
+#if defined(HAMMER_CGLTF) && defined(HAMMER_ENGINE_IMPLEMENTATION)
+#define CGLTF_IMPLEMENTATION
+#endif
+#include <cgltf.h>
 
 // macros
 #define HAMMERCFG "hammercfg"
@@ -35,13 +68,77 @@
 #define TITLE "Hammer Engine"
 #define PAUSED_TEXT "PAUSED"
 
-// dev-only, to be removed once save/load is implemented
-#define LOAD_FILE "aca.sav"
-
-// i don't think anyone would want more res than this
-#define MAX_MODELS 255
+// model ids are u16, entity tables themselves are sized per level
+#define MAX_MODELS 65000
+#define MAX_RULES UINT16_MAX
 #define MAX_LEVELS 32
 
+// level arena, allocations are aligned to this and a short estimate chains another block
+#define ARENA_ALIGN 16
+#define he_arena_round(size) (((size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+// level folders, their configs and the media they name, cached in base
+// and scanned again only when the levels folder changes
+#define INDEX_FILE "levels.idx"
+#define INDEX_MAGIC "HEIDX01"
+
+// nanosecond mtime, two edits within one second still differ
+#if defined(__APPLE__)
+#define he_mtime(st) ((int64_t)(st).st_mtimespec.tv_sec * 1000000000 + (st).st_mtimespec.tv_nsec)
+#else
+#define he_mtime(st) ((int64_t)(st).st_mtim.tv_sec * 1000000000 + (st).st_mtim.tv_nsec)
+#endif
+
+// asset decoding threads, capped by online cores
+#define LOADER_THREADS 8
+
+// main thread uploads this long between loading screen frames
+#define LOADER_SLICE (1.0 / 30.0)
+
+// frame job threads, main thread included, capped by online cores unless hammercfg says otherwise.
+// JOB_QUEUE is a power of two, queued jobs and split halves in flight per thread
+#define JOB_THREADS 16
+#define JOB_QUEUE 1024
+#define JOB_DEPENDENTS 8
+#define JOB_SPIN 2048
+
+// most ranges one job splits into, split halves take ring slots that are only safe to reuse
+// once they finish, and a frame graph has 4 jobs in flight at once. The grain is raised to fit
+#define JOB_RANGES (JOB_QUEUE / 8)
+
+// models or pairs a job handles before it is split in two for other threads to steal
+#define JOB_GRAIN 1024
+#define JOB_PAIR_GRAIN 8192
+#define JOB_SKIN_GRAIN 1
+
+// PRELOAD levels per level, megabytes their decoded models and read configs
+// may take and upload time taken from every frame while playing
+#define MAX_PRELOAD 4
+#define PRELOAD_BUDGET 256
+#define PRELOAD_SLICE 0.002
+
+// seconds between config mtime checks when inotify isn't there
+#define WATCH_POLL 0.25
+
+// slots of a keyword table, power of two and well above the longest keyword list
+#define KEYWORD_SLOTS 64
+
+// scoped phase timers, one branch when the profiler is off,
+// compiled out completely with HAMMER_NO_PROFILER
+#ifndef HAMMER_NO_PROFILER
+#define he_profile_begin(phase) \
+	double he_profile_##phase = engine.profiler.enabled ? he_engine_clock() : 0.0
+#define he_profile_end(phase) \
+	do { \
+		if(engine.profiler.enabled) he_engine_profile_sample(phase, he_engine_clock() - he_profile_##phase); \
+	} while(0)
+#else
+#define he_profile_begin(phase) (void)0
+#define he_profile_end(phase) do { } while(0)
+#endif
+
+#define he_axis(v, axis) ((axis) == 0 ? (v).x : (axis) == 1 ? (v).y : (v).z)
+
 #define he_stringify(x) #x
 #define he_vec3_modify(dst,x,y,z) \
 	dst.x = x; \
@@ -62,6 +159,83 @@
 // psx-style
 #define FPS 30
 
+// simulation runs at its own fixed rate, rendering interpolates between ticks
+#define TICKRATE 30
+#define ANIM_FPS 30
+
+// raylib resamples glTF and M3D clips every 17 ms, IQM clips keep the framerate
+// stored with each of them, the rest play at ANIM_FPS.
+// skinned poses between two keyframes, models on the same step share one skin
+#define GLTF_FRAME_MS 17
+#define ANIM_BLEND_STEPS 8
+
+// animation LOD, past these distances from the camera models animate every 2nd and 4th tick
+#define ANIM_LOD_NEAR 25.0f
+#define ANIM_LOD_FAR 60.0f
+
+// skinning matrices of a clip are baked when its model loads, up to this much per model,
+// POSE_CACHE in cfg.resources changes it for one model. Clips past it are posed per instance
+#define POSE_CACHE_KB 2048
+
+// compressed clips, a keyframe is dropped while interpolating the kept ones stays this close
+// to it(model units for translation and scale, quaternion components for rotation).
+// kept keys are at most CLIP_MAX_GAP frames apart
+#define CLIP_TOLERANCE 0.0005f
+#define CLIP_MAX_GAP 128
+#define CLIP_QUAT_RANGE 0.70710678f
+
+// longest frame we catch up on, anything above is a hitch (window drag, breakpoint)
+#define MAX_FRAME_TIME 0.25
+
+// headless run length when there is no replay to follow, one minute of game time
+#define HEADLESS_TICKS (TICKRATE * 60)
+#define MAX_REPLAY_KEYS 8
+
+// samples kept per profiled phase, older ones are overwritten
+#define PROFILE_SAMPLES 512
+
+// broad phase, entities covering more cells than this are always tested
+#define GRID_MAX_CELLS 64
+#define GRID_MIN_CELL 0.5f
+
+// cell coordinates past this don't fit the int math, boxes out there count as large
+#define GRID_MAX_COORD 16777216.0f
+
+// same clip distances raylib uses in BeginMode3D
+#define CULL_NEAR 0.01
+#define CULL_FAR 1000.0
+
+// entity not drawn through an instanced batch
+#define NO_BATCH UINT16_MAX
+
+// model id that doesn't exist, ids stop at MAX_MODELS
+#define NO_MODEL UINT16_MAX
+
+// model operands of responses, first model of the rule and the one it touched
+#define MODEL_SELF (UINT32_MAX - 1)
+#define MODEL_OTHER UINT32_MAX
+
+// collision events preallocated per level, grows only past this
+#define COLLISION_EVENTS 1024
+
+// map BVH, triangles per leaf and traversal depth
+#define BVH_LEAF_SIZE 4
+#define BVH_STACK 64
+#define BVH_MAGIC "HEBVH01"
+
+// baked models and configs of the base folder, mapped at startup
+#define PACK_FILE "hammer.pak"
+#define PACK_MAGIC "HEPAK01"
+#define PACK_ALIGN 16
+
+// pack offset to mapped memory, 0 stays NULL
+#define he_pack_at(offset) \
+	((offset) ? (void *)(engine.pack.data + (offset)) : NULL)
+
+// hero against map geometry
+#define HERO_STEP_HEIGHT 0.3f
+#define HERO_MAX_DROP 1000.0f
+
 #define HE_DECL static inline
 
 // ddecl
@@ -69,47 +243,316 @@
 // i will not write this crap everytime
 typedef uint8_t u8;
 typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
 
 typedef struct hed_window hed_window;
 typedef struct hed_model hed_model;
+typedef struct hed_components hed_components;
+typedef struct hed_skin hed_skin;
+typedef struct hed_bone_pose hed_bone_pose;
+typedef struct hed_clip hed_clip;
+typedef struct hed_track hed_track;
+typedef struct hed_bake hed_bake;
+typedef struct hed_asset hed_asset;
+typedef struct hed_assets hed_assets;
+typedef struct hed_loader hed_loader;
+typedef struct hed_preload hed_preload;
+typedef struct hed_watch hed_watch;
+typedef struct hed_index hed_index;
+typedef struct hed_index_level hed_index_level;
+typedef struct hed_index_asset hed_index_asset;
+typedef struct hed_index_header hed_index_header;
+typedef struct hed_lexer hed_lexer;
+typedef struct hed_token hed_token;
+typedef struct hed_keywords hed_keywords;
 typedef struct hed_level hed_level;
+typedef struct hed_arena hed_arena;
+typedef struct hed_job hed_job;
+typedef struct hed_worker hed_worker;
+typedef struct hed_jobs hed_jobs;
+typedef struct hed_arena_block hed_arena_block;
 typedef struct hed_config hed_config;
 typedef struct hed_menu hed_menu;
 typedef struct hed_controls hed_controls;
 typedef struct hed_state hed_state;
+typedef struct hed_timestep hed_timestep;
+typedef struct hed_replay hed_replay;
+typedef struct hed_replay_segment hed_replay_segment;
+typedef struct hed_profiler hed_profiler;
+typedef struct hed_frustum hed_frustum;
+typedef struct hed_grid hed_grid;
+typedef struct hed_boxes hed_boxes;
+typedef struct hed_pairs hed_pairs;
+typedef struct hed_event hed_event;
+typedef struct hed_events hed_events;
+typedef struct hed_program hed_program;
+typedef struct hed_name hed_name;
+typedef struct hed_names hed_names;
+typedef struct hed_triangle hed_triangle;
+typedef struct hed_bvh_node hed_bvh_node;
+typedef struct hed_bvh hed_bvh;
+typedef struct hed_bvh_header hed_bvh_header;
+typedef struct hed_pack hed_pack;
+typedef struct hed_pack_header hed_pack_header;
+typedef struct hed_pack_entry hed_pack_entry;
+typedef struct hed_pack_model hed_pack_model;
+typedef struct hed_pack_mesh hed_pack_mesh;
+typedef struct hed_pack_material hed_pack_material;
+typedef struct hed_pack_anim hed_pack_anim;
+typedef struct hed_pack_writer hed_pack_writer;
+typedef struct hed_material hed_material;
+typedef struct hed_batch hed_batch;
+typedef struct hed_batches hed_batches;
+
+// range of work for frame phases, data is shared and first/count is the slice to do
+typedef void (*hed_job_fn)(void *, u32, u32);
 
 // fdecl
 HE_DECL u8 		he_engine_run(void);
+HE_DECL u8 		he_engine_parse_hammercfg(void);
 HE_DECL u8 		he_engine_init_window(void);
         
 HE_DECL u8 		he_engine_run_level(const char *);
+HE_DECL u8 		he_engine_run_headless(const char *);
 
-HE_DECL void		he_engine_handle_input(void);
+HE_DECL void		he_engine_tick(float);
+HE_DECL void		he_engine_handle_input(float);
 HE_DECL void		he_engine_check_collisions(void);
 HE_DECL void		he_engine_render(void);
 
+// input goes through here so replays can stand in for the keyboard
+HE_DECL bool		he_engine_key_down(int);
+HE_DECL u8		he_engine_load_replay(const char *);
+HE_DECL void		he_engine_replay_step(void);
+HE_DECL double		he_engine_clock(void);
+
+HE_DECL void		he_engine_profile_sample(int, double);
+HE_DECL u16		he_engine_profile_stats(int, float *);
+HE_DECL void		he_engine_profile_draw(void);
+HE_DECL void		he_engine_profile_dump(void);
+HE_DECL int		he_engine_compare_float(const void *, const void *);
+
+#ifdef HAMMER_BENCH
+HE_DECL u8		he_engine_run_bench(const char *);
+#endif
+
 HE_DECL u8 		he_engine_parse_base(void);
 HE_DECL u8 		he_engine_parse_root(void);
 HE_DECL u8 		he_engine_parse_level(const char *);
+HE_DECL u8		he_engine_parse_resources(hed_level *, const char *);
+HE_DECL u8		he_engine_parse_logic(hed_level *, const char *);
 
 HE_DECL hed_model 	he_engine_load_model(const char *);
+HE_DECL hed_model *	he_engine_model(hed_level *, u16);
+HE_DECL hed_asset *	he_engine_acquire_asset(const char *);
+HE_DECL void		he_engine_release_asset(hed_asset *);
+HE_DECL void		he_engine_collect_assets(void);
+HE_DECL u8		he_engine_load_assets(void);
+HE_DECL void *		he_engine_decode_assets(void *);
+HE_DECL void		he_engine_decode_asset(hed_asset *);
+HE_DECL void		he_engine_upload_asset(hed_asset *);
+HE_DECL void		he_engine_bind_model(hed_model *);
+HE_DECL void		he_engine_decode_rates(hed_asset *);
+HE_DECL void		he_engine_iqm_rates(hed_asset *);
+HE_DECL float		he_engine_clip_rate(const hed_asset *, int);
+HE_DECL hed_asset *	he_engine_level_asset(hed_level *, const char *);
+HE_DECL void		he_engine_bake_clip(hed_asset *, int);
+HE_DECL void		he_engine_bake_assets(void);
+HE_DECL void		he_engine_bake_range(void *, u32, u32);
+HE_DECL u8		he_engine_compress_clips(hed_asset *);
+HE_DECL void		he_engine_drop_poses(hed_asset *);
+HE_DECL void		he_engine_free_clips(hed_asset *);
+HE_DECL u8		he_clip_compress(hed_clip *, const ModelAnimation *);
+HE_DECL void		he_clip_track(hed_clip *, hed_track *, const float *, int, bool);
+HE_DECL bool		he_clip_fits(const hed_clip *, const hed_track *, const float *, int, int, bool);
+HE_DECL void		he_clip_encode(const hed_track *, const float *, bool, u16 *);
+HE_DECL void		he_clip_decode(const hed_track *, const u16 *, bool, float *);
+HE_DECL void		he_clip_mix(const float *, const float *, float, bool, float *);
+HE_DECL void		he_clip_track_at(const hed_clip *, const hed_track *, int, float, bool, float *);
+HE_DECL Transform	he_clip_sample(const hed_clip *, int, int, float);
+HE_DECL void		he_clip_free(hed_clip *);
+HE_DECL const hed_bone_pose *	he_engine_baked_pose(const hed_asset *, int, int);
+HE_DECL u8		he_engine_alloc_components(hed_level *, u32);
+HE_DECL void		he_engine_copy_component(hed_components *, u16, const hed_components *, u16);
+HE_DECL void		he_engine_place_model(hed_level *, u16, Vector3);
+HE_DECL void		he_engine_draw_loading(u16, u16, u16);
+HE_DECL void		he_engine_start_preload(void);
+HE_DECL void *		he_engine_preload_levels(void *);
+HE_DECL void		he_engine_stream_preload(void);
+HE_DECL void		he_engine_finish_preload(void);
+HE_DECL void		he_engine_release_preload(void);
+HE_DECL hed_level *	he_engine_take_preload(const hed_index_level *);
+HE_DECL size_t		he_engine_asset_bytes(const hed_asset *);
+HE_DECL void		he_engine_watch_level(void);
+HE_DECL void		he_engine_unwatch_level(void);
+HE_DECL void		he_engine_poll_level(void);
+HE_DECL u8		he_engine_reload_logic(void);
+HE_DECL u8		he_engine_reload_resources(void);
 HE_DECL	u8 		he_engine_draw_model(hed_model *);
-HE_DECL int		he_engine_check_model(const char *); 
+HE_DECL void		he_engine_update_animations(float);
+HE_DECL void		he_engine_animate_range(void *, u32, u32);
+HE_DECL void		he_engine_cull_models(void);
+HE_DECL void		he_engine_cull_range(void *, u32, u32);
+HE_DECL void		he_engine_skin_models(void);
+HE_DECL void		he_engine_skin_range(void *, u32, u32);
+HE_DECL u32		he_engine_skin_size(const Model *);
+HE_DECL void		he_engine_pose_bones(const Model *, const hed_clip *, int, float, hed_bone_pose *);
+HE_DECL hed_bone_pose	he_engine_bone_pose(Transform, Transform);
+HE_DECL void		he_engine_blend_bones(const hed_bone_pose *, const hed_bone_pose *, float, int, hed_bone_pose *);
+HE_DECL Matrix		he_engine_lerp_matrix(Matrix, Matrix, float);
+HE_DECL void		he_engine_skin_model(const Model *, const hed_bone_pose *, float *);
+HE_DECL void		he_engine_upload_skin(const Model *, const float *);
+HE_DECL void		he_engine_store_transforms(void);
+HE_DECL void		he_engine_update_frustum(void);
+HE_DECL bool		he_engine_box_visible(BoundingBox);
+HE_DECL BoundingBox	he_engine_render_box(u16, Vector3);
+HE_DECL u8		he_engine_build_batches(void);
+HE_DECL void		he_engine_draw_batch(hed_batch *);
+HE_DECL int		he_engine_check_model(hed_level *, const char *, u32);
+HE_DECL int		he_engine_find_name(hed_level *, const char *, u32);
+HE_DECL u8		he_engine_build_names(hed_level *);
+HE_DECL u32		he_engine_hash(const char *, u32, u32);
 HE_DECL u8		he_engine_switch_animation(hed_model *, int);
 
-HE_DECL BoundingBox	he_engine_combine_bbox(BoundingBox, BoundingBox);
-HE_DECL void		he_engine_update_tbbox(hed_model *);
-
-HE_DECL	u8 		he_engine_load_game(const char *); // TODO
-HE_DECL u8 		he_engine_save_game(const char *); // TODO
+HE_DECL void		he_engine_collision_events(void);
+HE_DECL void		he_engine_push_event(u8, u64);
+HE_DECL void		he_engine_dispatch_events(void);
+HE_DECL u8		he_engine_alloc_events(hed_events *, u32);
+HE_DECL int		he_engine_compare_u64(const void *, const void *);
+HE_DECL void		he_engine_push_pair(hed_pairs *, u16, u32, u32);
+HE_DECL void		he_engine_overlap_pairs(const hed_boxes *, const u32 *, const u32 *, u32, u8 *);
+HE_DECL void		he_engine_overlap_range(void *, u32, u32);
+HE_DECL u8		he_engine_alloc_boxes(hed_boxes *, u32);
+HE_DECL void		he_engine_build_grid(void);
+HE_DECL u16		he_engine_grid_query(BoundingBox);
+HE_DECL u32		he_engine_grid_hash(int, int, int);
+HE_DECL bool		he_engine_grid_range(const hed_grid *, BoundingBox, float, int *, int *);
+
+// map geometry, world space
+HE_DECL bool		he_engine_raycast(Ray, float, RayCollision *);
+HE_DECL bool		he_engine_overlap_box(BoundingBox);
+HE_DECL bool		he_engine_overlap_sphere(Vector3, float);
+HE_DECL bool		he_engine_ground_height(Vector3, float, float *);
+HE_DECL bool		he_engine_hero_blocked(Vector3);
+HE_DECL void		he_engine_move_hero(Vector3);
+
+// map BVH, model space
+HE_DECL u8		he_bvh_load_map(hed_bvh *, const char *, Model *);
+HE_DECL u8		he_bvh_build(hed_bvh *, hed_triangle *, u32);
+HE_DECL u32		he_bvh_split(hed_bvh *, Vector3 *, u32, u32);
+HE_DECL void		he_bvh_select(hed_triangle *, Vector3 *, long, long, long, int);
+HE_DECL bool		he_bvh_raycast(const hed_bvh *, Ray, float, RayCollision *);
+HE_DECL bool		he_bvh_overlap_box(const hed_bvh *, BoundingBox);
+HE_DECL bool		he_bvh_overlap_sphere(const hed_bvh *, Vector3, float);
+HE_DECL bool		he_bvh_tri_box(const hed_triangle *, Vector3, Vector3);
+HE_DECL Vector3		he_bvh_closest_point(const hed_triangle *, Vector3);
+HE_DECL void		he_bvh_free(hed_bvh *);
+HE_DECL u8		he_bvh_check(const hed_bvh *);
+
+HE_DECL u8		he_arena_init(hed_arena *, size_t);
+HE_DECL void *		he_arena_alloc(hed_arena *, size_t);
+HE_DECL const char *	he_arena_strdup(hed_arena *, const char *, size_t);
+HE_DECL void		he_arena_free(hed_arena *);
+HE_DECL u8		he_jobs_init(u32);
+HE_DECL void		he_jobs_shutdown(void);
+HE_DECL hed_job *	he_jobs_create(hed_job_fn, void *, u32, u32);
+HE_DECL void		he_jobs_depend(hed_job *, hed_job *);
+HE_DECL void		he_jobs_submit(hed_job *);
+HE_DECL void		he_jobs_wait(hed_job *);
+HE_DECL void		he_jobs_for(hed_job_fn, void *, u32, u32);
+HE_DECL u8		he_jobs_push(hed_worker *, hed_job *);
+HE_DECL hed_job *	he_jobs_find(hed_worker *);
+HE_DECL void		he_jobs_execute(hed_worker *, hed_job *);
+HE_DECL void		he_jobs_finish(hed_worker *, hed_job *);
+HE_DECL void *		he_jobs_thread(void *);
+HE_DECL size_t		he_engine_size_level(const char *, const char *, u32 *, u32 *);
+HE_DECL u8		he_engine_read_level(hed_level *, const char *);
+HE_DECL size_t		he_engine_level_bytes(const hed_level *);
+HE_DECL int64_t		he_engine_level_stamp(const char *);
+HE_DECL u8		he_engine_grow_entities(hed_level *, u32);
+HE_DECL u8		he_engine_grow_rules(hed_level *, u32);
+
+HE_DECL u8		he_index_load(void);
+HE_DECL u8		he_index_build(int64_t);
+HE_DECL bool		he_index_valid(const hed_index *);
+HE_DECL u8		he_index_scan(hed_index_level *);
+HE_DECL void		he_index_add_asset(hed_index_level *, const hed_token *);
+HE_DECL void		he_index_save(void);
+HE_DECL hed_index_level *	he_index_find(const char *);
+HE_DECL hed_index_level *	he_index_find_id(u32);
+HE_DECL u8		he_index_check(hed_index_level *);
+HE_DECL void		he_index_prefetch(const hed_index_level *);
+
+HE_DECL u8		he_pack_open(void);
+HE_DECL void		he_pack_close(void);
+HE_DECL const hed_pack_entry *	he_pack_find(const char *, u32);
+HE_DECL bool		he_pack_fits(u64, u64, u64);
+HE_DECL u8		he_pack_check_model(u64);
+HE_DECL u8		he_pack_index(void);
+HE_DECL u8		he_pack_bake(void);
+HE_DECL u64		he_pack_put(hed_pack_writer *, const void *, u64);
+HE_DECL u8		he_pack_put_entry(hed_pack_writer *, hed_pack_entry *, const char *, u32);
+HE_DECL u64		he_pack_put_model(hed_pack_writer *, const char *);
+HE_DECL void		he_pack_decode_model(hed_asset *);
+HE_DECL void		he_pack_upload_model(hed_asset *);
+HE_DECL void		he_pack_unload_model(hed_asset *);
 
-HE_DECL void		he_processor(int, ...);
+HE_DECL BoundingBox	he_engine_combine_bbox(BoundingBox, BoundingBox);
+HE_DECL BoundingBox	he_engine_glb_bbox(const char *);
+HE_DECL u8		he_engine_decode_model(hed_asset *);
+HE_DECL void		he_engine_upload_staged(hed_asset *);
+HE_DECL void		he_engine_free_staged(hed_asset *);
+HE_DECL u8		he_gltf_meshes(const cgltf_data *, hed_asset *);
+HE_DECL u8		he_gltf_primitive(const cgltf_primitive *, cgltf_size, Mesh *, const char *);
+HE_DECL u8		he_gltf_floats(const cgltf_accessor *, cgltf_size, cgltf_type, float **, const char *);
+HE_DECL u8		he_gltf_materials(const cgltf_data *, hed_asset *);
+HE_DECL Image		he_gltf_image(const cgltf_image *, const char *);
+HE_DECL u8		he_gltf_skin(const cgltf_data *, hed_asset *);
+HE_DECL void		he_engine_update_bounds(void);
+HE_DECL void		he_engine_bounds_range(void *, u32, u32);
+
+HE_DECL u8		he_engine_load_game(const char *);
+HE_DECL u8		he_engine_save_game(const char *);
+
+HE_DECL void		he_processor(const hed_event *);
+HE_DECL hed_model *	he_processor_model(u32, const hed_event *);
+HE_DECL u8		he_processor_compile(hed_level *, hed_lexer *, const hed_token *);
+HE_DECL u8		he_processor_operand(hed_level *, hed_lexer *, u32 *);
+HE_DECL void		he_processor_emit(hed_level *, u32);
+HE_DECL u32		he_processor_string(hed_level *, const char *, u32);
+HE_DECL u32		he_processor_number(hed_level *, float);
 HE_DECL void		he_engine_die(void);
 HE_DECL void		he_engine_cleanup_level(void);
-
-// non-posix, stack-only, memory-safe getline, not the fastest but its OK
-HE_DECL void		he_engine_getline(FILE *, char *, size_t);
-HE_DECL u8		he_engine_exists_keyword(const char *);
+HE_DECL void		he_engine_free_level(hed_level *);
+
+HE_DECL int		he_engine_exists_keyword(const hed_token *);
+
+// configs are read whole, tokens are views into the file
+HE_DECL u8		he_lex_open(hed_lexer *, const char *);
+HE_DECL void		he_lex_close(hed_lexer *);
+HE_DECL bool		he_lex_next(hed_lexer *, hed_token *);
+HE_DECL bool		he_lex_inline(hed_lexer *, hed_token *);
+HE_DECL void		he_lex_rest(hed_lexer *, hed_token *);
+HE_DECL u8		he_lex_expect(hed_lexer *, hed_token *, const char *);
+HE_DECL u8		he_lex_copy(const hed_lexer *, const hed_token *, char *, size_t);
+HE_DECL u8		he_lex_int(const hed_lexer *, const hed_token *, int *);
+HE_DECL u8		he_lex_float(const hed_lexer *, const hed_token *, float *);
+HE_DECL void		he_lex_error(const hed_lexer *, const hed_token *, const char *, ...);
+HE_DECL bool		he_lex_is(const hed_token *, const char *);
+
+HE_DECL void		he_keywords_build(hed_keywords *);
+HE_DECL int		he_keywords_find(const hed_keywords *, const hed_token *);
+HE_DECL u32		he_keywords_slot(const char *, u32, u32);
+
+// just enough json to read glTF headers without a GL context
+HE_DECL const char *	he_json_ws(const char *, const char *);
+HE_DECL const char *	he_json_skip(const char *, const char *);
+HE_DECL const char *	he_json_enter(const char *, const char *);
+HE_DECL const char *	he_json_next(const char *, const char *);
+HE_DECL const char *	he_json_key(const char *, const char *, const char *);
+HE_DECL const char *	he_json_index(const char *, const char *, int);
+HE_DECL int		he_json_floats(const char *, const char *, float *, int);
 
 // ddef
 struct hed_window {
@@ -118,29 +561,240 @@ struct hed_window {
 	char *title;
 };
 
-struct hed_model {
-	Model model;
+// one loaded file, shared by every model instance using it
+struct hed_asset {
+	char path[U8];
 
+	Model model;
 	ModelAnimation *animations;
 	int animCount;
-	int currentAnimation;
-	int currentFrame;
-	bool animate;
+	float *clip_rate; // frames per second of each clip
+	BoundingBox box;
 
-	BoundingBox box, transformedBox;
-	Vector3 center;
+	u16 refs; // unloaded after a level load leaves it at 0
 
-	Vector3 position;
-	float angle;
-	bool render;
+	// loading stages, workers decode and the main thread uploads
+	bool decoded;
+	bool boxed; // bounds read from the glTF header, otherwise taken from meshes on upload
+	bool uploaded; // headless never uploads
+	bool staged; // meshes and images decoded by a worker, upload only sends them to the GPU
 
-	char name[U8];
+	hed_material *materials; // staged until upload, material 0 is raylib's default
+	int material_count;
+
+	const hed_pack_entry *packed; // data comes from the mapped pack
+
+	const float *skin; // instance vertices last uploaded into the meshes
+
+	// one compressed clip per animation, raw frame poses are dropped once they are in
+	hed_clip *clips;
+	size_t raw_bytes, clip_bytes;
+
+	// baked poses of every clip so far, against the POSE_CACHE cap
+	size_t pose_bytes;
+	u32 pose_cap;
+};
+
+struct hed_assets {
+	hed_asset **items;
+	u16 count, capacity;
+};
+
+// assets waiting for decoding, shared with the worker threads
+struct hed_loader {
+	pthread_mutex_t lock;
+
+	hed_asset **queue;
+	u16 count;
+	u16 next; // next asset a worker picks up
+	u16 decoded;
+
+	bool cancel; // workers stop before their next asset
+};
+
+// next levels, decoded and read on a background thread, their assets uploaded a slice per frame
+struct hed_preload {
+	pthread_t thread;
+	bool running;
+
+	const hed_index_level *levels[MAX_PRELOAD];
+	u8 level_count;
+
+	// read into their own arenas once their models fit, the switch takes the one it runs
+	hed_level *parsed[MAX_PRELOAD];
+	int64_t stamps[MAX_PRELOAD]; // configs as they were read
+
+	// every asset the preload holds a reference to, released after the next level is parsed
+	hed_asset **held;
+	u16 held_count, held_capacity; // capacity is every file the levels name
+
+	hed_loader loader; // assets that still need decoding or uploading
+	u16 uploaded;
+
+	u64 budget, used; // bytes decoding and reading left in memory
+};
+
+// media file named by a level's resources, size as of the last scan
+struct hed_index_asset {
+	char name[U6];
+	int64_t size; // -1 when missing
+};
+
+// level folder, id stays the same for as long as the folder exists
+struct hed_index_level {
+	char name[U6];
+	u32 id;
+
+	int64_t resources_mtime, resources_size;
+	u32 asset_first, asset_count; // into index assets, each file once
+	u32 missing;
+	u64 bytes; // every asset that exists
+};
+
+struct hed_index {
+	hed_index_level levels[MAX_LEVELS];
+	u16 count;
+	u32 next_id;
+
+	int64_t mtime; // levels folder, any level added or removed changes it
+
+	hed_index_asset *assets;
+	u32 asset_count, asset_capacity;
+};
+
+// levels then assets follow
+struct hed_index_header {
+	char magic[8];
+	u32 level_count, asset_count, next_id;
+	int64_t mtime;
+};
+
+// cfg.resources and cfg.logic of the running level, DEBUG only
+struct hed_watch {
+	int fd; // inotify, -1 polls mtimes instead
+	double last_poll;
+
+	int64_t logic_mtime, logic_size;
+	int64_t resources_mtime, resources_size;
+};
+
+// one config in memory, mapped from disk or pointing into the pack
+struct hed_lexer {
+	const char *path;
+	const char *data;
+	size_t size, at;
+
+	u32 line;
+	size_t line_start;
+	bool mapped; // unmapped on close, pack views are not
+};
+
+// view into lexer data, not terminated
+struct hed_token {
+	const char *str;
+	u32 len;
+	u32 line, column;
+};
+
+// words hashed without collisions, seed is searched once at startup
+struct hed_keywords {
+	const char **words;
+	u8 count;
+	u32 seed;
+	u8 slots[KEYWORD_SLOTS]; // word index + 1, 0 is empty
+};
+
+// instance state, mesh and animation data live in asset
+// what loading, logic and drawing read, per tick state is in hed_components under id
+struct hed_model {
+	hed_asset *asset;
+
+	Vector3 origin; // position given by logic, reloads only move models whose origin changed
+
+	const char *name; // in level arena or the asset path, never copied per instance
+	u16 name_id; // interned, index into level names
 	u8 type;
+	u8 entity_type;
+	u16 id; // slot in level arrays, HERO, MAP, ENTITY + index
+	u16 batch; // instanced batch index or NO_BATCH
 
-	Vector3 scale;
 	Color tint;
 };
 
+// model state every tick walks, one array per field indexed by model id
+struct hed_components {
+	Vector3 *position, *scale;
+	float *angle;
+
+	// transform at the previous tick, rendering interpolates from here
+	Vector3 *prev_position;
+	float *prev_angle;
+
+	BoundingBox *box, *world; // model space and placed in the level
+
+	// animation cursor, time into the playing clip and the keyframe it falls after,
+	// frame_count and clip_rate of the clip save a trip to the asset
+	int *clip, *frame, *frame_count;
+	float *clip_time, *clip_rate;
+	u8 *anim_lod; // ticks between animation steps as a shift, set by culling
+
+	u8 *flags; // MODEL_FLAG bits
+	u32 count;
+
+	// skinned vertices of animated models and the ones the skin pass redoes this frame
+	hed_skin *skin;
+	u16 *skinning;
+	u32 skinning_count;
+};
+
+// one animated model's own copy of its meshes, positions then normals of every skinned mesh.
+// pose is the clip, frame and step in vertices, fresh until the render thread uploads it.
+// drawn is what gets uploaded, its own vertices or those of a model on the same baked pose
+struct hed_skin {
+	hed_asset *asset;
+	float *vertices;
+	const float *drawn;
+	hed_bone_pose *bones;
+	int clip, frame;
+	u8 step; // of ANIM_BLEND_STEPS towards the next keyframe
+	bool fresh;
+};
+
+// bind pose to frame pose of a bone, vertices blend these with their weights
+struct hed_bone_pose {
+	Matrix vertex, normal;
+};
+
+// keys of one bone channel, translation and scale keys are fractions of the min/extent box,
+// rotations are the three smallest quaternion components with the largest one's index
+struct hed_track {
+	u32 first; // into the clip's times and values
+	u16 count;
+	Vector3 min, extent;
+};
+
+// translation, rotation and scale track of every bone, 3 values per key
+struct hed_clip {
+	hed_track *tracks;
+	u16 *times; // frame of every key, first and last frame are always kept
+	u16 *values;
+	u32 keys;
+	int frames, bones;
+
+	// baked when the model loads if it fits, with the model that skinned
+	// each frame and step in skin pass pose_pass
+	hed_bone_pose *poses;
+	u16 *pose_skinned;
+	u32 *pose_pass;
+	bool tried;
+};
+
+// clip of an asset being baked on the job threads
+struct hed_bake {
+	hed_asset *asset;
+	int clip;
+};
+
 struct hed_config {
 	char base[U6];
 	char root[U6];
@@ -160,26 +814,321 @@ struct hed_menu {
 	u8 menu_switch;
 };
 
+// uniform grid over entity boxes, cells hashed into buckets.
+// items of bucket b are items[bucket_start[b] .. bucket_start[b+1]]
+struct hed_grid {
+	float cell;
+	u32 bucket_count; // power of two
+
+	u32 *bucket_start;
+	u32 *bucket_fill;
+	u16 *items;
+	u32 item_count;
+
+	// spans more than GRID_MAX_CELLS, candidate for every query
+	u16 *large;
+	u16 large_count;
+
+	// dedupe of entities found through several cells
+	u32 *stamp;
+	u32 query;
+	u16 *candidates;
+
+	bool dirty; // rebuilt before next wildcard query
+};
+
+// transformed boxes by model id, pair tests read these instead of hed_model
+struct hed_boxes {
+	float *min_x, *min_y, *min_z;
+	float *max_x, *max_y, *max_z;
+	u32 count;
+};
+
+// pairs gathered for one collision pass, rule is the response to fire
+struct hed_pairs {
+	u32 *a, *b;
+	u16 *rule;
+	u8 *hits;
+	u32 count, capacity;
+};
+
+struct hed_triangle {
+	Vector3 a, b, c;
+};
+
+// leaf when count > 0, tris[offset .. offset+count].
+// inner node has left child right after it and right child at offset.
+struct hed_bvh_node {
+	Vector3 min, max;
+	u32 offset;
+	u32 count;
+};
+
+struct hed_bvh {
+	hed_bvh_node *nodes;
+	u32 node_count;
+	hed_triangle *tris;
+	u32 tri_count;
+};
+
+// on disk cache, followed by nodes and triangles
+struct hed_bvh_header {
+	char magic[8];
+	u32 node_count;
+	u32 tri_count;
+	int64_t source_mtime;
+	int64_t source_size;
+};
+
+// offsets are from the start of the pack, every section PACK_ALIGN aligned
+struct hed_pack {
+	u8 *data;
+	size_t size;
+
+	const hed_pack_entry *entries;
+	u32 entry_count;
+
+	// open addressed on path and kind, entry index + 1, 0 is free
+	u32 *slots;
+	u32 slot_count;
+
+	// source file against the entry, 0 not looked at yet, 1 unchanged, 2 edited since the bake
+	u8 *checked;
+};
+
+struct hed_pack_header {
+	char magic[8];
+	u32 entry_count;
+	u32 pad;
+	u64 entries;
+};
+
+// entry is used while its source file has this mtime and size
+struct hed_pack_entry {
+	char path[U8 + 1];
+	u32 kind;
+	int64_t source_mtime;
+	int64_t source_size;
+	u64 offset, size;
+};
+
+struct hed_pack_model {
+	Matrix transform;
+	BoundingBox box;
+	u32 mesh_count, material_count, bone_count, anim_count;
+	u64 meshes, materials, mesh_material, bones, bind_pose, anims;
+};
+
+// 0 offset means the array is missing
+struct hed_pack_mesh {
+	u32 vertex_count, triangle_count;
+	u64 vertices, texcoords, texcoords2, normals, tangents, colors, indices;
+	u64 anim_vertices, anim_normals, bone_ids, bone_weights;
+};
+
+// only the diffuse map, the only one the shaders sample
+struct hed_pack_material {
+	Color color;
+	u32 width, height, format;
+	u64 pixels; // 0 keeps the default texture
+};
+
+// frame f bone b pose at poses + (f * bone_count + b) * sizeof(Transform)
+struct hed_pack_anim {
+	char name[32];
+	u32 bone_count, frame_count;
+	u64 bones, poses;
+};
+
+// decoded material waiting for upload, the maps raylib's glTF loader fills
+struct hed_material {
+	Color color, emission;
+	float metalness, roughness;
+	Image images[MATERIAL_MAP_EMISSION + 1]; // data NULL keeps the default texture
+};
+
+struct hed_pack_writer {
+	u8 *data;
+	u64 size, capacity;
+	bool failed;
+};
+
+// entities sharing an asset and tint, drawn with one call per mesh
+struct hed_batch {
+	hed_asset *asset;
+	Color tint;
+
+	u16 first, count; // members[first..first+count)
+	u16 drawn; // transforms written on the last rebuild, hidden members skipped
+
+	BoundingBox bounds;
+
+	bool moving; // a member moved this tick
+	bool dirty; // transforms don't match members anymore
+};
+
+struct hed_batches {
+	hed_batch *items;
+	u16 count;
+
+	u16 *members; // entity indices grouped by batch
+	Matrix *transforms; // same order as members
+};
+
+// one contact transition, a and b are model ids
+struct hed_event {
+	u8 type;
+	u16 rule;
+	u32 a, b;
+};
+
+// contacts are sorted keys rule << 48 | a << 24 | b, previous tick against this one
+struct hed_events {
+	hed_event *queue;
+	u32 count, capacity;
+
+	u64 *contacts, *current;
+	u32 contact_count, contact_capacity;
+};
+
+// collision responses compiled from cfg.logic, code is an opcode followed by its
+// operands, strings and numbers are indices into the pools. rules start at col_code
+struct hed_program {
+	u32 *code;
+	u32 count, capacity;
+
+	char *strings; // terminated, operand is the offset
+	u32 strings_size, strings_capacity;
+
+	float *numbers;
+	u32 number_count, number_capacity;
+
+	bool oom; // some emit failed, the program is unusable
+};
+
+// one distinct model file name, its instances are members[first .. first + count]
+// in id order, hero and map first
+struct hed_name {
+	const char *str; // name of the first instance
+	u32 hash;
+	u16 first, count;
+};
+
+// open addressing, slots hold item index + 1, 0 is empty
+struct hed_names {
+	hed_name *items;
+	u16 count;
+
+	u16 *slots;
+	u32 slot_count; // power of two, at least twice the names
+
+	u16 *members; // model ids grouped by name
+};
+
+// chunk of level memory, data follows the header
+struct hed_arena_block {
+	hed_arena_block *next;
+	size_t size, used;
+};
+
+// bigger than grain it is split in halves, idle threads steal the halves
+struct hed_job {
+	hed_job_fn run;
+	void *data;
+	u32 first, count, grain;
+
+	hed_job *group; // job a split half came from, NULL for one that was added
+	u32 unfinished; // itself and its split halves still running
+	u32 waiting; // jobs it depends on still running, plus one until submitted
+	bool done;
+
+	// run once this one is done, added under the graph lock
+	hed_job *dependents[JOB_DEPENDENTS];
+	u8 dependent_count;
+};
+
+// one per thread, the owner pushes and pops at the bottom, thieves take from the top
+struct hed_worker {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	hed_job *queue[JOB_QUEUE];
+	u32 top, bottom;
+
+	// split halves, and jobs added on the main thread, reused once the ring comes around
+	hed_job ring[JOB_QUEUE];
+	u32 next;
+
+	u32 index;
+	u32 stolen; // jobs taken from other threads, debug stats
+};
+
+// workers[0] is the main thread, it runs jobs while it waits for them
+struct hed_jobs {
+	hed_worker *workers;
+	u32 count;
+
+	u32 pending; // queued jobs nobody took yet
+	u32 sleeping;
+	bool quit;
+
+	pthread_mutex_t graph; // dependents and done
+	pthread_mutex_t sleep_lock;
+	pthread_cond_t wake;
+};
+
+// everything sized by the level configs, freed at once when the level ends
+struct hed_arena {
+	hed_arena_block *head;
+	u32 blocks;
+	size_t reserved, used;
+};
+
 struct hed_level {
 	hed_model hero,map;
-	hed_model entities[MAX_MODELS];
-	u16 entities_count;
+	hed_model *entities;
+	u16 entities_count, entities_capacity;
 	char name[U8];
 
+	// entities, names, rules and the response program live here
+	hed_arena arena;
+
 	// logic info
 	
-	// collision
-	BoundingBox *col_one[U8], *col_two[U8];
-	u16 col_count;
+	// collision, rule arrays hold col_capacity
+	// model ids
+	u16 *col_one, *col_two;
+	u16 col_count, col_capacity;
 
-	// some collision functions take one or more args
-	u8 col_action_instruction[U8];
-	
-	char col_action_arg1[U8][U8];
-	char col_action_arg2[U8][U8];
-	char col_action_arg3[U8][U8];
-	char col_action_arg4[U8][U8];
-	char col_action_arg5[U8][U8];
+	// hot per model state, sized to every model the level has
+	hed_components components;
+
+	hed_boxes boxes;
+	hed_pairs pairs;
+
+	// map triangles for raycasts, overlaps and ground probes
+	hed_bvh map_bvh;
+
+	// transitions the response is bound to, COLLISION_EVENT mask
+	u8 *col_when;
+	hed_events events;
+
+	// wildcard rules have no col_two, they query the grid
+	u8 *col_target;
+	u16 col_wildcards;
+	hed_grid grid;
+
+	hed_batches batches;
+
+	// levels likely to follow this one
+	char preload[MAX_PRELOAD][U8];
+	u8 preload_count;
+
+	// response of each rule, offset into program code
+	u32 *col_code;
+	hed_program program;
+
+	// model names to ids, built after resources
+	hed_names names;
 };
 
 struct hed_controls {
@@ -197,14 +1146,69 @@ struct hed_controls {
 	int toggle_light;
 	int toggle_pause;
 
+	// units and degrees per second, scaled by the tick length
 	float velocity;
 	float run_factor;
+	float turn_speed;
+};
+
+struct hed_timestep {
+	u16 tickrate; // simulation ticks per second
+	u16 fps; // render cap, 0 is uncapped
+
+	float dt;
+	double accumulator;
+	float alpha; // 0..1 position of rendered frame between last two ticks
+	uint64_t ticks;
+};
+
+// keys held for a number of ticks
+struct hed_replay_segment {
+	u32 ticks;
+	int keys[MAX_REPLAY_KEYS];
+	u8 key_count;
+};
+
+enum PROFILE_PHASE {
+	PROFILE_INPUT,
+	PROFILE_ANIMATION,
+	PROFILE_BBOX,
+	PROFILE_COLLISIONS,
+	PROFILE_EVENTS,
+	PROFILE_CULL,
+	PROFILE_SKIN,
+	PROFILE_DRAW,
+	NUM_PROFILE_PHASES
+};
+
+struct hed_profiler {
+	bool enabled;
+	char csv[U8]; // dumped on level exit when set
+
+	// ring buffers, milliseconds
+	float samples[NUM_PROFILE_PHASES][PROFILE_SAMPLES];
+	u16 head[NUM_PROFILE_PHASES];
+	u16 count[NUM_PROFILE_PHASES];
+};
+
+// left, right, bottom, top, near, far, xyz normal pointing inside and w distance
+struct hed_frustum {
+	Vector4 planes[6];
+};
+
+struct hed_replay {
+	hed_replay_segment *segments;
+	u32 count;
+	u32 current;
+	u32 elapsed; // ticks spent in current segment
+	bool active;
+	bool finished;
 };
 
 struct hed_state {
 	hed_window window;
 	Camera camera;
-	const u8 fps;
+	hed_timestep timestep;
 	
 	hed_config config;
 	hed_menu menu;
@@ -218,6 +1222,46 @@ struct hed_state {
 	bool light;
 	bool pause;
 
+	// no window, no GPU, simulation only
+	bool headless;
+	u32 headless_ticks;
+	char replay_file[U8];
+	hed_replay replay;
+
+	// run a benchmark instead of the game
+	char bench[U6];
+
+	hed_profiler profiler;
+
+	// loaded files, outlive levels while referenced
+	hed_assets assets;
+	hed_loader loader;
+	hed_preload preload;
+
+	// frame phases that only compute run across these
+	hed_jobs jobs;
+	u32 threads; // from hammercfg, 0 is one per core
+	u32 skin_pass;
+
+	// set by LOAD_LEVEL, ends the current level
+	char next_level[U8];
+
+	hed_watch watch;
+
+	// every level folder, levels are looked up here by path or save id
+	hed_index index;
+
+	hed_pack pack;
+	bool bake;
+
+	// culling
+	hed_frustum frustum;
+	u32 drawn, culled;
+
+	// instanced batches, one mesh draw covers all members
+	Shader instancing;
+	u32 draw_calls;
+
 	hed_controls controls;
 };
 
@@ -227,9 +1271,98 @@ enum MODEL_TYPE {
 	ENTITY
 };
 
+enum ENTITY_TYPE {
+	STATIC
+};
+
+// hed_components flags, DIRTY until bounds follow a new position or scale
+enum MODEL_FLAG {
+	MODEL_RENDER = 1,
+	MODEL_VISIBLE = 2, // inside the camera frustum last frame
+	MODEL_ANIMATE = 4,
+	MODEL_DIRTY = 8
+};
+
+// what the second model of a COLLISION rule is
+enum PACK_ENTRY {
+	PACK_MODEL,
+	PACK_CONFIG
+};
+
+enum COLLISION_TARGET {
+	COLLISION_PAIR, // one named model
+	COLLISION_ANY, // * every entity
+	COLLISION_STATIC // every STATIC entity
+};
+
+// plain COLLISION is bound to ENTER | STAY, fires while touching
+enum COLLISION_EVENT {
+	EVENT_ENTER = 1,
+	EVENT_STAY = 2,
+	EVENT_EXIT = 4
+};
+
+// opcodes of the response program, operands follow in code
 enum PROCESSOR_INSTRUCTION {
-	PRINT, // one arg, const char *
-	NUM_PROCESSOR_KEYWORDS
+	PRINT, // string
+	LOAD_LEVEL, // string, level folder path
+	SET_POSITION, // model, number x, number y, number z
+	HIDE, // model
+	SHOW, // model
+	PLAY_ANIMATION, // model, animation index
+	NUM_PROCESSOR_KEYWORDS,
+	END_RESPONSE = NUM_PROCESSOR_KEYWORDS
+};
+
+// config keywords, same order as their word lists
+enum HAMMERCFG_KEYWORD {
+	HC_WIDTH,
+	HC_HEIGHT,
+	HC_TICKRATE,
+	HC_FPS,
+	HC_HEADLESS,
+	HC_TICKS,
+	HC_REPLAY,
+	HC_PROFILE,
+	HC_PROFILE_CSV,
+	HC_PRELOAD_BUDGET,
+	HC_BAKE,
+	HC_BENCH,
+	HC_BASE,
+	HC_THREADS,
+	NUM_HAMMERCFG_KEYWORDS
+};
+
+enum ROOT_KEYWORD {
+	ROOT_DEBUG,
+	ROOT_BACKGROUND,
+	ROOT_FONT,
+	ROOT_SELECTOR,
+	ROOT_NEW_GAME_START,
+	NUM_ROOT_KEYWORDS
+};
+
+enum RESOURCES_KEYWORD {
+	RES_HERO,
+	RES_MAP,
+	RES_ENTITY,
+	RES_STATIC,
+	RES_COUNT,
+	RES_POSE_CACHE,
+	NUM_RESOURCES_KEYWORDS
+};
+
+enum LOGIC_KEYWORD {
+	LOGIC_POSITION,
+	LOGIC_PRELOAD,
+	LOGIC_PLACE,
+	LOGIC_END,
+	LOGIC_DO,
+	LOGIC_COLLISION,
+	LOGIC_COLLISION_ENTER,
+	LOGIC_COLLISION_STAY,
+	LOGIC_COLLISION_EXIT,
+	NUM_LOGIC_KEYWORDS
 };
 
 /* for use within this engine every model must have index of its animations like this
@@ -256,7 +1389,8 @@ enum ANIMATION_POSITION {
 
 // globals
 static hed_state engine = { 	.window.title = TITLE,
-				.fps = FPS,
+				.timestep = {	.tickrate = TICKRATE,
+						.fps = FPS, },
 				.starting_level = "",
 				.current_level = NULL,
 				.menu = { 0 },
@@ -264,6 +1398,12 @@ static hed_state engine = { 	.window.title = TITLE,
 				.load_file = "",
 				.light = false,
 				.pause = false,
+				.headless = false,
+				.headless_ticks = 0,
+				.replay_file = "",
+				.bench = "",
+				.profiler = { 0 },
+				.preload = { .budget = (u64)PRELOAD_BUDGET * 1024 * 1024 },
 				
 				.controls = { 	.forward = KEY_W,
 				    		.backward = KEY_S,
@@ -277,100 +1417,288 @@ static hed_state engine = { 	.window.title = TITLE,
 				    		.toggle_pause = KEY_P,
 				    		.toggle_light = KEY_L,
 
-				    		.velocity = 0.05f,
-				    		.run_factor = 0.065f, },
+				    		.velocity = 1.5f,
+				    		.run_factor = 1.95f,
+				    		.turn_speed = 150.0f, },
 				};
 
-static char *Processor_Keywords[NUM_PROCESSOR_KEYWORDS][U8] = {
-	{ "PRINT" }
+static const char *Profile_Phases[NUM_PROFILE_PHASES] = {
+	"input", "animation", "bbox", "collisions", "events", "cull", "skin", "draw"
+};
+
+static const char *Processor_Keywords[NUM_PROCESSOR_KEYWORDS] = {
+	"PRINT", "LOAD_LEVEL", "SET_POSITION", "HIDE", "SHOW", "PLAY_ANIMATION"
+};
+
+static const char *Hammercfg_Keywords[NUM_HAMMERCFG_KEYWORDS] = {
+	"width", "height", "tickrate", "fps", "headless", "ticks", "replay",
+	"profile", "profile_csv", "preload_budget", "bake", "bench", "base",
+	"threads"
+};
+
+static const char *Root_Keywords[NUM_ROOT_KEYWORDS] = {
+	"DEBUG", "BACKGROUND", "FONT", "SELECTOR", "NEW_GAME_START"
+};
+
+static const char *Resources_Keywords[NUM_RESOURCES_KEYWORDS] = {
+	"HERO", "MAP", "ENTITY", "STATIC", "COUNT", "POSE_CACHE"
+};
+
+static const char *Logic_Keywords[NUM_LOGIC_KEYWORDS] = {
+	"POSITION", "PRELOAD", "PLACE", "END", "DO",
+	"COLLISION", "COLLISION_ENTER", "COLLISION_STAY", "COLLISION_EXIT"
 };
 
+// built in he_engine_run before any config is read, read-only afterwards
+static hed_keywords Processor_Table = { Processor_Keywords, NUM_PROCESSOR_KEYWORDS, 0, { 0 } };
+static hed_keywords Hammercfg_Table = { Hammercfg_Keywords, NUM_HAMMERCFG_KEYWORDS, 0, { 0 } };
+static hed_keywords Root_Table = { Root_Keywords, NUM_ROOT_KEYWORDS, 0, { 0 } };
+static hed_keywords Resources_Table = { Resources_Keywords, NUM_RESOURCES_KEYWORDS, 0, { 0 } };
+static hed_keywords Logic_Table = { Logic_Keywords, NUM_LOGIC_KEYWORDS, 0, { 0 } };
+
 // fdef
 u8
 he_engine_run(void) {
 
 	printf("Hammer Engine Running, Battlecruiser operational.\n");
 
-	if(he_engine_init_window()) {
-		printf("Window Initialization failed. Aborting.");
+	he_keywords_build(&Processor_Table);
+	he_keywords_build(&Hammercfg_Table);
+	he_keywords_build(&Root_Table);
+	he_keywords_build(&Resources_Table);
+	he_keywords_build(&Logic_Table);
+
+	if(he_engine_parse_hammercfg()) {
+		printf("HAMMERCFG parsing failed. Aborting.\n");
 		return 1;
 	}
 
-	if(he_engine_parse_base()) {
-		printf("Engine Base folder parsing failed. Aborting.");
+	if(he_jobs_init(engine.threads)) {
 		return 1;
 	}
 
-	if(he_engine_parse_root()) {
-		printf("Error occured while parsing root cfg.\n");
+	if(engine.bench[0] != 0) {
+		#ifdef HAMMER_BENCH
+		u8 failed = he_engine_run_bench(engine.bench);
+		#else
+		// benchmarks live in bench/bench.c, game builds leave them out
+		printf("Benchmarks are not in this build, build them with make bench.\n");
+		u8 failed = 1;
+		#endif
+
+		he_jobs_shutdown();
+		return failed;
+	}
+
+	// baking reads meshes and textures back through the GL context
+	if(engine.bake && engine.headless) {
+		printf("Baking needs a window, remove headless from HAMMERCFG.\n");
 		return 1;
 	}
 
-	if(he_engine_run_level(engine.starting_level)) {
-		printf("Level running error.\n");
+	if(engine.bake) {
+		SetConfigFlags(FLAG_WINDOW_HIDDEN);
+	}
+
+	if(!engine.headless && he_engine_init_window()) {
+		printf("Window Initialization failed. Aborting.");
 		return 1;
 	}
 
-	return 0;
-}
+	if(he_engine_parse_base()) {
+		printf("Engine Base folder parsing failed. Aborting.");
+		return 1;
+	}
 
-u8
-he_engine_init_window(void) {
+	if(engine.bake) {
+		return he_pack_bake();
+	}
 
-	if(access(HAMMERCFG, F_OK) == 0) {
-		FILE *fp = fopen(HAMMERCFG, "r");
-		char tmp[U6];
+	// no pack is fine, everything loads from media
+	(void)he_pack_open();
 
-		if(fp == NULL) {
-			printf("HAMMERCFG failed to open, using default values.\n");
-			engine.window.width = 800;
-			engine.window.height = 600;
-		}
+	if(he_engine_parse_root()) {
+		printf("Error occured while parsing root cfg.\n");
+		return 1;
+	}
 
-		#define ff fscanf(fp, "%60s", tmp)
-		while(ff == 1) {
-			if(strcmp(tmp, "width") == 0) {
-				ff;
-				engine.window.width = atoi(tmp);
-				continue;
-			}
+	if(engine.replay_file[0] != 0 && he_engine_load_replay(engine.replay_file)) {
+		printf("Input replay %s cannot be loaded.\n", engine.replay_file);
+		return 1;
+	}
 
-			else if(strcmp(tmp, "height") == 0) {
-				ff;
-				engine.window.height = atoi(tmp);
-				continue;
-			}
+	// the last level played is picked up again, replays and headless runs always start fresh
+	if(!engine.headless && engine.replay_file[0] == 0 && access(engine.config.save, F_OK) == 0 &&
+	he_engine_load_game(engine.config.save)) {
+		printf("Save file %s is unusable, starting a new game.\n", engine.config.save);
+	}
 
-			if(strcmp(tmp, "base") == 0) {
-				ff;
-				(void)snprintf(engine.config.base, sizeof(engine.config.base),
-				"%s", tmp);
-				continue;
-			}
+	char level[U8];
+	(void)snprintf(level, sizeof(level),
+	"%s", engine.starting_level);
 
-			else {
-				printf("Syntax error in HAMMERCFG.");
-				return 1;
-			}
+	// LOAD_LEVEL ends a level and names the one to run next
+	while(1) {
+		if(engine.headless && he_engine_run_headless(level)) {
+			printf("Headless level running error.\n");
+			return 1;
 		}
 
-		fclose(fp);
+		if(!engine.headless && he_engine_run_level(level)) {
+			printf("Level running error.\n");
+			return 1;
+		}
+
+		if(engine.next_level[0] == 0) {
+			break;
+		}
+
+		(void)snprintf(level, sizeof(level),
+		"%s", engine.next_level);
+		engine.next_level[0] = 0;
 	}
 
-	else {
+	// nothing references assets anymore
+	he_engine_release_preload();
+	he_engine_collect_assets();
+
+	if(engine.instancing.id != 0) {
+		UnloadShader(engine.instancing);
+	}
+
+	he_pack_close();
+	free(engine.index.assets);
+	he_jobs_shutdown();
+
+	return 0;
+}
+
+u8
+he_engine_parse_hammercfg(void) {
+
+	hed_lexer lex;
+
+	if(access(HAMMERCFG, F_OK) != 0 || he_lex_open(&lex, HAMMERCFG)) {
 		printf("HAMMERCFG failed to open, using default settings.\n");
 		engine.window.width = 800;
 		engine.window.height = 600;
 		return 1;
 	}
 
+	hed_token tok, arg;
+	u8 failed = 0;
+
+	while(!failed && he_lex_next(&lex, &tok)) {
+		int key = he_keywords_find(&Hammercfg_Table, &tok);
+
+		// flags take no value, everything else takes one
+		if(key != HC_HEADLESS && key != HC_PROFILE && key != HC_BAKE && key >= 0 &&
+		he_lex_expect(&lex, &arg, "a value")) {
+			failed = 1;
+			break;
+		}
+
+		int value = 0;
+
+		switch(key) {
+			case HC_WIDTH:
+				failed = he_lex_int(&lex, &arg, &value);
+				engine.window.width = value;
+			break;
+
+			case HC_HEIGHT:
+				failed = he_lex_int(&lex, &arg, &value);
+				engine.window.height = value;
+			break;
+
+			case HC_TICKRATE:
+				failed = he_lex_int(&lex, &arg, &value);
+				engine.timestep.tickrate = value;
+
+				if(!failed && engine.timestep.tickrate == 0) {
+					printf("Tickrate in HAMMERCFG must be greater than 0.\n");
+					failed = 1;
+				}
+			break;
+
+			case HC_FPS:
+				failed = he_lex_int(&lex, &arg, &value);
+				engine.timestep.fps = value;
+			break;
+
+			case HC_HEADLESS:
+				engine.headless = true;
+			break;
+
+			case HC_TICKS:
+				failed = he_lex_int(&lex, &arg, &value);
+				engine.headless_ticks = value;
+			break;
+
+			case HC_REPLAY:
+				failed = he_lex_copy(&lex, &arg, engine.replay_file, sizeof(engine.replay_file));
+			break;
+
+			case HC_PROFILE:
+				engine.profiler.enabled = true;
+			break;
+
+			case HC_PRELOAD_BUDGET:
+				failed = he_lex_int(&lex, &arg, &value);
+				engine.preload.budget = (u64)value * 1024 * 1024;
+			break;
+
+			case HC_BAKE:
+				engine.bake = true;
+			break;
+
+			case HC_BENCH:
+				failed = he_lex_copy(&lex, &arg, engine.bench, sizeof(engine.bench));
+			break;
+
+			case HC_PROFILE_CSV:
+				engine.profiler.enabled = true;
+				failed = he_lex_copy(&lex, &arg, engine.profiler.csv, sizeof(engine.profiler.csv));
+			break;
+
+			case HC_BASE:
+				failed = he_lex_copy(&lex, &arg, engine.config.base, sizeof(engine.config.base));
+			break;
+
+			case HC_THREADS:
+				failed = he_lex_int(&lex, &arg, &value);
+				engine.threads = value < 0 ? 0 : value;
+			break;
+
+			default:
+				he_lex_error(&lex, &tok, "syntax error in HAMMERCFG, '%.*s' not recognized",
+				(int)tok.len, tok.str);
+				failed = 1;
+			break;
+		}
+	}
+
+	he_lex_close(&lex);
+
+	if(failed) {
+		return 1;
+	}
+
+	engine.timestep.dt = 1.0f / engine.timestep.tickrate;
+
+	return 0;
+}
+
+u8
+he_engine_init_window(void) {
+
 	// Raylib knows to spit out bunch of info.
 	SetTraceLogLevel(LOG_WARNING);
 
 	// Pop-up the window
 	InitWindow(engine.window.width, engine.window.height, engine.window.title);
 
-	SetTargetFPS(engine.fps);
+	SetTargetFPS(engine.timestep.fps);
 
 	// Setting up camera SH-like style.
 	engine.camera.position = (Vector3){ 0.0f, 5.0f, -7.0f };
@@ -390,846 +1718,8105 @@ he_engine_run_level(const char *level) {
 		return 1;
 	}
 
-	while(!WindowShouldClose()) {
+	// assets of the previous level and its preloads this one doesn't use
+	he_engine_release_preload();
+	he_engine_collect_assets();
+	he_engine_start_preload();
+
+	// every level reached is a checkpoint
+	if(engine.replay_file[0] == 0) {
+		(void)he_engine_save_game(engine.config.save);
+	}
+
+	// edited configs are applied while playing
+	if(engine.debug) {
+		he_engine_watch_level();
+	}
+
+	double previous = GetTime();
+	engine.timestep.accumulator = 0.0;
+	he_engine_store_transforms();
+
+	while(!WindowShouldClose() && engine.next_level[0] == 0) {
+		double now = GetTime();
+		double frame = now - previous;
+		previous = now;
+
+		if(frame > MAX_FRAME_TIME) {
+			frame = MAX_FRAME_TIME;
+		}
+
+		// pause is polled per frame, ticks may not run on every frame
+		if(IsKeyPressed(engine.controls.toggle_pause)) {
+			engine.pause = !engine.pause;
+		}
+
+		if(!engine.pause) {
+			engine.timestep.accumulator += frame;
+		}
+
+		if(engine.debug) {
+			he_engine_poll_level();
+		}
+
+		// run as many fixed ticks as elapsed time asks for, slow frames
+		// get more ticks instead of slowing the game down
+		while(engine.timestep.accumulator >= engine.timestep.dt) {
+			he_engine_store_transforms();
+			he_engine_tick(engine.timestep.dt);
+
+			engine.timestep.accumulator -= engine.timestep.dt;
+			engine.timestep.ticks++;
+		}
+
+		engine.timestep.alpha = engine.timestep.accumulator / engine.timestep.dt;
+
+		he_engine_stream_preload();
 
 		// render everything needed
 		he_engine_render();
+	}
+
+	he_engine_finish_preload();
+	he_engine_unwatch_level();
+	he_engine_profile_dump();
+	he_engine_cleanup_level();
+
+	return 0;
+}
+
+u8
+he_engine_run_headless(const char *level) {
+
+	if(he_engine_parse_level(level)) {
+		printf("Level parsing error.\n");
+		return 1;
+	}
+
+	he_engine_release_preload();
+	he_engine_collect_assets();
+	he_engine_start_preload();
+
+	// without a replay to end the run, run for a fixed amount of ticks
+	u32 max_ticks = engine.headless_ticks;
+	if(max_ticks == 0 && !engine.replay.active) {
+		max_ticks = HEADLESS_TICKS;
+	}
+
+	// no rendering, nothing to interpolate
+	engine.timestep.alpha = 1.0f;
+	engine.timestep.ticks = 0;
+
+	double start = he_engine_clock();
+
+	// unthrottled, as fast as the cpu goes
+	while((max_ticks == 0 || engine.timestep.ticks < max_ticks) && engine.next_level[0] == 0) {
+		if(max_ticks == 0 && engine.replay.finished) {
+			break;
+		}
 
-		// input handling
-		he_engine_handle_input();
+		he_engine_store_transforms();
+		he_engine_tick(engine.timestep.dt);
 
-		// check collisions
-		he_engine_check_collisions();
+		engine.timestep.ticks++;
 	}
 
+	double elapsed = he_engine_clock() - start;
+
+	printf("Headless run of %s: %llu ticks in %.3f s, %.0f ticks/s (%.1fx realtime).\n",
+	level, (unsigned long long)engine.timestep.ticks, elapsed,
+	elapsed > 0.0 ? engine.timestep.ticks / elapsed : 0.0,
+	elapsed > 0.0 ? engine.timestep.ticks * engine.timestep.dt / elapsed : 0.0);
+
+	he_engine_finish_preload();
+	he_engine_profile_dump();
 	he_engine_cleanup_level();
 
 	return 0;
 }
 
 void
-he_engine_handle_input(void) {
+he_engine_tick(float dt) {
+
+	// input handling
+	he_profile_begin(PROFILE_INPUT);
+	he_engine_handle_input(dt);
+	he_profile_end(PROFILE_INPUT);
+
+	// animation cursors
+	he_profile_begin(PROFILE_ANIMATION);
+	he_engine_update_animations(dt);
+	he_profile_end(PROFILE_ANIMATION);
+
+	// bounding boxes follow new positions
+	he_profile_begin(PROFILE_BBOX);
+	he_engine_update_bounds();
+	he_profile_end(PROFILE_BBOX);
+
+	// check collisions
+	he_profile_begin(PROFILE_COLLISIONS);
+	he_engine_check_collisions();
+	he_profile_end(PROFILE_COLLISIONS);
+
+	// responses to this tick's contact transitions, in one batch
+	he_profile_begin(PROFILE_EVENTS);
+	he_engine_dispatch_events();
+	he_profile_end(PROFILE_EVENTS);
+
+	// advance recorded input, if any
+	he_engine_replay_step();
+}
+
+void
+he_engine_handle_input(float dt) {
 	// if there is no input set HERO animation to IDLE
 	he_engine_switch_animation(
 		&engine.current_level->hero, IDLE);
 
 	float speed;
 
-	if(IsKeyDown(engine.controls.toggle_run)) {
+	if(he_engine_key_down(engine.controls.toggle_run)) {
 		speed = engine.controls.velocity + engine.controls.run_factor;
 	}
 
 	else {
 		speed = engine.controls.velocity;
 	}
+
+	speed *= dt;
+
+	hed_model *hero = &engine.current_level->hero;
+	float *angle = &engine.current_level->components.angle[HERO];
+	Vector3 move = { 0.0f, 0.0f, 0.0f };
 			
-	if(IsKeyDown(engine.controls.forward)) {
-		engine.current_level->hero.position.z += speed * cos(DEG2RAD * engine.current_level->hero.angle);
-		engine.current_level->hero.position.x += speed * sin(DEG2RAD * engine.current_level->hero.angle);
+	if(he_engine_key_down(engine.controls.forward)) {
+		move.z += speed * cos(DEG2RAD * *angle);
+		move.x += speed * sin(DEG2RAD * *angle);
 
-		he_engine_switch_animation(
-			&engine.current_level->hero, WALK);
+		he_engine_switch_animation(hero, WALK);
 	}
 
-	else if(IsKeyDown(engine.controls.backward)) {
-		engine.current_level->hero.position.z -= speed * cos(DEG2RAD * engine.current_level->hero.angle);
-		engine.current_level->hero.position.x -= speed * sin(DEG2RAD * engine.current_level->hero.angle);
+	else if(he_engine_key_down(engine.controls.backward)) {
+		move.z -= speed * cos(DEG2RAD * *angle);
+		move.x -= speed * sin(DEG2RAD * *angle);
 
-		he_engine_switch_animation(
-		&engine.current_level->hero, WALK);
+		he_engine_switch_animation(hero, WALK);
 	}
 
-	if(IsKeyDown(engine.controls.turn_left)) {
-		engine.current_level->hero.angle += 5.0f;
+	if(he_engine_key_down(engine.controls.turn_left)) {
+		*angle += engine.controls.turn_speed * dt;
 	}
 
-	else if(IsKeyDown(engine.controls.turn_right)) {
-		engine.current_level->hero.angle -= 5.0f;
+	else if(he_engine_key_down(engine.controls.turn_right)) {
+		*angle -= engine.controls.turn_speed * dt;
 	}
 
-	if(IsKeyDown(engine.controls.strafe_left)) {
-		engine.current_level->hero.position.x += speed;
+	if(he_engine_key_down(engine.controls.strafe_left)) {
+		move.x += speed;
 	}
 
-	else if(IsKeyDown(engine.controls.strafe_right)) {
-		engine.current_level->hero.position.x -= speed;
+	else if(he_engine_key_down(engine.controls.strafe_right)) {
+		move.x -= speed;
 	}
 
-	if(IsKeyPressed(engine.controls.toggle_pause)) {
-		engine.pause = true;
-	}
+	// resolved against map geometry
+	he_engine_move_hero(move);
 }
 
 void
 he_engine_check_collisions(void) {
-	for(size_t i = 0; i < engine.current_level->col_count; i++) {
-		if(CheckCollisionBoxes(*engine.current_level->col_one[i], *engine.current_level->col_two[i])) {
-			switch(engine.current_level->col_action_instruction[i]) {
-				case PRINT:
-					he_processor(2, PRINT, engine.current_level->col_action_arg1[i]);
-				break;
-			};
-		}
-	}
-}
 
-void
-he_engine_render(void) {
-	BeginDrawing();
+	hed_level *level = engine.current_level;
+	hed_pairs *pairs = &level->pairs;
+	const u8 *flags = level->components.flags;
 
-		if(engine.pause) {
-			if(IsKeyPressed(engine.controls.toggle_pause)) {
-				engine.pause = false;
-			}
+	// entities moved since last build
+	if(level->col_wildcards > 0 && level->grid.dirty) {
+		he_engine_build_grid();
+	}
 
-			ClearBackground(BLACK);
+	// gather every pair first, test them in one batch
+	pairs->count = 0;
 
-			goto PAUSE;
-		}
-			
-		ClearBackground(DARKBLUE);
-		BeginMode3D(engine.camera);
+	for(size_t i = 0; i < level->col_count; i++) {
 
-		if(engine.debug) {
-			DrawGrid(10.0f, 1.0f);
+		// hidden models don't touch anything
+		if(!(flags[level->col_one[i]] & MODEL_RENDER)) {
+			continue;
 		}
 
-		// drawing models, hero, map and entities.
-		he_engine_draw_model(&engine.current_level->hero);
-		he_engine_draw_model(&engine.current_level->map);
+		if(level->col_target[i] == COLLISION_PAIR) {
+			if(flags[level->col_two[i]] & MODEL_RENDER) {
+				he_engine_push_pair(pairs, i, level->col_one[i], level->col_two[i]);
+			}
 
-		// entities, TODO, compare entity types render accordingly
-		for(size_t i = 0; i < engine.current_level->entities_count; i++) {
-			he_engine_draw_model(&engine.current_level->entities[i]);
+			continue;
 		}
 
-		PAUSE:
-		EndMode3D();
+		// only entities near the first model, response fires for each one touched
+		BoundingBox box = {
+			{ level->boxes.min_x[level->col_one[i]], level->boxes.min_y[level->col_one[i]], level->boxes.min_z[level->col_one[i]] },
+			{ level->boxes.max_x[level->col_one[i]], level->boxes.max_y[level->col_one[i]], level->boxes.max_z[level->col_one[i]] }
+		};
 
-		if(engine.debug) {
-			DrawFPS(10.0f,10.0f);
-		}
-			
-	EndDrawing();
-}
+		u16 count = he_engine_grid_query(box);
 
-u8
-he_engine_parse_base(void) {
+		for(u16 j = 0; j < count; j++) {
+			u16 entity = level->grid.candidates[j];
 
-	// first count the number of levels
-	struct dirent *entry;
-	struct stat statbuf;
+			if(entity + ENTITY == level->col_one[i]) {
+				continue;
+			}
 
-	FILE *fp = NULL;
+			if(!(flags[entity + ENTITY] & MODEL_RENDER) ||
+			(level->col_target[i] == COLLISION_STATIC && level->entities[entity].entity_type != STATIC)) {
+				continue;
+			}
 
-	// checking for base folder correctness
-	if(access(engine.config.base, F_OK) == 0) {
-
-		// check i posix's opendir can access base levels folder
-		char levels_folder[U8] = { 0 };
-		(void)snprintf(levels_folder, sizeof(levels_folder),
-			"%s%s%s", engine.config.base, SEP, BASE_LEVELS);
-		
-		DIR *dir = opendir(levels_folder);
-		if(dir == NULL) {
-			printf("Unable to open base folder.\n");
-			return 1;
+			he_engine_push_pair(pairs, i, level->col_one[i], entity + ENTITY);
 		}
+	}
 
-		// if okay, attempts to read all folders
-		else {
-			while( (entry = readdir(dir)) != NULL ) {
+	// pairs are independent, slices of them run on the job threads
+	he_jobs_for(he_engine_overlap_range, level, pairs->count, JOB_PAIR_GRAIN);
 
-				// skip . and ..
-				if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+	he_engine_collision_events();
+}
 
-				char full_path[U8];
-				snprintf(full_path, sizeof(full_path),
-				"%s%s%s%s%s", engine.config.base, SEP, BASE_LEVELS, SEP, entry->d_name);
+void
+he_engine_collision_events(void) {
+
+	hed_level *level = engine.current_level;
+	hed_pairs *pairs = &level->pairs;
+	hed_events *events = &level->events;
+
+	// room for every pair touching at once
+	if(pairs->count > events->contact_capacity) {
+		u64 *contacts = realloc(events->contacts, pairs->count * sizeof(u64));
+		if(contacts != NULL) events->contacts = contacts;
+		u64 *current = realloc(events->current, pairs->count * sizeof(u64));
+		if(current != NULL) events->current = current;
+
+		if(contacts == NULL || current == NULL) {
+			printf("Out of memory for collision contacts.\n");
+			return;
+		}
 
-				// check if file is actually a folder
-				if( stat(full_path, &statbuf) == 0 && S_ISDIR(statbuf.st_mode) );
-				else {
-					printf("File %s is not a folder, put only levels inside levels folder.\n", full_path);
-					return 1;
-				}
-			}
+		events->contact_capacity = pairs->count;
+	}
 
-			closedir(dir);
+	u32 count = 0;
+	for(u32 i = 0; i < pairs->count; i++) {
+		if(pairs->hits[i]) {
+			events->current[count++] = (u64)pairs->rule[i] << 48 | (u64)pairs->a[i] << 24 | pairs->b[i];
 		}
+	}
 
-		(void)snprintf(engine.config.root, sizeof(engine.config.root),
-		"%s%s%s", engine.config.base, SEP, CFG_ROOT);
+	qsort(events->current, count, sizeof(u64), he_engine_compare_u64);
 
-		(void)snprintf(engine.config.resources, sizeof(engine.config.resources),
-		"%s%s%s", engine.config.base, SEP, BASE_MEDIA);
+	// merge sorted lists, only in previous is EXIT, only in current ENTER, both STAY
+	u32 i = 0, j = 0;
 
-		(void)snprintf(engine.config.level, sizeof(engine.config.level),
-		"%s%s%s", engine.config.base, SEP, BASE_LEVELS);
+	while(i < events->contact_count || j < count) {
+		if(j == count || (i < events->contact_count && events->contacts[i] < events->current[j])) {
+			he_engine_push_event(EVENT_EXIT, events->contacts[i++]);
+		}
 
-		if(access(engine.config.root, F_OK) != 0) {
-			printf("Base root config not found.\n");
-			return 1;
+		else if(i == events->contact_count || events->current[j] < events->contacts[i]) {
+			he_engine_push_event(EVENT_ENTER, events->current[j++]);
 		}
-	}
 
-	else {
-		printf("Base folder provided in HAMMERCFG cannot be opened. Aborting.");
-		return 1;
+		else {
+			he_engine_push_event(EVENT_STAY, events->current[j++]);
+			i++;
+		}
 	}
 
-	fclose(fp);
-	return 0;
+	u64 *previous = events->contacts;
+	events->contacts = events->current;
+	events->current = previous;
+	events->contact_count = count;
 }
 
-u8
-he_engine_parse_root(void) {
+void
+he_engine_push_event(u8 type, u64 key) {
 
-	FILE *fp = fopen(engine.config.root, "r");
+	hed_level *level = engine.current_level;
+	hed_events *events = &level->events;
+	u16 rule = key >> 48;
 
-	char tmp[U8];
-	#define ff fscanf(fp, "%60s", tmp)
+	// nobody listens to this transition
+	if(!(level->col_when[rule] & type)) {
+		return;
+	}
 
-	while(ff == 1) {
-		if(strcmp(tmp, "DEBUG") == 0) {
-			engine.debug = true;
-			continue;
+	if(events->count == events->capacity) {
+		u32 capacity = events->capacity ? events->capacity * 2 : COLLISION_EVENTS;
+		hed_event *queue = realloc(events->queue, capacity * sizeof(hed_event));
+
+		if(queue == NULL) {
+			printf("Collision event queue full, event dropped.\n");
+			return;
 		}
 
-		else if(strcmp(tmp, "BACKGROUND") == 0) {
-			ff;
+		events->queue = queue;
+		events->capacity = capacity;
+	}
 
-			char full_path[U8];
-			(void)snprintf(full_path, sizeof(full_path),
-			"%s%s%s%s%s", engine.config.base, SEP, BASE_MEDIA, SEP, tmp);
-				
-			if(access(full_path, F_OK) == 0) {
-				engine.menu.background_texture = LoadTexture(full_path);
-			}
+	hed_event *event = &events->queue[events->count++];
+	event->type = type;
+	event->rule = rule;
+	event->a = (key >> 24) & 0xFFFFFF;
+	event->b = key & 0xFFFFFF;
+}
 
-			else {
-				printf("Cannot open menu background image.");
-				return 1;
-			}
+void
+he_engine_dispatch_events(void) {
 
-			continue;
-		}
+	hed_events *events = &engine.current_level->events;
 
-		if(strcmp(tmp, "FONT") == 0) {
-			ff;
-			char path[U8];
-			(void)snprintf(path, sizeof(path),
-			"%s%s%s%s%s", engine.config.base, SEP, BASE_MEDIA, SEP, tmp);
-			
-			if(access(path, F_OK) == 0) {
-				engine.menu.button_font = LoadFontEx(path, 32, 0, 250);
-				engine.menu.text_font = LoadFontEx(path, 12, 0, 20);
-			}
+	for(u32 i = 0; i < events->count; i++) {
+		he_processor(&events->queue[i]);
+	}
 
-			else {
-				printf("Could not load font file %s.", tmp);
-				return 1;
-			}
+	events->count = 0;
+}
 
-			continue;
+u8
+he_engine_alloc_events(hed_events *events, u32 capacity) {
 
-		}
+	events->queue = malloc(capacity * sizeof(hed_event));
+	events->contacts = malloc(capacity * sizeof(u64));
+	events->current = malloc(capacity * sizeof(u64));
 
-		else if(strcmp(tmp, "SELECTOR") == 0) {
-			ff;
-			(void)snprintf(engine.menu.selector, sizeof(engine.menu.selector),
-			"%1s", tmp);
+	if(events->queue == NULL || events->contacts == NULL || events->current == NULL) {
+		printf("Out of memory for collision events.\n");
+		return 1;
+	}
 
-			continue;
-		}
+	events->capacity = capacity;
+	events->contact_capacity = capacity;
+	events->count = 0;
+	events->contact_count = 0;
 
-		if(strcmp(tmp, "NEW_GAME_START") == 0) {
-			ff;
+	return 0;
+}
 
-			char path[U8];
-			(void)snprintf(path, sizeof(path),
-			"%s%s%s", engine.config.level, SEP, tmp);
+int
+he_engine_compare_u64(const void *a, const void *b) {
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return (x > y) - (x < y);
+}
+
+void
+he_engine_push_pair(hed_pairs *pairs, u16 rule, u32 a, u32 b) {
+
+	if(pairs->count == pairs->capacity) {
+		u32 capacity = pairs->capacity ? pairs->capacity * 2 : 256;
+
+		u32 *pa = realloc(pairs->a, capacity * sizeof(u32));
+		if(pa != NULL) pairs->a = pa;
+		u32 *pb = realloc(pairs->b, capacity * sizeof(u32));
+		if(pb != NULL) pairs->b = pb;
+		u16 *pr = realloc(pairs->rule, capacity * sizeof(u16));
+		if(pr != NULL) pairs->rule = pr;
+		u8 *ph = realloc(pairs->hits, capacity);
+		if(ph != NULL) pairs->hits = ph;
+
+		if(pa == NULL || pb == NULL || pr == NULL || ph == NULL) {
+			printf("Out of memory for collision pairs, pair dropped.\n");
+			return;
+		}
+
+		pairs->capacity = capacity;
+	}
+
+	pairs->a[pairs->count] = a;
+	pairs->b[pairs->count] = b;
+	pairs->rule[pairs->count] = rule;
+	pairs->count++;
+}
+
+void
+he_engine_overlap_pairs(const hed_boxes *boxes, const u32 *a, const u32 *b, u32 count, u8 *hits) {
+
+	// hits[i] is 1 when boxes a[i] and b[i] overlap, borders touching count,
+	// same as CheckCollisionBoxes
+	u32 i = 0;
+
+#if defined(__AVX2__) && !defined(HAMMER_NO_SIMD)
+	for(; i + 8 <= count; i += 8) {
+		__m256i ia = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i ib = _mm256_loadu_si256((const __m256i *)(b + i));
+
+		__m256 overlap = _mm256_and_ps(
+			_mm256_cmp_ps(_mm256_i32gather_ps(boxes->min_x, ia, 4), _mm256_i32gather_ps(boxes->max_x, ib, 4), _CMP_LE_OQ),
+			_mm256_cmp_ps(_mm256_i32gather_ps(boxes->max_x, ia, 4), _mm256_i32gather_ps(boxes->min_x, ib, 4), _CMP_GE_OQ));
+
+		overlap = _mm256_and_ps(overlap, _mm256_and_ps(
+			_mm256_cmp_ps(_mm256_i32gather_ps(boxes->min_y, ia, 4), _mm256_i32gather_ps(boxes->max_y, ib, 4), _CMP_LE_OQ),
+			_mm256_cmp_ps(_mm256_i32gather_ps(boxes->max_y, ia, 4), _mm256_i32gather_ps(boxes->min_y, ib, 4), _CMP_GE_OQ)));
+
+		overlap = _mm256_and_ps(overlap, _mm256_and_ps(
+			_mm256_cmp_ps(_mm256_i32gather_ps(boxes->min_z, ia, 4), _mm256_i32gather_ps(boxes->max_z, ib, 4), _CMP_LE_OQ),
+			_mm256_cmp_ps(_mm256_i32gather_ps(boxes->max_z, ia, 4), _mm256_i32gather_ps(boxes->min_z, ib, 4), _CMP_GE_OQ)));
+
+		int mask = _mm256_movemask_ps(overlap);
+
+		for(u8 k = 0; k < 8; k++) {
+			hits[i + k] = (mask >> k) & 1;
+		}
+	}
+#elif defined(__SSE2__) && !defined(HAMMER_NO_SIMD)
+	// no gather before avx2, lanes are filled one by one
+	#define he_lanes(arr, idx) _mm_set_ps(arr[idx[i + 3]], arr[idx[i + 2]], arr[idx[i + 1]], arr[idx[i]])
+
+	for(; i + 4 <= count; i += 4) {
+		__m128 overlap = _mm_and_ps(
+			_mm_cmple_ps(he_lanes(boxes->min_x, a), he_lanes(boxes->max_x, b)),
+			_mm_cmpge_ps(he_lanes(boxes->max_x, a), he_lanes(boxes->min_x, b)));
+
+		overlap = _mm_and_ps(overlap, _mm_and_ps(
+			_mm_cmple_ps(he_lanes(boxes->min_y, a), he_lanes(boxes->max_y, b)),
+			_mm_cmpge_ps(he_lanes(boxes->max_y, a), he_lanes(boxes->min_y, b))));
+
+		overlap = _mm_and_ps(overlap, _mm_and_ps(
+			_mm_cmple_ps(he_lanes(boxes->min_z, a), he_lanes(boxes->max_z, b)),
+			_mm_cmpge_ps(he_lanes(boxes->max_z, a), he_lanes(boxes->min_z, b))));
+
+		int mask = _mm_movemask_ps(overlap);
+
+		hits[i] = mask & 1;
+		hits[i + 1] = (mask >> 1) & 1;
+		hits[i + 2] = (mask >> 2) & 1;
+		hits[i + 3] = (mask >> 3) & 1;
+	}
+
+	#undef he_lanes
+#endif
+
+	// tail, or everything without simd
+	for(; i < count; i++) {
+		u32 x = a[i], y = b[i];
+
+		hits[i] = boxes->min_x[x] <= boxes->max_x[y] && boxes->max_x[x] >= boxes->min_x[y] &&
+			boxes->min_y[x] <= boxes->max_y[y] && boxes->max_y[x] >= boxes->min_y[y] &&
+			boxes->min_z[x] <= boxes->max_z[y] && boxes->max_z[x] >= boxes->min_z[y];
+	}
+}
+
+void
+he_engine_overlap_range(void *arg, u32 first, u32 count) {
+
+	hed_level *level = arg;
+	hed_pairs *pairs = &level->pairs;
+
+	he_engine_overlap_pairs(&level->boxes, pairs->a + first, pairs->b + first, count, pairs->hits + first);
+}
+
+u8
+he_engine_alloc_boxes(hed_boxes *boxes, u32 count) {
+
+	// one block, six arrays
+	float *block = calloc(6 * (size_t)count, sizeof(float));
+	if(block == NULL) {
+		printf("Out of memory for %u collision boxes.\n", count);
+		return 1;
+	}
+
+	boxes->min_x = block;
+	boxes->min_y = block + count;
+	boxes->min_z = block + 2 * count;
+	boxes->max_x = block + 3 * count;
+	boxes->max_y = block + 4 * count;
+	boxes->max_z = block + 5 * count;
+	boxes->count = count;
+
+	return 0;
+}
+
+void
+he_engine_build_grid(void) {
+
+	hed_level *level = engine.current_level;
+	hed_grid *grid = &level->grid;
+	const BoundingBox *world = &level->components.world[ENTITY];
+	u16 n = level->entities_count;
+
+	grid->dirty = false;
+
+	if(n == 0) {
+		grid->item_count = 0;
+		grid->large_count = 0;
+		return;
+	}
+
+	// cell as big as an average entity, most entities then cover 1-8 cells
+	float extent = 0.0f;
+	for(u16 i = 0; i < n; i++) {
+		Vector3 size = Vector3Subtract(world[i].max, world[i].min);
+		extent += fmaxf(size.x, fmaxf(size.y, size.z));
+	}
+
+	grid->cell = fmaxf(extent / n, GRID_MIN_CELL);
+
+	// twice as many buckets as entities keeps chains short
+	u32 buckets = 16;
+	while(buckets < 2u * n) {
+		buckets <<= 1;
+	}
+
+	if(buckets != grid->bucket_count || grid->stamp == NULL) {
+		free(grid->bucket_start);
+		free(grid->bucket_fill);
+		free(grid->large);
+		free(grid->stamp);
+		free(grid->candidates);
+
+		grid->bucket_count = buckets;
+		grid->bucket_start = malloc((buckets + 1) * sizeof(u32));
+		grid->bucket_fill = malloc(buckets * sizeof(u32));
+		grid->large = malloc(buckets * sizeof(u16));
+		grid->stamp = calloc(buckets, sizeof(u32));
+		grid->candidates = malloc(buckets * sizeof(u16));
+		grid->query = 0;
+	}
+
+	(void)memset(grid->bucket_start, 0, (buckets + 1) * sizeof(u32));
+	grid->large_count = 0;
+
+	// two passes, count items per bucket then place them
+	for(u8 pass = 0; pass < 2; pass++) {
+		for(u16 i = 0; i < n; i++) {
+			int lo[3], hi[3];
+
+			if(!he_engine_grid_range(grid, world[i], GRID_MAX_CELLS, lo, hi)) {
+				if(pass == 0) {
+					grid->large[grid->large_count++] = i;
+				}
+
+				continue;
+			}
+
+			for(int x = lo[0]; x <= hi[0]; x++) {
+				for(int y = lo[1]; y <= hi[1]; y++) {
+					for(int z = lo[2]; z <= hi[2]; z++) {
+						u32 bucket = he_engine_grid_hash(x, y, z) & (buckets - 1);
+
+						if(pass == 0) {
+							grid->bucket_start[bucket + 1]++;
+						}
+
+						else {
+							grid->items[grid->bucket_fill[bucket]++] = i;
+						}
+					}
+				}
+			}
+		}
+
+		if(pass == 0) {
+			for(u32 b = 0; b < buckets; b++) {
+				grid->bucket_start[b + 1] += grid->bucket_start[b];
+			}
+
+			(void)memcpy(grid->bucket_fill, grid->bucket_start, buckets * sizeof(u32));
+
+			if(grid->bucket_start[buckets] > grid->item_count || grid->items == NULL) {
+				free(grid->items);
+				grid->items = malloc((grid->bucket_start[buckets] + 1) * sizeof(u16));
+			}
+
+			grid->item_count = grid->bucket_start[buckets];
+		}
+	}
+}
+
+u16
+he_engine_grid_query(BoundingBox box) {
+
+	// fills grid.candidates with entities sharing a bucket with box, each once
+	hed_grid *grid = &engine.current_level->grid;
+	u16 count = 0;
+
+	if(grid->stamp == NULL) {
+		return 0;
+	}
+
+	grid->query++;
+
+	for(u16 i = 0; i < grid->large_count; i++) {
+		grid->stamp[grid->large[i]] = grid->query;
+		grid->candidates[count++] = grid->large[i];
+	}
+
+	// a box covering more cells than there are buckets would visit buckets several times,
+	// every placed entity is taken once instead
+	int lo[3], hi[3];
+
+	if(!he_engine_grid_range(grid, box, grid->bucket_count, lo, hi)) {
+		for(u32 k = 0; k < grid->item_count; k++) {
+			u16 entity = grid->items[k];
+
+			if(grid->stamp[entity] != grid->query) {
+				grid->stamp[entity] = grid->query;
+				grid->candidates[count++] = entity;
+			}
+		}
+
+		return count;
+	}
+
+	for(int x = lo[0]; x <= hi[0]; x++) {
+		for(int y = lo[1]; y <= hi[1]; y++) {
+			for(int z = lo[2]; z <= hi[2]; z++) {
+				u32 bucket = he_engine_grid_hash(x, y, z) & (grid->bucket_count - 1);
+
+				for(u32 k = grid->bucket_start[bucket]; k < grid->bucket_start[bucket + 1]; k++) {
+					u16 entity = grid->items[k];
+
+					if(grid->stamp[entity] != grid->query) {
+						grid->stamp[entity] = grid->query;
+						grid->candidates[count++] = entity;
+					}
+				}
+			}
+		}
+	}
+
+	return count;
+}
+
+u32
+he_engine_grid_hash(int x, int y, int z) {
+	return ((u32)x * 73856093u) ^ ((u32)y * 19349663u) ^ ((u32)z * 83492791u);
+}
+
+bool
+he_engine_grid_range(const hed_grid *grid, BoundingBox box, float limit, int *lo, int *hi) {
+
+	// cells box covers, false when that's more than limit or too far out to index,
+	// counted in floats so huge or NaN boxes can't overflow
+	const float *min = &box.min.x, *max = &box.max.x;
+	float span = 1.0f;
+
+	for(int axis = 0; axis < 3; axis++) {
+		float first = floorf(min[axis] / grid->cell), last = floorf(max[axis] / grid->cell);
+
+		if(!(fabsf(first) <= GRID_MAX_COORD && fabsf(last) <= GRID_MAX_COORD)) {
+			return false;
+		}
+
+		lo[axis] = (int)first;
+		hi[axis] = (int)last;
+		span *= last - first + 1.0f;
+	}
+
+	return span <= limit;
+}
+
+void
+he_engine_render(void) {
+	BeginDrawing();
+
+		if(engine.pause) {
+			ClearBackground(BLACK);
+
+			goto PAUSE;
+		}
+			
+		ClearBackground(DARKBLUE);
+		BeginMode3D(engine.camera);
+
+		if(engine.debug) {
+			DrawGrid(10.0f, 1.0f);
+		}
+
+		// visibility of every model before anything is drawn
+		he_profile_begin(PROFILE_CULL);
+		he_engine_update_frustum();
+		he_engine_cull_models();
+		he_profile_end(PROFILE_CULL);
+
+		// animated models that are drawn get their vertices on the job threads
+		he_profile_begin(PROFILE_SKIN);
+		he_engine_skin_models();
+		he_profile_end(PROFILE_SKIN);
+
+		he_profile_begin(PROFILE_DRAW);
+
+		engine.drawn = 0;
+		engine.culled = 0;
+		engine.draw_calls = 0;
+
+		// drawing models, hero, map and entities.
+		he_engine_draw_model(&engine.current_level->hero);
+		he_engine_draw_model(&engine.current_level->map);
+
+		// entities, TODO, compare entity types render accordingly
+		for(size_t i = 0; i < engine.current_level->entities_count; i++) {
+			if(engine.current_level->entities[i].batch == NO_BATCH) {
+				he_engine_draw_model(&engine.current_level->entities[i]);
+			}
+		}
+
+		for(u16 i = 0; i < engine.current_level->batches.count; i++) {
+			he_engine_draw_batch(&engine.current_level->batches.items[i]);
+		}
+
+		he_profile_end(PROFILE_DRAW);
+
+		PAUSE:
+		EndMode3D();
+
+		if(engine.debug) {
+			DrawFPS(10.0f,10.0f);
+			he_engine_profile_draw();
+
+			DrawText(TextFormat("models drawn %u culled %u draw calls %u",
+			engine.drawn, engine.culled, engine.draw_calls),
+			10, 35 + 12 * (NUM_PROFILE_PHASES + 1) + 6, 10, RAYWHITE);
+		}
 			
-			if(access(path, F_OK) == 0) {
-				(void)snprintf(engine.starting_level, sizeof(engine.starting_level),
-				"%s", path);
+	EndDrawing();
+}
+
+bool
+he_engine_key_down(int key) {
+
+	if(engine.replay.active) {
+		if(engine.replay.finished) {
+			return false;
+		}
+
+		hed_replay_segment *segment = &engine.replay.segments[engine.replay.current];
+
+		for(u8 i = 0; i < segment->key_count; i++) {
+			if(segment->keys[i] == key) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	if(engine.headless) {
+		return false;
+	}
+
+	return IsKeyDown(key);
+}
+
+u8
+he_engine_load_replay(const char *file) {
+
+	// every line is number of ticks followed by controls held for them
+	// EX: 30 forward toggle_run
+
+	const struct { const char *name; int key; } controls[] = {
+		{ "forward", engine.controls.forward },
+		{ "backward", engine.controls.backward },
+		{ "strafe_left", engine.controls.strafe_left },
+		{ "strafe_right", engine.controls.strafe_right },
+		{ "turn_left", engine.controls.turn_left },
+		{ "turn_right", engine.controls.turn_right },
+		{ "action", engine.controls.action },
+		{ "toggle_run", engine.controls.toggle_run },
+	};
+
+	FILE *fp = fopen(file, "r");
+	if(fp == NULL) {
+		printf("Cannot open replay file %s.\n", file);
+		return 1;
+	}
+
+	u32 capacity = 0;
+	char line[U8];
+
+	while(fgets(line, sizeof(line), fp) != NULL) {
+		char *token = strtok(line, " \t\r\n");
+
+		// empty line
+		if(token == NULL) {
+			continue;
+		}
+
+		if(engine.replay.count == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			hed_replay_segment *grown = realloc(engine.replay.segments,
+				capacity * sizeof(hed_replay_segment));
+
+			if(grown == NULL) {
+				printf("Out of memory while loading replay.\n");
+				fclose(fp);
+				return 1;
+			}
+
+			engine.replay.segments = grown;
+		}
+
+		hed_replay_segment *segment = &engine.replay.segments[engine.replay.count];
+		(void)memset(segment, 0, sizeof(*segment));
+		segment->ticks = strtoul(token, NULL, 10);
+
+		while( (token = strtok(NULL, " \t\r\n")) != NULL ) {
+			size_t i;
+			for(i = 0; i < sizeof(controls) / sizeof(controls[0]); i++) {
+				if(strcmp(token, controls[i].name) == 0) {
+					break;
+				}
+			}
+
+			if(i == sizeof(controls) / sizeof(controls[0])) {
+				printf("Syntax error in replay, unknown control '%s'.\n", token);
+				fclose(fp);
+				return 1;
+			}
+
+			if(segment->key_count == MAX_REPLAY_KEYS) {
+				printf("Replay line holds more than %d controls.\n", MAX_REPLAY_KEYS);
+				fclose(fp);
+				return 1;
+			}
+
+			segment->keys[segment->key_count++] = controls[i].key;
+		}
+
+		if(segment->ticks > 0) {
+			engine.replay.count++;
+		}
+	}
+
+	fclose(fp);
+
+	engine.replay.active = true;
+	engine.replay.finished = engine.replay.count == 0;
+
+	return 0;
+}
+
+void
+he_engine_replay_step(void) {
+
+	if(!engine.replay.active || engine.replay.finished) {
+		return;
+	}
+
+	engine.replay.elapsed++;
+
+	if(engine.replay.elapsed == engine.replay.segments[engine.replay.current].ticks) {
+		engine.replay.elapsed = 0;
+		engine.replay.current++;
+
+		if(engine.replay.current == engine.replay.count) {
+			engine.replay.finished = true;
+		}
+	}
+}
+
+double
+he_engine_clock(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void
+he_engine_profile_sample(int phase, double seconds) {
+
+	hed_profiler *profiler = &engine.profiler;
+
+	profiler->samples[phase][profiler->head[phase]] = seconds * 1000.0;
+	profiler->head[phase] = (profiler->head[phase] + 1) % PROFILE_SAMPLES;
+
+	if(profiler->count[phase] < PROFILE_SAMPLES) {
+		profiler->count[phase]++;
+	}
+}
+
+u16
+he_engine_profile_stats(int phase, float *stats) {
+
+	// stats gets p50, p95, p99 and max in ms, returns number of samples used
+	float sorted[PROFILE_SAMPLES];
+	u16 count = engine.profiler.count[phase];
+
+	if(count == 0) {
+		(void)memset(stats, 0, 4 * sizeof(float));
+		return 0;
+	}
+
+	(void)memcpy(sorted, engine.profiler.samples[phase], count * sizeof(float));
+	qsort(sorted, count, sizeof(float), he_engine_compare_float);
+
+	stats[0] = sorted[(count - 1) * 50 / 100];
+	stats[1] = sorted[(count - 1) * 95 / 100];
+	stats[2] = sorted[(count - 1) * 99 / 100];
+	stats[3] = sorted[count - 1];
+
+	return count;
+}
+
+void
+he_engine_profile_draw(void) {
+
+	if(!engine.profiler.enabled) {
+		return;
+	}
+
+	int y = 35;
+	DrawText("phase        p50    p95    p99    max  (ms)", 10, y, 10, RAYWHITE);
+
+	for(int i = 0; i < NUM_PROFILE_PHASES; i++) {
+		float stats[4];
+		he_engine_profile_stats(i, stats);
+
+		y += 12;
+		DrawText(TextFormat("%-10s %6.2f %6.2f %6.2f %6.2f", Profile_Phases[i],
+		stats[0], stats[1], stats[2], stats[3]), 10, y, 10, RAYWHITE);
+	}
+}
+
+void
+he_engine_profile_dump(void) {
+
+	if(!engine.profiler.enabled) {
+		return;
+	}
+
+	printf("phase        p50    p95    p99    max  (ms, last %d samples)\n", PROFILE_SAMPLES);
+
+	for(int i = 0; i < NUM_PROFILE_PHASES; i++) {
+		float stats[4];
+		if(he_engine_profile_stats(i, stats) > 0) {
+			printf("%-10s %6.3f %6.3f %6.3f %6.3f\n", Profile_Phases[i],
+			stats[0], stats[1], stats[2], stats[3]);
+		}
+	}
+
+	if(engine.profiler.csv[0] == 0) {
+		return;
+	}
+
+	FILE *fp = fopen(engine.profiler.csv, "w");
+	if(fp == NULL) {
+		printf("Cannot write profile to %s.\n", engine.profiler.csv);
+		return;
+	}
+
+	// raw samples oldest first, one row each
+	fprintf(fp, "phase,sample,ms\n");
+
+	for(int i = 0; i < NUM_PROFILE_PHASES; i++) {
+		u16 count = engine.profiler.count[i];
+		u16 first = (engine.profiler.head[i] + PROFILE_SAMPLES - count) % PROFILE_SAMPLES;
+
+		for(u16 j = 0; j < count; j++) {
+			fprintf(fp, "%s,%u,%.4f\n", Profile_Phases[i], j,
+			engine.profiler.samples[i][(first + j) % PROFILE_SAMPLES]);
+		}
+	}
+
+	fclose(fp);
+}
+
+int
+he_engine_compare_float(const void *a, const void *b) {
+	float x = *(const float *)a, y = *(const float *)b;
+
+	return (x > y) - (x < y);
+}
+
+u8
+he_engine_parse_base(void) {
+
+	// checking for base folder correctness
+	if(access(engine.config.base, F_OK) != 0) {
+		printf("Base folder provided in HAMMERCFG cannot be opened. Aborting.");
+		return 1;
+	}
+
+	(void)snprintf(engine.config.root, sizeof(engine.config.root),
+	"%s%s%s", engine.config.base, SEP, CFG_ROOT);
+
+	(void)snprintf(engine.config.resources, sizeof(engine.config.resources),
+	"%s%s%s", engine.config.base, SEP, BASE_MEDIA);
+
+	(void)snprintf(engine.config.level, sizeof(engine.config.level),
+	"%s%s%s", engine.config.base, SEP, BASE_LEVELS);
+
+	(void)snprintf(engine.config.save, sizeof(engine.config.save),
+	"%s%s%s", engine.config.base, SEP, BASE_SAVE);
+
+	if(access(engine.config.root, F_OK) != 0) {
+		printf("Base root config not found.\n");
+		return 1;
+	}
+
+	// levels folder is only read again when something was added or removed
+	return he_index_load();
+}
+
+u8
+he_engine_parse_root(void) {
+
+	hed_lexer lex;
+
+	if(he_lex_open(&lex, engine.config.root)) {
+		printf("Cannot open %s.\n", engine.config.root);
+		return 1;
+	}
+
+	hed_token tok, arg;
+	char tmp[U8], path[U8];
+	u8 failed = 0;
+
+	while(!failed && he_lex_next(&lex, &tok)) {
+		int key = he_keywords_find(&Root_Table, &tok);
+
+		if(key > ROOT_DEBUG && (he_lex_expect(&lex, &arg, "an argument") ||
+		he_lex_copy(&lex, &arg, tmp, sizeof(tmp)))) {
+			failed = 1;
+			break;
+		}
+
+		switch(key) {
+			case ROOT_DEBUG:
+				engine.debug = true;
+
+				// overlay needs samples
+				engine.profiler.enabled = true;
+			break;
+
+			case ROOT_BACKGROUND:
+				(void)snprintf(path, sizeof(path),
+				"%s%s%s%s%s", engine.config.base, SEP, BASE_MEDIA, SEP, tmp);
+
+				if(access(path, F_OK) == 0) {
+					if(!engine.headless) {
+						engine.menu.background_texture = LoadTexture(path);
+					}
+				}
+
+				else {
+					he_lex_error(&lex, &arg, "cannot open menu background image %s", tmp);
+					failed = 1;
+				}
+			break;
+
+			case ROOT_FONT:
+				(void)snprintf(path, sizeof(path),
+				"%s%s%s%s%s", engine.config.base, SEP, BASE_MEDIA, SEP, tmp);
+
+				if(access(path, F_OK) == 0) {
+					if(!engine.headless) {
+						engine.menu.button_font = LoadFontEx(path, 32, 0, 250);
+						engine.menu.text_font = LoadFontEx(path, 12, 0, 20);
+					}
+				}
+
+				else {
+					he_lex_error(&lex, &arg, "could not load font file %s", tmp);
+					failed = 1;
+				}
+			break;
+
+			case ROOT_SELECTOR:
+				(void)snprintf(engine.menu.selector, sizeof(engine.menu.selector),
+				"%1s", tmp);
+			break;
+
+			case ROOT_NEW_GAME_START:
+				(void)snprintf(path, sizeof(path),
+				"%s%s%s", engine.config.level, SEP, tmp);
+
+				if(he_index_find(path) != NULL) {
+					(void)snprintf(engine.starting_level, sizeof(engine.starting_level),
+					"%s", path);
+				}
+
+				else {
+					he_lex_error(&lex, &arg, "level %s doesn't exist", tmp);
+					failed = 1;
+				}
+			break;
+
+			default:
+				he_lex_error(&lex, &tok, "syntax error in cfg.root, instruction '%.*s' not recognized",
+				(int)tok.len, tok.str);
+				failed = 1;
+			break;
+		}
+	}
+
+	he_lex_close(&lex);
+	return failed;
+}
+
+u8
+he_engine_parse_level(const char *path) {
+
+	static hed_level level;
+
+	char logic[U8];
+	(void)snprintf(logic, sizeof(logic),
+	"%s%s%s", path, SEP, CFG_printfIC);
+
+	// every file the level names exists, before any of them is loaded
+	hed_index_level *entry = he_index_find(path);
+
+	if(entry == NULL || he_index_check(entry)) {
+		printf("Level %s cannot be loaded.\n", path);
+		return 1;
+	}
+
+	// a PRELOAD level was read on the preload thread, its models only wait for upload
+	hed_level *parsed = he_engine_take_preload(entry);
+
+	engine.current_level = &level;
+
+	if(parsed != NULL) {
+		level = *parsed;
+		free(parsed);
+
+		if(he_engine_load_assets()) {
+			return 1;
+		}
+	}
+
+	// every file of the level at once, spread over the worker threads. Logic checks
+	// animations against the models so it waits for them
+	else {
+		he_index_prefetch(entry);
+
+		if(he_engine_read_level(&level, path) || he_engine_load_assets() || he_engine_parse_logic(&level, logic)) {
+			return 1;
+		}
+	}
+
+	he_engine_bind_model(&level.hero);
+	he_engine_bind_model(&level.map);
+
+	for(u16 i = 0; i < level.entities_count; i++) {
+		he_engine_bind_model(&level.entities[i]);
+	}
+
+	// no BVH means map queries miss, a headless run has nothing else to collide with
+	if(level.map.asset != NULL && he_bvh_load_map(&level.map_bvh, level.map.asset->path, &level.map.asset->model) &&
+	engine.headless) {
+		printf("Headless run needs the map BVH of %s. Aborting.\n", level.map.asset->path);
+		return 1;
+	}
+
+	printf("Level %s memory: %.1f of %.1f KB arena in %u blocks, %u entities, %u rules.\n", path,
+	level.arena.used / 1024.0, level.arena.reserved / 1024.0, level.arena.blocks, level.entities_count, level.col_count);
+
+	// headless never draws
+	if(!engine.headless && he_engine_build_batches()) {
+		return 1;
+	}
+
+	return 0;
+}
+
+u8
+he_engine_read_level(hed_level *level, const char *path) {
+
+	// everything of a level that doesn't need its models decoded, into its own arena.
+	// Doesn't touch engine.current_level, the preload thread reads the next level with it
+	char resources[U8], logic[U8];
+
+	(void)snprintf(resources, sizeof(resources),
+	"%s%s%s", path, SEP, CFG_RESOURCES);
+
+	(void)snprintf(logic, sizeof(logic),
+	"%s%s%s", path, SEP, CFG_printfIC);
+
+	(void)snprintf(level->name, sizeof(level->name),
+	"%s", path);
+
+	// parsing resources
+	if(access(resources, F_OK) != 0 || access(logic, F_OK) != 0) {
+		printf("Cannot open config file for resources or logic.\n");
+		return 1;
+	}
+
+	// one counting pass, then everything the configs name fits in one block
+	u32 entities, rules;
+	size_t estimate = he_engine_size_level(resources, logic, &entities, &rules);
+
+	if(he_arena_init(&level->arena, estimate) || he_engine_grow_entities(level, entities) ||
+	he_engine_grow_rules(level, rules)) {
+		return 1;
+	}
+
+	if(he_engine_parse_resources(level, resources)) {
+		return 1;
+	}
+
+	// model ids match he_engine_check_model, boxes and components live in level arrays
+	level->hero.id = HERO;
+	level->map.id = MAP;
+
+	for(u16 i = 0; i < level->entities_count; i++) {
+		level->entities[i].id = ENTITY + i;
+	}
+
+	if(he_engine_alloc_components(level, ENTITY + level->entities_count)) {
+		return 1;
+	}
+
+	if(he_engine_alloc_boxes(&level->boxes, ENTITY + level->entities_count) || he_engine_build_names(level)) {
+		return 1;
+	}
+
+	return he_engine_alloc_events(&level->events, COLLISION_EVENTS);
+}
+
+size_t
+he_engine_level_bytes(const hed_level *level) {
+
+	// arena blocks and the arrays malloc'd next to them
+	return level->arena.reserved + (size_t)level->boxes.count * 6 * sizeof(float) +
+	level->events.capacity * sizeof(hed_event) + level->events.contact_capacity * 2 * sizeof(u64);
+}
+
+int64_t
+he_engine_level_stamp(const char *path) {
+
+	// both configs as they are now, a level read before they were edited is read again
+	char resources[U8], logic[U8];
+	struct stat a, b;
+
+	(void)snprintf(resources, sizeof(resources),
+	"%s%s%s", path, SEP, CFG_RESOURCES);
+
+	(void)snprintf(logic, sizeof(logic),
+	"%s%s%s", path, SEP, CFG_printfIC);
+
+	if(stat(resources, &a) != 0 || stat(logic, &b) != 0) {
+		return -1;
+	}
+
+	return he_mtime(a) + he_mtime(b) + (int64_t)a.st_size + (int64_t)b.st_size;
+}
+
+size_t
+he_engine_size_level(const char *resources, const char *logic, u32 *entities, u32 *rules) {
+
+	// counting pass over both configs, errors are left to the real parse
+	hed_lexer lex;
+	hed_token tok;
+	size_t names = 0, program = 0;
+
+	*entities = 0;
+	*rules = 0;
+
+	if(he_lex_open(&lex, resources) == 0) {
+		while(he_lex_next(&lex, &tok)) {
+			int key = he_keywords_find(&Resources_Table, &tok);
+
+			// entities name themselves by their asset path, only hero and map copy theirs
+			if((key == RES_HERO || key == RES_MAP) && he_lex_inline(&lex, &tok)) {
+				names += he_arena_round(tok.len + 1);
+			}
+
+			*entities += key == RES_ENTITY;
+
+			if(key == RES_COUNT && he_lex_inline(&lex, &tok)) {
+				char tmp[16];
+				int count = 0;
+
+				if(tok.len < sizeof(tmp)) {
+					(void)memcpy(tmp, tok.str, tok.len);
+					tmp[tok.len] = 0;
+					count = atoi(tmp);
+				}
+
+				*entities += count > 1 ? count - 1 : 0;
+			}
+		}
+
+		he_lex_close(&lex);
+	}
+
+	if(he_lex_open(&lex, logic) == 0) {
+		while(he_lex_next(&lex, &tok)) {
+			int key = he_keywords_find(&Logic_Table, &tok);
+			*rules += key >= LOGIC_COLLISION && key <= LOGIC_COLLISION_EXIT;
+		}
+
+		// responses are never longer than the text they came from
+		program = lex.size;
+		he_lex_close(&lex);
+	}
+
+	u32 models = ENTITY + *entities;
+
+	// each line padded to the arena alignment, names table slots up to 4 per model
+	size_t components = 3 * sizeof(Vector3) + 3 * sizeof(float) + 2 * sizeof(BoundingBox) + 3 * sizeof(int) + 1;
+
+	return he_arena_round(*entities * sizeof(hed_model))
+	+ models * components + 11 * ARENA_ALIGN
+	+ names
+	+ he_arena_round(models * sizeof(hed_name)) + he_arena_round(models * 5 * sizeof(u16))
+	+ 5 * he_arena_round(*rules * sizeof(u32))
+	+ he_arena_round(program) + 4096;
+}
+
+u8
+he_engine_grow_entities(hed_level *level, u32 need) {
+
+	u32 capacity = level->entities_capacity * 2u > need ? level->entities_capacity * 2u : need;
+
+	if(capacity > MAX_MODELS) {
+		capacity = MAX_MODELS;
+	}
+
+	hed_model *entities = he_arena_alloc(&level->arena, capacity * sizeof(hed_model));
+
+	if(entities == NULL || capacity < need) {
+		printf("Cannot fit %u entities in level %s.\n", need, level->name);
+		return 1;
+	}
+
+	// the old table stays behind in the arena until the level ends
+	if(level->entities_count > 0) {
+		(void)memcpy(entities, level->entities, level->entities_count * sizeof(hed_model));
+	}
+
+	level->entities = entities;
+	level->entities_capacity = capacity;
+
+	return 0;
+}
+
+u8
+he_engine_grow_rules(hed_level *level, u32 need) {
+
+	u32 capacity = level->col_capacity * 2u > need ? level->col_capacity * 2u : need;
+
+	if(capacity > MAX_RULES) {
+		capacity = MAX_RULES;
+	}
+
+	u16 *one = he_arena_alloc(&level->arena, capacity * sizeof(u16));
+	u16 *two = he_arena_alloc(&level->arena, capacity * sizeof(u16));
+	u8 *when = he_arena_alloc(&level->arena, capacity);
+	u8 *target = he_arena_alloc(&level->arena, capacity);
+	u32 *code = he_arena_alloc(&level->arena, capacity * sizeof(u32));
+
+	if(one == NULL || two == NULL || when == NULL || target == NULL || code == NULL || capacity < need) {
+		printf("Cannot fit %u collision rules in level %s.\n", need, level->name);
+		return 1;
+	}
+
+	u16 count = level->col_count;
+
+	if(count > 0) {
+		(void)memcpy(one, level->col_one, count * sizeof(u16));
+		(void)memcpy(two, level->col_two, count * sizeof(u16));
+		(void)memcpy(when, level->col_when, count);
+		(void)memcpy(target, level->col_target, count);
+		(void)memcpy(code, level->col_code, count * sizeof(u32));
+	}
+
+	level->col_one = one;
+	level->col_two = two;
+	level->col_when = when;
+	level->col_target = target;
+	level->col_code = code;
+	level->col_capacity = capacity;
+
+	return 0;
+}
+
+void
+he_engine_watch_level(void) {
+
+	hed_watch *watch = &engine.watch;
+	watch->fd = -1;
+	watch->last_poll = 0.0;
+
+	#ifdef __linux__
+	watch->fd = inotify_init1(IN_NONBLOCK);
+
+	// editors either write in place or rename a temp file over the config
+	if(watch->fd >= 0 && inotify_add_watch(watch->fd, engine.current_level->name, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(watch->fd);
+		watch->fd = -1;
+	}
+	#endif
+
+	// first poll only records the current mtimes
+	watch->logic_mtime = -1;
+	watch->resources_mtime = -1;
+
+	if(watch->fd < 0) {
+		he_engine_poll_level();
+	}
+}
+
+void
+he_engine_unwatch_level(void) {
+
+	if(engine.debug && engine.watch.fd >= 0) {
+		close(engine.watch.fd);
+	}
+
+	engine.watch.fd = -1;
+}
+
+void
+he_engine_poll_level(void) {
+
+	hed_watch *watch = &engine.watch;
+	bool logic = false, resources = false;
+
+	if(watch->fd >= 0) {
+		#ifdef __linux__
+		union { struct inotify_event event; char bytes[4096]; } events;
+		ssize_t length;
+
+		while( (length = read(watch->fd, events.bytes, sizeof(events.bytes))) > 0 ) {
+			for(char *p = events.bytes; p < events.bytes + length; ) {
+				struct inotify_event *event = (struct inotify_event *)(void *)p;
+
+				if(event->len > 0) {
+					logic |= strcmp(event->name, CFG_printfIC) == 0;
+					resources |= strcmp(event->name, CFG_RESOURCES) == 0;
+				}
+
+				p += sizeof(struct inotify_event) + event->len;
+			}
+		}
+		#endif
+	}
+
+	else {
+		double now = he_engine_clock();
+
+		if(now - watch->last_poll < WATCH_POLL) {
+			return;
+		}
+
+		watch->last_poll = now;
+
+		char path[U8];
+		struct stat st;
+
+		(void)snprintf(path, sizeof(path),
+		"%s%s%s", engine.current_level->name, SEP, CFG_printfIC);
+
+		if(stat(path, &st) == 0 && ((int64_t)st.st_mtime != watch->logic_mtime || (int64_t)st.st_size != watch->logic_size)) {
+			logic = watch->logic_mtime >= 0;
+			watch->logic_mtime = st.st_mtime;
+			watch->logic_size = st.st_size;
+		}
+
+		(void)snprintf(path, sizeof(path),
+		"%s%s%s", engine.current_level->name, SEP, CFG_RESOURCES);
+
+		if(stat(path, &st) == 0 && ((int64_t)st.st_mtime != watch->resources_mtime || (int64_t)st.st_size != watch->resources_size)) {
+			resources = watch->resources_mtime >= 0;
+			watch->resources_mtime = st.st_mtime;
+			watch->resources_size = st.st_size;
+		}
+	}
+
+	if(!resources && !logic) {
+		return;
+	}
+
+	// the preload thread acquires and decodes assets, it is stopped before the registry
+	// changes and started again for whatever PRELOAD lines the reload parsed
+	he_engine_release_preload();
+
+	// edited configs are compared with the pack again
+	if(engine.pack.checked != NULL) {
+		(void)memset(engine.pack.checked, 0, engine.pack.entry_count);
+	}
+
+	// new resources change model ids, logic is parsed again with them anyway
+	if(resources) {
+		(void)he_engine_reload_resources();
+	}
+
+	else {
+		(void)he_engine_reload_logic();
+	}
+
+	he_engine_start_preload();
+}
+
+u8
+he_engine_reload_logic(void) {
+
+	double start = he_engine_clock();
+	hed_level *level = engine.current_level;
+	u16 count = ENTITY + level->entities_count;
+
+	// where play moved the models, kept unless logic now says otherwise
+	Vector3 *saved = malloc(2 * count * sizeof(Vector3));
+	if(saved == NULL) {
+		printf("Out of memory reloading logic.\n");
+		return 1;
+	}
+
+	Vector3 *origins = saved + count;
+
+	hed_components *components = &level->components;
+
+	for(u16 id = 0; id < count; id++) {
+		hed_model *model = he_engine_model(level, id);
+
+		saved[id] = components->position[id];
+		origins[id] = model->origin;
+		model->origin = Vector3Zero();
+		he_engine_place_model(level, id, Vector3Zero());
+	}
+
+	// rules are numbered again, contacts of the old ones mean nothing
+	level->col_count = 0;
+	level->col_wildcards = 0;
+	level->preload_count = 0;
+	level->program.count = 0;
+	level->program.strings_size = 0;
+	level->program.number_count = 0;
+	level->events.count = 0;
+	level->events.contact_count = 0;
+
+	char logic[U8];
+	(void)snprintf(logic, sizeof(logic),
+	"%s%s%s", level->name, SEP, CFG_printfIC);
+
+	u8 failed = he_engine_parse_logic(level, logic);
+
+	for(u16 id = 0; id < count; id++) {
+		hed_model *model = he_engine_model(level, id);
+
+		if(Vector3Equals(model->origin, origins[id])) {
+			he_engine_place_model(level, id, saved[id]);
+		}
+
+		// moved by the edit, no interpolation from the old spot
+		else {
+			components->prev_position[id] = components->position[id];
+		}
+	}
+
+	free(saved);
+
+	level->grid.dirty = true;
+
+	for(u16 i = 0; i < level->batches.count; i++) {
+		level->batches.items[i].dirty = true;
+	}
+
+	if(failed) {
+		printf("Reload of %s failed, rules parsed up to the error are used, fix it and save again.\n", logic);
+		return 1;
+	}
+
+	printf("Reloaded %s, %u rules in %.2f ms.\n", logic, level->col_count, (he_engine_clock() - start) * 1000.0);
+
+	return 0;
+}
+
+u8
+he_engine_reload_resources(void) {
+
+	double start = he_engine_clock();
+	hed_level *level = engine.current_level;
+
+	char resources[U8];
+	(void)snprintf(resources, sizeof(resources),
+	"%s%s%s", level->name, SEP, CFG_RESOURCES);
+
+	// models are matched by file against the running ones, matches keep their state
+	u16 old_count = level->entities_count;
+	hed_model *old = malloc((old_count + 1) * sizeof(hed_model));
+	bool *kept = calloc(old_count + 1, sizeof(bool));
+
+	if(old == NULL || kept == NULL) {
+		printf("Out of memory reloading resources.\n");
+		free(old);
+		free(kept);
+		return 1;
+	}
+
+	(void)memcpy(old, level->entities, old_count * sizeof(hed_model));
+	hed_model old_hero = level->hero, old_map = level->map;
+
+	level->hero.asset = NULL;
+	level->map.asset = NULL;
+	level->entities_count = 0;
+
+	if(he_engine_parse_resources(level, resources)) {
+		printf("Reload of %s failed, fix it and save again.\n", resources);
+
+		he_engine_release_asset(level->hero.asset);
+		he_engine_release_asset(level->map.asset);
+
+		for(u16 i = 0; i < level->entities_count; i++) {
+			he_engine_release_asset(level->entities[i].asset);
+		}
+
+		level->hero = old_hero;
+		level->map = old_map;
+		level->entities_count = old_count;
+		(void)memcpy(level->entities, old, old_count * sizeof(hed_model));
+
+		free(old);
+		free(kept);
+		return 1;
+	}
+
+	// components of kept models move from their old id, NO_MODEL starts fresh
+	u16 *from = malloc((ENTITY + level->entities_count) * sizeof(u16));
+
+	if(from == NULL) {
+		printf("Out of memory reloading resources.\n");
+		free(old);
+		free(kept);
+		return 1;
+	}
+
+	for(u16 id = 0; id < ENTITY + level->entities_count; id++) {
+		from[id] = NO_MODEL;
+	}
+
+	// the new copy took its own reference, running one already has one
+	if(level->hero.asset == NULL || level->hero.asset == old_hero.asset) {
+		he_engine_release_asset(level->hero.asset);
+		level->hero = old_hero;
+		from[HERO] = HERO;
+	}
+
+	else {
+		he_engine_release_asset(old_hero.asset);
+	}
+
+	bool new_map = level->map.asset != NULL && level->map.asset != old_map.asset;
+
+	if(!new_map) {
+		he_engine_release_asset(level->map.asset);
+		level->map = old_map;
+		from[MAP] = MAP;
+	}
+
+	else {
+		he_engine_release_asset(old_map.asset);
+	}
+
+	u16 reused = 0;
+
+	for(u16 i = 0; i < level->entities_count; i++) {
+		hed_model *entity = &level->entities[i];
+
+		for(u16 j = 0; j < old_count; j++) {
+			if(!kept[j] && old[j].asset == entity->asset && old[j].entity_type == entity->entity_type) {
+				he_engine_release_asset(entity->asset);
+				*entity = old[j];
+				from[ENTITY + i] = ENTITY + j;
+				kept[j] = true;
+				reused++;
+				break;
+			}
+		}
+	}
+
+	for(u16 j = 0; j < old_count; j++) {
+		if(!kept[j]) {
+			he_engine_release_asset(old[j].asset);
+		}
+	}
+
+	free(old);
+	free(kept);
+
+	// only files nothing had loaded yet
+	if(he_engine_load_assets()) {
+		free(from);
+		return 1;
+	}
+
+	if(new_map) {
+		he_bvh_free(&level->map_bvh);
+		(void)he_bvh_load_map(&level->map_bvh, level->map.asset->path, &level->map.asset->model);
+	}
+
+	level->hero.id = HERO;
+	level->map.id = MAP;
+
+	for(u16 i = 0; i < level->entities_count; i++) {
+		level->entities[i].id = ENTITY + i;
+		level->entities[i].batch = NO_BATCH;
+	}
+
+	// old arrays stay readable in the arena while rows are copied over
+	hed_components old_components = level->components;
+
+	if(he_engine_alloc_components(level, ENTITY + level->entities_count)) {
+		level->components = old_components;
+		free(from);
+		return 1;
+	}
+
+	for(u16 id = 0; id < ENTITY + level->entities_count; id++) {
+		hed_model *model = he_engine_model(level, id);
+		he_engine_bind_model(model);
+
+		if(from[id] != NO_MODEL) {
+			he_engine_copy_component(&level->components, id, &old_components, from[id]);
+		}
+	}
+
+	free(from);
+
+	free(level->boxes.min_x);
+	(void)memset(&level->boxes, 0, sizeof(hed_boxes));
+
+	if(he_engine_alloc_boxes(&level->boxes, ENTITY + level->entities_count) || he_engine_build_names(level)) {
+		return 1;
+	}
+
+	free(level->batches.items);
+	free(level->batches.members);
+	free(level->batches.transforms);
+	(void)memset(&level->batches, 0, sizeof(hed_batches));
+
+	if(!engine.headless && he_engine_build_batches()) {
+		return 1;
+	}
+
+	// rules point at model ids, which just changed
+	u8 failed = he_engine_reload_logic();
+
+	he_engine_collect_assets();
+
+	printf("Reloaded %s, %u entities, %u kept, in %.2f ms.\n",
+	resources, level->entities_count, reused, (he_engine_clock() - start) * 1000.0);
+
+	return failed;
+}
+
+u8
+he_engine_parse_resources(hed_level *level, const char *resources) {
+
+	hed_lexer lex;
+
+	if(he_lex_open(&lex, resources)) {
+		printf("Failed to open resources config for the level.\n");
+		return 1;
+	}
+
+	hed_token tok, arg;
+	char tmp[U6], p[U8];
+	u8 failed = 0;
+
+	while(!failed && he_lex_next(&lex, &tok)) {
+		int key = he_keywords_find(&Resources_Table, &tok);
+
+		if(key == RES_HERO || key == RES_MAP) {
+			if(he_lex_expect(&lex, &arg, "a model file") || he_lex_copy(&lex, &arg, tmp, sizeof(tmp))) {
+				failed = 1;
+				break;
+			}
+
+			(void)snprintf(p, sizeof(p),
+			"%s%s%s", engine.config.resources, SEP, tmp);
+
+			if(access(p, F_OK) != 0) {
+				he_lex_error(&lex, &arg, "%s model %s cannot be loaded",
+				key == RES_HERO ? "Hero" : "Map", tmp);
+				failed = 1;
+				break;
+			}
+
+			hed_model *model = key == RES_HERO ? &level->hero : &level->map;
+			*model = he_engine_load_model(p);
+			model->name = he_arena_strdup(&level->arena, tmp, strlen(tmp));
+
+			model->type = key == RES_HERO ? HERO : MAP;
+			continue;
+		}
+
+		if(key == RES_ENTITY) {
+			if(he_lex_expect(&lex, &arg, "an entity type")) {
+				failed = 1;
+				break;
+			}
+
+			if(he_keywords_find(&Resources_Table, &arg) != RES_STATIC) {
+				he_lex_error(&lex, &arg, "unknown entity type '%.*s' in level config",
+				(int)arg.len, arg.str);
+				failed = 1;
+				break;
+			}
+
+			if(he_lex_expect(&lex, &arg, "a model file") || he_lex_copy(&lex, &arg, tmp, sizeof(tmp))) {
+				failed = 1;
+				break;
+			}
+
+			(void)snprintf(p, sizeof(p),
+			"%s%s%s%s%s", engine.config.base, SEP, BASE_MEDIA, SEP, tmp);
+
+			if(access(p, F_OK) != 0) {
+				he_lex_error(&lex, &arg, "cannot access %s entity", tmp);
+				failed = 1;
+				break;
+			}
+
+			FILE *fpp = fopen(p, "r");
+
+			if(fpp == NULL) {
+				he_lex_error(&lex, &arg, "cannot open %s entity", tmp);
+				failed = 1;
+				break;
+			}
+
+			fclose(fpp);
+
+			// optional COUNT n on the same line, n copies placed from logic
+			int count = 1;
+
+			if(he_lex_inline(&lex, &tok)) {
+				if(he_keywords_find(&Resources_Table, &tok) != RES_COUNT) {
+					he_lex_error(&lex, &tok, "expected COUNT or end of line, got '%.*s'",
+					(int)tok.len, tok.str);
+					failed = 1;
+					break;
+				}
+
+				if(he_lex_expect(&lex, &arg, "a count") || he_lex_int(&lex, &arg, &count)) {
+					failed = 1;
+					break;
+				}
+
+				if(count < 1) {
+					he_lex_error(&lex, &arg, "entity %s COUNT must be at least 1", tmp);
+					failed = 1;
+					break;
+				}
+			}
+
+			u32 need = level->entities_count + count;
+
+			if(need > MAX_MODELS) {
+				he_lex_error(&lex, &arg, "too many entities in level, limit is %d", MAX_MODELS);
+				failed = 1;
+				break;
+			}
+
+			// sized up front from the same file, only a config edited since grows here
+			if(need > level->entities_capacity && he_engine_grow_entities(level, need)) {
+				failed = 1;
+				break;
+			}
+
+			for(int i = 0; i < count; i++) {
+				hed_model *entity = &level->entities[level->entities_count];
+				*entity = he_engine_load_model(p);
+				entity->type = ENTITY;
+				entity->entity_type = STATIC;
+
+				level->entities_count++;
+			}
+
+			continue;
+		}
+
+		if(key == RES_POSE_CACHE) {
+			int kb = 0;
+
+			if(he_lex_expect(&lex, &arg, "a model file") || he_lex_copy(&lex, &arg, tmp, sizeof(tmp)) ||
+			he_lex_expect(&lex, &tok, "a size in KB") || he_lex_int(&lex, &tok, &kb)) {
+				failed = 1;
+				break;
+			}
+
+			if(kb < 0) {
+				he_lex_error(&lex, &tok, "POSE_CACHE of %s can't be negative", tmp);
+				failed = 1;
+				break;
+			}
+
+			hed_asset *asset = he_engine_level_asset(level, tmp);
+
+			if(asset == NULL) {
+				he_lex_error(&lex, &arg, "POSE_CACHE model %s is not in the level above this line", tmp);
+				failed = 1;
+				break;
+			}
+
+			// a model kept loaded from the last level stays baked the way it was
+			asset->pose_cap = (u32)kb * 1024;
+			continue;
+		}
+
+		he_lex_error(&lex, &tok, "syntax error in resources config, %.*s unrecognized",
+		(int)tok.len, tok.str);
+		failed = 1;
+	}
+
+	he_lex_close(&lex);
+	return failed;
+}
+
+u8
+he_engine_parse_logic(hed_level *level, const char *logic) {
+
+	hed_lexer lex;
+
+	if(he_lex_open(&lex, logic)) {
+		printf("Cannot open logic for current level.\n");
+		return 1;
+	}
+
+	hed_token tok, arg;
+	char name[U8];
+	u8 failed = 0;
+
+	while(!failed && he_lex_next(&lex, &tok)) {
+		int key = he_keywords_find(&Logic_Table, &tok);
+
+		if(key == LOGIC_POSITION) {
+
+			// get model name
+			if(he_lex_expect(&lex, &arg, "a model name")) {
+				failed = 1;
+				break;
+			}
+
+			// check if model exists in level
+			int counter = he_engine_check_model(level, arg.str, arg.len);
+
+			if(counter < 0) {
+				he_lex_error(&lex, &arg, "model %.*s doesn't exist", (int)arg.len, arg.str);
+				failed = 1;
+				break;
+			}
+
+			float v[3];
+			u8 i;
+			for(i = 0; i < 3; i++) {
+				if(he_lex_expect(&lex, &arg, "x y z") || he_lex_float(&lex, &arg, &v[i])) {
+					break;
+				}
+			}
+
+			if(i < 3) {
+				failed = 1;
+				break;
+			}
+
+			hed_model *model = he_engine_model(level, counter);
+			model->origin = (Vector3) { v[0], v[1], v[2] };
+			he_engine_place_model(level, counter, model->origin);
+			continue;
+		}
+
+		else if(key == LOGIC_PRELOAD) {
+			if(he_lex_expect(&lex, &arg, "a level name") || he_lex_copy(&lex, &arg, name, sizeof(name))) {
+				failed = 1;
+				break;
+			}
+
+			if(level->preload_count == MAX_PRELOAD) {
+				he_lex_error(&lex, &tok, "too many PRELOAD levels, limit is %d", MAX_PRELOAD);
+				failed = 1;
+				break;
+			}
+
+			if(he_index_find(name) == NULL) {
+				he_lex_error(&lex, &arg, "level %s doesn't exist", name);
+				failed = 1;
+				break;
+			}
+
+			(void)snprintf(level->preload[level->preload_count],
+			sizeof(level->preload[0]),
+			"%s%s%s", engine.config.level, SEP, name);
+
+			level->preload_count++;
+			continue;
+		}
+
+		else if(key == LOGIC_PLACE) {
+
+			// one x y z line per instance of the model, in resources order, until END
+			if(he_lex_expect(&lex, &arg, "a model name") || he_lex_copy(&lex, &arg, name, sizeof(name))) {
+				failed = 1;
+				break;
+			}
+
+			int found = he_engine_find_name(level, arg.str, arg.len);
+
+			if(found < 0) {
+				he_lex_error(&lex, &arg, "model %s doesn't exist", name);
+				failed = 1;
+				break;
+			}
+
+			hed_name *instances = &level->names.items[found];
+			u16 next = 0;
+
+			while(1) {
+				if(!he_lex_next(&lex, &arg)) {
+					he_lex_error(&lex, &tok, "PLACE %s without END", name);
+					failed = 1;
+					break;
+				}
+
+				if(he_keywords_find(&Logic_Table, &arg) == LOGIC_END) {
+					break;
+				}
+
+				float x, y, z;
+				if(he_lex_float(&lex, &arg, &x) ||
+				he_lex_expect(&lex, &arg, "y z") || he_lex_float(&lex, &arg, &y) ||
+				he_lex_expect(&lex, &arg, "z") || he_lex_float(&lex, &arg, &z)) {
+					failed = 1;
+					break;
+				}
+
+				if(next == instances->count) {
+					he_lex_error(&lex, &arg, "PLACE %s has more positions than instances", name);
+					failed = 1;
+					break;
+				}
+
+				u16 id = level->names.members[instances->first + next];
+				hed_model *model = he_engine_model(level, id);
+				he_vec3_modify(model->origin, x,y,z);
+				he_engine_place_model(level, id, model->origin);
+				next++;
+			}
+
+			continue;
+		}
+
+		else if(key >= LOGIC_COLLISION && key <= LOGIC_COLLISION_EXIT) {
+
+			// which transitions fire the response
+			const u8 whens[] = { EVENT_ENTER | EVENT_STAY, EVENT_ENTER, EVENT_STAY, EVENT_EXIT };
+
+			if(level->col_count == MAX_RULES) {
+				he_lex_error(&lex, &tok, "too many collision rules, limit is %d", MAX_RULES);
+				failed = 1;
+				break;
+			}
+
+			if(level->col_count == level->col_capacity && he_engine_grow_rules(level, level->col_count + 1)) {
+				failed = 1;
+				break;
+			}
+
+			level->col_when[level->col_count] = whens[key - LOGIC_COLLISION];
+
+			// getting both models
+			hed_token second;
+			if(he_lex_expect(&lex, &arg, "a model name") || he_lex_expect(&lex, &second, "a second model")) {
+				failed = 1;
+				break;
+			}
+
+			// checking if both models are loaded in program
+			int counter = he_engine_check_model(level, arg.str, arg.len);
+
+			if(counter < 0) {
+				he_lex_error(&lex, &arg, "model named %.*s doesn't exist", (int)arg.len, arg.str);
+				failed = 1;
+				break;
+			}
+
+			level->col_one[level->col_count] = counter;
+
+			// wildcards, every entity or every entity of a type
+			if(he_lex_is(&second, "*") || he_lex_is(&second, "STATIC")) {
+				level->col_two[level->col_count] = 0;
+				level->col_target[level->col_count] =
+				second.str[0] == '*' ? COLLISION_ANY : COLLISION_STATIC;
+
+				level->col_wildcards++;
+				level->grid.dirty = true;
+			}
+
+			else {
+				level->col_target[level->col_count] = COLLISION_PAIR;
+				counter = he_engine_check_model(level, second.str, second.len);
+
+				if(counter < 0) {
+					he_lex_error(&lex, &second, "model named %.*s doesn't exist", (int)second.len, second.str);
+					failed = 1;
+					break;
+				}
+
+				// checking if not the same, you can never know
+				if(counter == level->col_one[level->col_count]) {
+					he_lex_error(&lex, &second, "collision detection on same model is not possible");
+					failed = 1;
+					break;
+				}
+
+				level->col_two[level->col_count] = counter;
+			}
+
+			// getting response to collision, one action or a DO ... END block of them
+			if(he_lex_expect(&lex, &arg, "a response")) {
+				failed = 1;
+				break;
+			}
+
+			level->col_code[level->col_count] = level->program.count;
+
+			if(he_keywords_find(&Logic_Table, &arg) == LOGIC_DO) {
+				while(!failed) {
+					if(he_lex_expect(&lex, &arg, "an action or END")) {
+						failed = 1;
+					}
+
+					else if(he_keywords_find(&Logic_Table, &arg) == LOGIC_END) {
+						break;
+					}
+
+					else {
+						failed = he_processor_compile(level, &lex, &arg);
+					}
+				}
+			}
+
+			else {
+				failed = he_processor_compile(level, &lex, &arg);
+			}
+
+			he_processor_emit(level, END_RESPONSE);
+
+			if(failed || level->program.oom) {
+				failed = 1;
+				break;
+			}
+
+			level->col_count++;
+			continue;
+		}
+
+		he_lex_error(&lex, &tok, "syntax error, %.*s is unknown keyword in logic",
+		(int)tok.len, tok.str);
+		failed = 1;
+	}
+
+	he_lex_close(&lex);
+	return failed;
+}
+
+hed_model
+he_engine_load_model(const char *path) {
+
+	hed_model model = {
+		.tint = WHITE,
+		.batch = NO_BATCH,
+	};
+
+	// same file loaded once, instances only keep their own state,
+	// data arrives in he_engine_load_assets and he_engine_bind_model
+	model.asset = he_engine_acquire_asset(path);
+
+	// never rendered, its components are left without MODEL_RENDER
+	if(model.asset == NULL) {
+		return model;
+	}
+
+	// getting only model name from path, the asset keeps it alive
+	const char *name = strrchr(model.asset->path, SEP[0]);
+	model.name = name ? name + 1 : model.asset->path;
+
+	return model;
+}
+
+hed_asset *
+he_engine_acquire_asset(const char *path) {
+
+	hed_assets *assets = &engine.assets;
+
+	for(u16 i = 0; i < assets->count; i++) {
+		if(strcmp(assets->items[i]->path, path) == 0) {
+			assets->items[i]->refs++;
+			return assets->items[i];
+		}
+	}
+
+	if(assets->count == assets->capacity) {
+		u16 capacity = assets->capacity ? assets->capacity * 2 : 32;
+		hed_asset **items = realloc(assets->items, capacity * sizeof(hed_asset *));
+
+		if(items == NULL) {
+			printf("Out of memory for asset %s.\n", path);
+			return NULL;
+		}
+
+		assets->items = items;
+		assets->capacity = capacity;
+	}
+
+	hed_asset *asset = calloc(1, sizeof(hed_asset));
+	if(asset == NULL) {
+		printf("Out of memory for asset %s.\n", path);
+		return NULL;
+	}
+
+	(void)snprintf(asset->path, sizeof(asset->path),
+	"%s", path);
+
+	asset->refs = 1;
+	asset->pose_cap = POSE_CACHE_KB * 1024;
+	assets->items[assets->count++] = asset;
+
+	return asset;
+}
+
+u8
+he_engine_load_assets(void) {
+
+	// workers read, parse and decode, only the GL upload stays on this thread
+	hed_loader *loader = &engine.loader;
+	hed_assets *assets = &engine.assets;
+
+	loader->count = 0;
+	loader->next = 0;
+	loader->decoded = 0;
+
+	loader->queue = malloc((assets->count + 1) * sizeof(hed_asset *));
+	if(loader->queue == NULL) {
+		printf("Out of memory for asset loader.\n");
+		return 1;
+	}
+
+	// preloaded assets may be decoded and still waiting for upload
+	for(u16 i = 0; i < assets->count; i++) {
+		if(!assets->items[i]->decoded || (!engine.headless && !assets->items[i]->uploaded)) {
+			loader->queue[loader->count++] = assets->items[i];
+		}
+	}
+
+	if(loader->count == 0) {
+		free(loader->queue);
+		loader->queue = NULL;
+		he_engine_bake_assets();
+		return 0;
+	}
+
+	double start = he_engine_clock();
+
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int wanted = cores < 1 ? 1 : cores > LOADER_THREADS ? LOADER_THREADS : (int)cores;
+
+	if(wanted > loader->count) {
+		wanted = loader->count;
+	}
+
+	pthread_t threads[LOADER_THREADS];
+	int started = 0;
+
+	(void)pthread_mutex_init(&loader->lock, NULL);
+
+	while(started < wanted && pthread_create(&threads[started], NULL, he_engine_decode_assets, loader) == 0) {
+		started++;
+	}
+
+	// no threads, decode everything here before uploading
+	if(started == 0) {
+		(void)he_engine_decode_assets(loader);
+	}
+
+	// upload in queue order as workers finish, loading screen between slices
+	u16 uploaded = 0;
+
+	while(uploaded < loader->count) {
+		double slice = he_engine_clock();
+
+		while(uploaded < loader->count && he_engine_clock() - slice < LOADER_SLICE) {
+			pthread_mutex_lock(&loader->lock);
+			bool ready = loader->queue[uploaded]->decoded;
+			pthread_mutex_unlock(&loader->lock);
+
+			if(!ready) {
+				break;
+			}
+
+			he_engine_upload_asset(loader->queue[uploaded]);
+			uploaded++;
+		}
+
+		if(!engine.headless) {
+			pthread_mutex_lock(&loader->lock);
+			u16 decoded = loader->decoded;
+			pthread_mutex_unlock(&loader->lock);
+
+			he_engine_draw_loading(decoded, uploaded, loader->count);
+		}
+
+		else if(uploaded < loader->count) {
+			(void)nanosleep(&(struct timespec) { 0, 1000000 }, NULL);
+		}
+	}
+
+	for(int i = 0; i < started; i++) {
+		(void)pthread_join(threads[i], NULL);
+	}
+
+	(void)pthread_mutex_destroy(&loader->lock);
+
+	if(engine.debug) {
+		printf("Loaded %u assets on %d threads in %.1f ms.\n",
+		loader->count, started, (he_engine_clock() - start) * 1000.0);
+	}
+
+	free(loader->queue);
+	loader->queue = NULL;
+
+	// uploaded models have their bind poses, clips are baked over the job threads
+	he_engine_bake_assets();
+
+	return 0;
+}
+
+void *
+he_engine_decode_assets(void *arg) {
+
+	hed_loader *loader = arg;
+
+	while(!__atomic_load_n(&loader->cancel, __ATOMIC_RELAXED)) {
+		pthread_mutex_lock(&loader->lock);
+		u16 next = loader->next < loader->count ? loader->next++ : loader->count;
+		pthread_mutex_unlock(&loader->lock);
+
+		if(next == loader->count) {
+			break;
+		}
+
+		hed_asset *asset = loader->queue[next];
+
+		if(!asset->decoded) {
+			he_engine_decode_asset(asset);
+		}
+
+		pthread_mutex_lock(&loader->lock);
+		asset->decoded = true;
+		loader->decoded++;
+		pthread_mutex_unlock(&loader->lock);
+	}
+
+	return NULL;
+}
+
+void
+he_engine_decode_asset(hed_asset *asset) {
+
+	// baked models only need pointers into the pack
+	asset->packed = he_pack_find(asset->path, PACK_MODEL);
+
+	if(asset->packed != NULL) {
+		he_pack_decode_model(asset);
+		he_engine_decode_rates(asset);
+		he_engine_drop_poses(asset);
+		return;
+	}
+
+	// animations are cpu-only in raylib, headless keeps them for stepping
+	asset->animations = LoadModelAnimations(asset->path, &asset->animCount);
+
+	// if it doesn't contain then ditch animations
+	if(asset->animCount == 0) {
+		UnloadModelAnimations(asset->animations, asset->animCount);
+		asset->animations = NULL;
+	}
+
+	// glTF carries bounds in its header, other formats wait for meshes
+	const char *ext = strrchr(asset->path, '.');
+
+	if(ext != NULL && strcmp(ext, ".glb") == 0) {
+		asset->box = he_engine_glb_bbox(asset->path);
+		asset->boxed = true;
+	}
+
+	// meshes and images too, the main thread only uploads them. Headless keeps the meshes
+	// for map queries and never uploads
+	if(he_engine_decode_model(asset) == 0 && !asset->boxed && asset->model.meshCount > 0) {
+		asset->box = GetMeshBoundingBox(asset->model.meshes[0]);
+
+		for(int i = 1; i < asset->model.meshCount; i++) {
+			asset->box = he_engine_combine_bbox(asset->box, GetMeshBoundingBox(asset->model.meshes[i]));
+		}
+
+		asset->boxed = true;
+	}
+
+	he_engine_decode_rates(asset);
+	he_engine_drop_poses(asset);
+}
+
+void
+he_engine_decode_rates(hed_asset *asset) {
+
+	// clips keep the rate raylib sampled them at, resampled formats share one,
+	// IQM files say it for every clip
+	if(asset->animCount == 0) {
+		return;
+	}
+
+	asset->clip_rate = malloc(asset->animCount * sizeof(float));
+	if(asset->clip_rate == NULL) {
+		return;
+	}
+
+	const char *ext = strrchr(asset->path, '.');
+	bool resampled = ext != NULL && (strcmp(ext, ".glb") == 0 || strcmp(ext, ".gltf") == 0 || strcmp(ext, ".m3d") == 0);
+
+	for(int c = 0; c < asset->animCount; c++) {
+		asset->clip_rate[c] = resampled ? 1000.0f / GLTF_FRAME_MS : ANIM_FPS;
+	}
+
+	if(ext != NULL && strcmp(ext, ".iqm") == 0) {
+		he_engine_iqm_rates(asset);
+	}
+}
+
+void
+he_engine_iqm_rates(hed_asset *asset) {
+
+	// header is a 16 byte magic and 27 u32 fields, anim count and offset are 17 and 18,
+	// each anim is name, first frame, frame count, framerate and flags
+	FILE *fp = fopen(asset->path, "rb");
+	if(fp == NULL) {
+		return;
+	}
+
+	char magic[16];
+	u32 header[27];
+
+	if(fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, "INTERQUAKEMODEL", sizeof(magic)) != 0 ||
+	fread(header, sizeof(u32), 27, fp) != 27 || header[17] != (u32)asset->animCount ||
+	fseek(fp, header[18], SEEK_SET) != 0) {
+		fclose(fp);
+		return;
+	}
+
+	for(int c = 0; c < asset->animCount; c++) {
+		struct { u32 name, first_frame, frame_count; float framerate; u32 flags; } anim;
+
+		if(fread(&anim, sizeof(anim), 1, fp) != 1) {
+			break;
+		}
+
+		// exporters write 0 when they don't know, those keep ANIM_FPS
+		if(anim.framerate > 0.0f && anim.framerate <= 1000.0f) {
+			asset->clip_rate[c] = anim.framerate;
+		}
+	}
+
+	fclose(fp);
+}
+
+float
+he_engine_clip_rate(const hed_asset *asset, int clip) {
+
+	return asset->clip_rate != NULL ? asset->clip_rate[clip] : ANIM_FPS;
+}
+
+void
+he_engine_upload_asset(hed_asset *asset) {
+
+	printf("Num of animations for model %s is %d.\n", asset->path, asset->animCount);
+
+	if(asset->clips != NULL) {
+		printf("Animations of %s compressed to %.1f KB from %.1f KB of frame poses, %.1fx.\n", asset->path,
+		asset->clip_bytes / 1024.0, asset->raw_bytes / 1024.0, (double)asset->raw_bytes / asset->clip_bytes);
+	}
+
+	if(engine.headless) {
+		return;
+	}
+
+	if(asset->packed != NULL) {
+		he_pack_upload_model(asset);
+		asset->uploaded = true;
+		return;
+	}
+
+	if(asset->staged) {
+		he_engine_upload_staged(asset);
+		asset->uploaded = true;
+		return;
+	}
+
+	// formats other than glTF, LoadModel parses and uploads them here
+	asset->model = LoadModel(asset->path);
+	asset->uploaded = true;
+
+	if(!asset->boxed) {
+		// generating bounding box
+		asset->box = GetMeshBoundingBox(asset->model.meshes[0]);
+
+		for(size_t i = 1; (int)i < asset->model.meshCount; i++) {
+			BoundingBox currentBox = GetMeshBoundingBox(asset->model.meshes[i]);
+			asset->box = he_engine_combine_bbox(asset->box, currentBox);
+		}
+
+		asset->boxed = true;
+	}
+}
+
+void
+he_engine_bind_model(hed_model *model) {
+
+	if(model->asset == NULL) {
+		return;
+	}
+
+	hed_components *components = &engine.current_level->components;
+	u16 id = model->id;
+
+	components->box[id] = model->asset->box;
+	components->flags[id] |= MODEL_RENDER;
+
+	if(model->asset->animCount > 0) {
+		components->flags[id] |= MODEL_ANIMATE;
+		components->frame_count[id] = model->asset->animations[IDLE].frameCount;
+		components->clip_rate[id] = he_engine_clip_rate(model->asset, IDLE);
+	}
+}
+
+u8
+he_engine_alloc_components(hed_level *level, u32 count) {
+
+	// from the level arena, a reload gets new arrays and copies kept rows over
+	hed_components *components = &level->components;
+	hed_arena *arena = &level->arena;
+
+	components->position = he_arena_alloc(arena, count * sizeof(Vector3));
+	components->scale = he_arena_alloc(arena, count * sizeof(Vector3));
+	components->angle = he_arena_alloc(arena, count * sizeof(float));
+	components->prev_position = he_arena_alloc(arena, count * sizeof(Vector3));
+	components->prev_angle = he_arena_alloc(arena, count * sizeof(float));
+	components->box = he_arena_alloc(arena, count * sizeof(BoundingBox));
+	components->world = he_arena_alloc(arena, count * sizeof(BoundingBox));
+	components->clip = he_arena_alloc(arena, count * sizeof(int));
+	components->frame = he_arena_alloc(arena, count * sizeof(int));
+	components->frame_count = he_arena_alloc(arena, count * sizeof(int));
+	components->clip_time = he_arena_alloc(arena, count * sizeof(float));
+	components->clip_rate = he_arena_alloc(arena, count * sizeof(float));
+	components->anim_lod = he_arena_alloc(arena, count);
+	components->flags = he_arena_alloc(arena, count);
+	components->skin = he_arena_alloc(arena, count * sizeof(hed_skin));
+	components->skinning = he_arena_alloc(arena, count * sizeof(u16));
+
+	if(components->position == NULL || components->scale == NULL || components->angle == NULL ||
+	components->prev_position == NULL || components->prev_angle == NULL || components->box == NULL ||
+	components->world == NULL || components->clip == NULL || components->frame == NULL ||
+	components->frame_count == NULL || components->clip_time == NULL || components->clip_rate == NULL ||
+	components->anim_lod == NULL || components->flags == NULL ||
+	components->skin == NULL || components->skinning == NULL) {
+		printf("Out of memory for %u model components.\n", count);
+		return 1;
+	}
+
+	// arena memory is zeroed, only what isn't 0 is set, everything starts out of place
+	for(u32 id = 0; id < count; id++) {
+		components->scale[id] = (Vector3) { 1.0f, 1.0f, 1.0f };
+		components->clip[id] = IDLE;
+		components->flags[id] = MODEL_VISIBLE | MODEL_DIRTY;
+	}
+
+	components->count = count;
+	return 0;
+}
+
+void
+he_engine_copy_component(hed_components *dst, u16 to, const hed_components *src, u16 from) {
+
+	dst->position[to] = src->position[from];
+	dst->scale[to] = src->scale[from];
+	dst->angle[to] = src->angle[from];
+	dst->prev_position[to] = src->prev_position[from];
+	dst->prev_angle[to] = src->prev_angle[from];
+	dst->box[to] = src->box[from];
+	dst->world[to] = src->world[from];
+	dst->clip[to] = src->clip[from];
+	dst->frame[to] = src->frame[from];
+	dst->frame_count[to] = src->frame_count[from];
+	dst->clip_time[to] = src->clip_time[from];
+	dst->clip_rate[to] = src->clip_rate[from];
+	dst->anim_lod[to] = src->anim_lod[from];
+
+	// boxes of the new id are empty until bounds run again, skin is redone on first draw
+	dst->flags[to] = src->flags[from] | MODEL_DIRTY;
+}
+
+void
+he_engine_place_model(hed_level *level, u16 id, Vector3 position) {
+
+	hed_components *components = &level->components;
+	Vector3 *current = &components->position[id];
+
+	// placing a model where it already is leaves its bounds alone
+	if(current->x != position.x || current->y != position.y || current->z != position.z) {
+		*current = position;
+		components->flags[id] |= MODEL_DIRTY;
+	}
+}
+
+void
+he_engine_draw_loading(u16 decoded, u16 uploaded, u16 total) {
+
+	int width = GetScreenWidth();
+	int height = GetScreenHeight();
+
+	// half the bar for decoding, half for uploading
+	float progress = (float)(decoded + uploaded) / (float)(2 * total);
+
+	BeginDrawing();
+		ClearBackground(BLACK);
+
+		DrawText(TextFormat("Loading %s  %u/%u", engine.current_level->name, uploaded, total),
+		width / 4, height / 2 - 30, 20, RAYWHITE);
+
+		DrawRectangleLines(width / 4, height / 2, width / 2, 20, RAYWHITE);
+		DrawRectangle(width / 4 + 2, height / 2 + 2, (int)((width / 2 - 4) * progress), 16, RAYWHITE);
+	EndDrawing();
+}
+
+void
+he_engine_start_preload(void) {
+
+	hed_level *level = engine.current_level;
+	hed_preload *preload = &engine.preload;
+
+	if(level->preload_count == 0) {
+		return;
+	}
+
+	// resolved here, the thread only reads the index
+	preload->level_count = 0;
+	u32 assets = 0;
+
+	for(u8 i = 0; i < level->preload_count; i++) {
+		const hed_index_level *entry = he_index_find(level->preload[i]);
+
+		if(entry != NULL) {
+			preload->levels[preload->level_count++] = entry;
+			assets += entry->asset_count;
+		}
+	}
+
+	preload->held_capacity = assets < MAX_MODELS ? assets : MAX_MODELS;
+	preload->held = malloc((preload->held_capacity + 1) * sizeof(hed_asset *));
+	preload->loader.queue = malloc((preload->held_capacity + 1) * sizeof(hed_asset *));
+
+	if(preload->held == NULL || preload->loader.queue == NULL) {
+		printf("Out of memory for preloading, next level loads on switch.\n");
+		he_engine_release_preload();
+		return;
+	}
+	preload->held_count = 0;
+	preload->uploaded = 0;
+	preload->used = 0;
+	(void)memset(preload->parsed, 0, sizeof(preload->parsed));
+	preload->loader.count = 0;
+	preload->loader.next = 0;
+	preload->loader.decoded = 0;
+	preload->loader.cancel = false;
+
+	(void)pthread_mutex_init(&preload->loader.lock, NULL);
+
+	if(pthread_create(&preload->thread, NULL, he_engine_preload_levels, preload) != 0) {
+		printf("Cannot start preloading, next level loads on switch.\n");
+		(void)pthread_mutex_destroy(&preload->loader.lock);
+		he_engine_release_preload();
+		return;
+	}
+
+	preload->running = true;
+}
+
+void *
+he_engine_preload_levels(void *arg) {
+
+	// models are decoded and configs read here, the main thread doesn't touch the
+	// asset registry while a level runs and joins this thread before it does
+	hed_preload *preload = arg;
+	hed_loader *loader = &preload->loader;
+
+	bool full = false;
+
+	// files and sizes come from the level index, nothing is opened to find them
+	for(u8 l = 0; l < preload->level_count && !full; l++) {
+		const hed_index_level *level = preload->levels[l];
+
+		for(u32 i = level->asset_first; i < level->asset_first + level->asset_count && !full; i++) {
+			const hed_index_asset *source = &engine.index.assets[i];
+
+			if(__atomic_load_n(&loader->cancel, __ATOMIC_RELAXED)) {
+				return NULL;
+			}
+
+			if(source->size < 0 || preload->held_count == preload->held_capacity) {
+				continue;
+			}
+
+			char path[U8];
+			(void)snprintf(path, sizeof(path),
+			"%s%s%s", engine.config.resources, SEP, source->name);
+
+			hed_asset *asset = he_engine_acquire_asset(path);
+			if(asset == NULL) {
+				continue;
+			}
+
+			preload->held[preload->held_count++] = asset;
+
+			// new files are decoded one by one and charged what they take decoded,
+			// resident ones are free. The one crossing the budget is kept
+			bool loaded = asset->decoded && (engine.headless || asset->uploaded);
+
+			if(!loaded && asset->refs == 1) {
+				pthread_mutex_lock(&loader->lock);
+				loader->queue[loader->count++] = asset;
+				pthread_mutex_unlock(&loader->lock);
+
+				// this thread is the only worker
+				(void)he_engine_decode_assets(loader);
+				preload->used += he_engine_asset_bytes(asset);
+			}
+
+			full = preload->used >= preload->budget;
+		}
+
+		// a level missing files or models fails or waits on the switch anyway
+		if(full || level->missing > 0 || __atomic_load_n(&loader->cancel, __ATOMIC_RELAXED)) {
+			continue;
+		}
+
+		// configs are read with every model decoded, logic checks animations against them
+		char path[U8], logic[U8];
+		(void)snprintf(path, sizeof(path),
+		"%s%s%s", engine.config.level, SEP, level->name);
+
+		(void)snprintf(logic, sizeof(logic),
+		"%s%s%s", path, SEP, CFG_printfIC);
+
+		int64_t stamp = he_engine_level_stamp(path);
+		hed_level *next = calloc(1, sizeof(hed_level));
+
+		if(next == NULL || he_engine_read_level(next, path) || he_engine_parse_logic(next, logic)) {
+			printf("Preloading %s failed, it is read when switched to.\n", path);
+
+			if(next != NULL) {
+				he_engine_free_level(next);
+				free(next);
+			}
+
+			continue;
+		}
+
+		preload->parsed[l] = next;
+		preload->stamps[l] = stamp;
+		preload->used += he_engine_level_bytes(next);
+
+		full = preload->used >= preload->budget;
+	}
+
+	if(full && engine.debug) {
+		printf("Preload budget of %llu MB reached.\n",
+		(unsigned long long)(preload->budget / (1024 * 1024)));
+	}
+
+	return NULL;
+}
+
+void
+he_engine_stream_preload(void) {
+
+	// a slice of every frame goes to uploading what the thread decoded
+	hed_preload *preload = &engine.preload;
+
+	if(!preload->running || engine.headless) {
+		return;
+	}
+
+	double start = he_engine_clock();
+
+	while(he_engine_clock() - start < PRELOAD_SLICE) {
+		pthread_mutex_lock(&preload->loader.lock);
+		bool ready = preload->uploaded < preload->loader.count &&
+			preload->loader.queue[preload->uploaded]->decoded;
+		pthread_mutex_unlock(&preload->loader.lock);
+
+		if(!ready) {
+			break;
+		}
+
+		// a reload while preloading may have loaded it with the level
+		hed_asset *asset = preload->loader.queue[preload->uploaded++];
+
+		if(!asset->uploaded) {
+			he_engine_upload_asset(asset);
+		}
+	}
+}
+
+void
+he_engine_finish_preload(void) {
+
+	// whatever wasn't uploaded yet goes with the next level's load
+	hed_preload *preload = &engine.preload;
+
+	if(!preload->running) {
+		return;
+	}
+
+	(void)pthread_join(preload->thread, NULL);
+	(void)pthread_mutex_destroy(&preload->loader.lock);
+	preload->running = false;
+
+	if(engine.debug) {
+		u8 parsed = 0;
+
+		for(u8 l = 0; l < preload->level_count; l++) {
+			parsed += preload->parsed[l] != NULL;
+		}
+
+		printf("Preloaded %u assets and %u levels, %u uploaded while playing, %.1f MB.\n",
+		preload->held_count, parsed, preload->uploaded, preload->used / (1024.0 * 1024.0));
+	}
+}
+
+hed_level *
+he_engine_take_preload(const hed_index_level *entry) {
+
+	// the level switched to, if the thread read it and its configs weren't edited since
+	hed_preload *preload = &engine.preload;
+
+	if(preload->running) {
+		return NULL;
+	}
+
+	for(u8 l = 0; l < preload->level_count; l++) {
+		hed_level *level = preload->parsed[l];
+
+		if(preload->levels[l] != entry || level == NULL) {
+			continue;
+		}
+
+		preload->parsed[l] = NULL;
+
+		if(he_engine_level_stamp(level->name) != preload->stamps[l]) {
+			he_engine_free_level(level);
+			free(level);
+			return NULL;
+		}
+
+		return level;
+	}
+
+	return NULL;
+}
+
+size_t
+he_engine_asset_bytes(const hed_asset *asset) {
+
+	// what a decode leaves in memory until upload, packed meshes stay in the pack
+	size_t bytes = asset->clip_bytes +
+		asset->model.boneCount * (sizeof(BoneInfo) + sizeof(Transform));
+
+	for(int m = 0; m < asset->model.meshCount && asset->packed == NULL; m++) {
+		const Mesh *mesh = &asset->model.meshes[m];
+		size_t floats = (mesh->vertices != NULL) * 3 + (mesh->normals != NULL) * 3 +
+			(mesh->texcoords != NULL) * 2 + (mesh->texcoords2 != NULL) * 2 +
+			(mesh->tangents != NULL) * 4 + (mesh->boneWeights != NULL) * 4 +
+			(mesh->animVertices != NULL) * 3 + (mesh->animNormals != NULL) * 3;
+
+		bytes += (size_t)mesh->vertexCount * (floats * sizeof(float) +
+			(mesh->colors != NULL) * 4 + (mesh->boneIds != NULL) * 4);
+
+		if(mesh->indices != NULL) {
+			bytes += (size_t)mesh->triangleCount * 3 * sizeof(unsigned short);
+		}
+	}
+
+	for(int m = 0; m < asset->material_count && asset->materials != NULL; m++) {
+		for(int i = 0; i <= MATERIAL_MAP_EMISSION; i++) {
+			const Image *image = &asset->materials[m].images[i];
+
+			if(image->data != NULL) {
+				bytes += GetPixelDataSize(image->width, image->height, image->format);
+			}
+		}
+	}
+
+	return bytes;
+}
+
+void
+he_engine_release_preload(void) {
+
+	hed_preload *preload = &engine.preload;
+
+	// nothing it decodes from here on is wanted, it stops after the asset at hand
+	if(preload->running) {
+		__atomic_store_n(&preload->loader.cancel, true, __ATOMIC_RELAXED);
+	}
+
+	he_engine_finish_preload();
+
+	// levels read and not switched to give back their assets with the rest
+	for(u8 l = 0; l < preload->level_count; l++) {
+		if(preload->parsed[l] != NULL) {
+			he_engine_free_level(preload->parsed[l]);
+			free(preload->parsed[l]);
+			preload->parsed[l] = NULL;
+		}
+	}
+
+	for(u16 i = 0; i < preload->held_count; i++) {
+		he_engine_release_asset(preload->held[i]);
+	}
+
+	free(preload->held);
+	free(preload->loader.queue);
+
+	preload->held = NULL;
+	preload->loader.queue = NULL;
+	preload->held_count = 0;
+	preload->held_capacity = 0;
+	preload->level_count = 0;
+}
+
+void
+he_engine_release_asset(hed_asset *asset) {
+
+	// stays loaded until he_engine_collect_assets, next level may want it
+	if(asset != NULL && asset->refs > 0) {
+		asset->refs--;
+	}
+}
+
+void
+he_engine_collect_assets(void) {
+
+	hed_assets *assets = &engine.assets;
+	u16 unloaded = 0;
+
+	for(u16 i = 0; i < assets->count; ) {
+		hed_asset *asset = assets->items[i];
+
+		if(asset->refs > 0) {
+			i++;
+			continue;
+		}
+
+		free(asset->clip_rate);
+		he_engine_free_clips(asset);
+
+		if(asset->packed != NULL) {
+			he_pack_unload_model(asset);
+		}
+
+		else {
+			if(asset->uploaded) {
+				UnloadModel(asset->model);
+			}
+
+			// decoded and released before its upload came
+			else if(asset->staged) {
+				he_engine_free_staged(asset);
+			}
+
+			// frame poses went with compression, only the clip headers are left
+			free(asset->animations);
+		}
+
+		free(asset);
+		assets->items[i] = assets->items[--assets->count];
+		unloaded++;
+	}
+
+	if(engine.debug) {
+		printf("Assets: %u resident, %u unloaded.\n", assets->count, unloaded);
+	}
+}
+
+u8
+he_engine_draw_model(hed_model *model) {
+
+	hed_components *components = &engine.current_level->components;
+	u16 id = model->id;
+
+	if(components->flags[id] & MODEL_RENDER) {
+
+		// somewhere between previous and current tick
+		Vector3 position = Vector3Lerp(components->prev_position[id], components->position[id],
+			engine.timestep.alpha);
+		float angle = Lerp(components->prev_angle[id], components->angle[id], engine.timestep.alpha);
+
+		// off screen, no skinning and no draw call
+		if(!(components->flags[id] & MODEL_VISIBLE)) {
+			engine.culled++;
+			return 0;
+		}
+
+		engine.drawn++;
+
+		// shared meshes take this instance's skinned vertices, unless they still hold them
+		hed_skin *skin = &components->skin[id];
+
+		if((components->flags[id] & MODEL_ANIMATE) && skin->drawn != NULL &&
+		(skin->fresh || model->asset->skin != skin->drawn)) {
+			he_engine_upload_skin(&model->asset->model, skin->drawn);
+			model->asset->skin = skin->drawn;
+			skin->fresh = false;
+		}
+
+		DrawModelEx(model->asset->model, position, (Vector3){0.0f, 1.0f, 0.0f},
+		angle, components->scale[id], model->tint);
+
+		engine.draw_calls += model->asset->model.meshCount;
+
+		if(engine.debug) {
+			DrawBoundingBox(components->world[id], GREEN);
+		}
+	}
+
+	else {
+		return 0;
+	}
+	
+	return 0;
+}
+
+u8
+he_engine_build_batches(void) {
+
+	hed_level *level = engine.current_level;
+	hed_batches *batches = &level->batches;
+
+	// per-instance transforms come from the vertex shader, the default one ignores them
+	if(engine.instancing.id == 0) {
+		const char *vs =
+		"#version 330\n"
+		"in vec3 vertexPosition;\n"
+		"in vec2 vertexTexCoord;\n"
+		"in vec4 vertexColor;\n"
+		"in mat4 instanceTransform;\n"
+		"uniform mat4 mvp;\n"
+		"out vec2 fragTexCoord;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	fragTexCoord = vertexTexCoord;\n"
+		"	fragColor = vertexColor;\n"
+		"	gl_Position = mvp * instanceTransform * vec4(vertexPosition, 1.0);\n"
+		"}\n";
+
+		const char *fs =
+		"#version 330\n"
+		"in vec2 fragTexCoord;\n"
+		"in vec4 fragColor;\n"
+		"uniform sampler2D texture0;\n"
+		"uniform vec4 colDiffuse;\n"
+		"out vec4 finalColor;\n"
+		"void main() {\n"
+		"	finalColor = texture(texture0, fragTexCoord) * colDiffuse * fragColor;\n"
+		"}\n";
+
+		engine.instancing = LoadShaderFromMemory(vs, fs);
+		engine.instancing.locs[SHADER_LOC_MATRIX_MVP] = GetShaderLocation(engine.instancing, "mvp");
+		engine.instancing.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocationAttrib(engine.instancing, "instanceTransform");
+	}
+
+	if(level->entities_count == 0) {
+		return 0;
+	}
+
+	batches->items = calloc(level->entities_count, sizeof(hed_batch));
+	batches->members = malloc(level->entities_count * sizeof(u16));
+	batches->transforms = malloc(level->entities_count * sizeof(Matrix));
+
+	if(batches->items == NULL || batches->members == NULL || batches->transforms == NULL) {
+		printf("Out of memory for instanced batches.\n");
+		return 1;
+	}
+
+	// group by asset and tint, skinned entities pose the shared mesh so they draw alone
+	for(u16 i = 0; i < level->entities_count; i++) {
+		hed_model *entity = &level->entities[i];
+
+		if(entity->asset == NULL || (level->components.flags[ENTITY + i] & MODEL_ANIMATE)) {
+			continue;
+		}
+
+		u16 b = 0;
+		while(b < batches->count && (batches->items[b].asset != entity->asset ||
+		ColorToInt(batches->items[b].tint) != ColorToInt(entity->tint))) {
+			b++;
+		}
+
+		if(b == batches->count) {
+			batches->items[b].asset = entity->asset;
+			batches->items[b].tint = entity->tint;
+			batches->count++;
+		}
+
+		batches->items[b].count++;
+		entity->batch = b;
+	}
+
+	// lay members out batch after batch
+	u16 first = 0;
+
+	for(u16 b = 0; b < batches->count; b++) {
+		batches->items[b].first = first;
+		batches->items[b].dirty = true;
+		first += batches->items[b].count;
+		batches->items[b].count = 0;
+	}
+
+	for(u16 i = 0; i < level->entities_count; i++) {
+		hed_model *entity = &level->entities[i];
+
+		if(entity->batch != NO_BATCH) {
+			hed_batch *batch = &batches->items[entity->batch];
+			batches->members[batch->first + batch->count++] = i;
+		}
+	}
+
+	if(engine.debug) {
+		u16 instanced = 0;
+
+		for(u16 b = 0; b < batches->count; b++) {
+			instanced += batches->items[b].count > 1;
+		}
+
+		printf("Instanced batches: %u of %u, %u entities.\n", instanced, batches->count, first);
+	}
+
+	return 0;
+}
+
+void
+he_engine_draw_batch(hed_batch *batch) {
+
+	hed_level *level = engine.current_level;
+	hed_components *components = &level->components;
+	u16 *members = &level->batches.members[batch->first];
+	Matrix *transforms = &level->batches.transforms[batch->first];
+
+	// a single instance is cheaper through DrawModelEx
+	if(batch->count == 1) {
+		he_engine_draw_model(&level->entities[members[0]]);
+		return;
+	}
+
+	// transforms of still batches are kept from the last rebuild
+	if(batch->dirty) {
+		batch->drawn = 0;
+
+		for(u16 i = 0; i < batch->count; i++) {
+			u16 id = ENTITY + members[i];
+
+			if(!(components->flags[id] & MODEL_RENDER)) {
+				continue;
+			}
+
+			Vector3 position = Vector3Lerp(components->prev_position[id], components->position[id],
+				engine.timestep.alpha);
+			float angle = Lerp(components->prev_angle[id], components->angle[id], engine.timestep.alpha);
+			Vector3 scale = components->scale[id];
+
+			// same order DrawModelEx applies them
+			Matrix transform = MatrixMultiply(MatrixMultiply(
+				MatrixScale(scale.x, scale.y, scale.z),
+				MatrixRotateY(angle * DEG2RAD)),
+				MatrixTranslate(position.x, position.y, position.z));
+
+			transforms[batch->drawn++] = MatrixMultiply(batch->asset->model.transform, transform);
+
+			BoundingBox box = he_engine_render_box(id, position);
+			batch->bounds = batch->drawn == 1 ? box : he_engine_combine_bbox(batch->bounds, box);
+		}
+
+		// one more rebuild after the last move lands on the exact positions
+		batch->dirty = batch->moving;
+	}
+
+	// whole batch is in or out, members keep their transforms either way
+	bool visible = batch->drawn > 0 && he_engine_box_visible(batch->bounds);
+
+	for(u16 i = 0; i < batch->count; i++) {
+		if(visible) {
+			components->flags[ENTITY + members[i]] |= MODEL_VISIBLE;
+		}
+
+		else {
+			components->flags[ENTITY + members[i]] &= ~MODEL_VISIBLE;
+		}
+	}
+
+	if(!visible) {
+		engine.culled += batch->drawn;
+		return;
+	}
+
+	engine.drawn += batch->drawn;
+
+	Model *model = &batch->asset->model;
+
+	for(int i = 0; i < model->meshCount; i++) {
+		Material material = model->materials[model->meshMaterial[i]];
+		Color color = material.maps[MATERIAL_MAP_DIFFUSE].color;
+
+		// tint the way DrawModelEx does, material is shared so put it back after
+		material.maps[MATERIAL_MAP_DIFFUSE].color = (Color) {
+			(u8)(color.r * batch->tint.r / 255),
+			(u8)(color.g * batch->tint.g / 255),
+			(u8)(color.b * batch->tint.b / 255),
+			(u8)(color.a * batch->tint.a / 255)
+		};
+
+		material.shader = engine.instancing;
+		DrawMeshInstanced(model->meshes[i], material, transforms, batch->drawn);
+
+		material.maps[MATERIAL_MAP_DIFFUSE].color = color;
+		engine.draw_calls++;
+	}
+
+	if(engine.debug) {
+		for(u16 i = 0; i < batch->count; i++) {
+			DrawBoundingBox(components->world[ENTITY + members[i]], GREEN);
+		}
+	}
+}
+
+void
+he_engine_update_animations(float dt) {
+
+	he_jobs_for(he_engine_animate_range, &dt, engine.current_level->components.count, JOB_GRAIN);
+}
+
+void
+he_engine_animate_range(void *arg, u32 first, u32 count) {
+
+	// clips advance by elapsed time at their own rate, not by ticks or rendered frames,
+	// models culled last frame stay where they are
+	hed_components *components = &engine.current_level->components;
+	const u8 playing = MODEL_RENDER | MODEL_VISIBLE | MODEL_ANIMATE;
+	float dt = *(float *)arg;
+
+	for(u32 id = first; id < first + count; id++) {
+		if((components->flags[id] & playing) != playing) {
+			continue;
+		}
+
+		// far ones catch up on skipped ticks every 2nd or 4th tick, ids spread them over the ticks
+		u8 lod = components->anim_lod[id];
+
+		if(((engine.timestep.ticks + id) & ((1u << lod) - 1)) != 0) {
+			continue;
+		}
+
+		int frames = components->frame_count[id];
+		float rate = components->clip_rate[id];
+
+		if(frames <= 0 || rate <= 0.0f) {
+			continue;
+		}
+
+		float duration = frames / rate;
+		float time = components->clip_time[id] + dt * (1u << lod);
+
+		if(time >= duration) {
+			time = fmodf(time, duration);
+		}
+
+		components->clip_time[id] = time;
+		components->frame[id] = (int)(time * rate) < frames ? (int)(time * rate) : frames - 1;
+	}
+}
+
+void
+he_engine_store_transforms(void) {
+
+	hed_level *level = engine.current_level;
+	hed_components *components = &level->components;
+
+	// whole arrays, hero and map included
+	(void)memcpy(components->prev_position, components->position, components->count * sizeof(Vector3));
+	(void)memcpy(components->prev_angle, components->angle, components->count * sizeof(float));
+
+	for(u16 i = 0; i < level->batches.count; i++) {
+		level->batches.items[i].moving = false;
+	}
+}
+
+void
+he_engine_update_frustum(void) {
+
+	// Gribb-Hartmann, planes straight from the rows of projection * view
+	Camera *camera = &engine.camera;
+	float aspect = (float)GetScreenWidth() / (float)GetScreenHeight();
+
+	Matrix view = MatrixLookAt(camera->position, camera->target, camera->up);
+	Matrix projection = MatrixPerspective(camera->fovy * DEG2RAD, aspect, CULL_NEAR, CULL_FAR);
+	Matrix m = MatrixMultiply(view, projection);
+
+	Vector4 row0 = { m.m0, m.m4, m.m8, m.m12 };
+	Vector4 row1 = { m.m1, m.m5, m.m9, m.m13 };
+	Vector4 row2 = { m.m2, m.m6, m.m10, m.m14 };
+	Vector4 row3 = { m.m3, m.m7, m.m11, m.m15 };
+
+	Vector4 *planes = engine.frustum.planes;
+	planes[0] = (Vector4){ row3.x + row0.x, row3.y + row0.y, row3.z + row0.z, row3.w + row0.w };
+	planes[1] = (Vector4){ row3.x - row0.x, row3.y - row0.y, row3.z - row0.z, row3.w - row0.w };
+	planes[2] = (Vector4){ row3.x + row1.x, row3.y + row1.y, row3.z + row1.z, row3.w + row1.w };
+	planes[3] = (Vector4){ row3.x - row1.x, row3.y - row1.y, row3.z - row1.z, row3.w - row1.w };
+	planes[4] = (Vector4){ row3.x + row2.x, row3.y + row2.y, row3.z + row2.z, row3.w + row2.w };
+	planes[5] = (Vector4){ row3.x - row2.x, row3.y - row2.y, row3.z - row2.z, row3.w - row2.w };
+}
+
+bool
+he_engine_box_visible(BoundingBox box) {
+
+	// outside when the corner furthest along a plane normal is still behind it
+	for(int i = 0; i < 6; i++) {
+		Vector4 p = engine.frustum.planes[i];
+
+		float x = p.x >= 0.0f ? box.max.x : box.min.x;
+		float y = p.y >= 0.0f ? box.max.y : box.min.y;
+		float z = p.z >= 0.0f ? box.max.z : box.min.z;
+
+		if(p.x * x + p.y * y + p.z * z + p.w < 0.0f) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void
+he_engine_cull_models(void) {
+
+	he_jobs_for(he_engine_cull_range, NULL, engine.current_level->components.count, JOB_GRAIN);
+}
+
+void
+he_engine_cull_range(void *arg, u32 first, u32 count) {
+
+	// where the model is drawn this frame, batches decide for their members again
+	hed_components *components = &engine.current_level->components;
+
+	(void)arg;
+
+	for(u32 id = first; id < first + count; id++) {
+		if(!(components->flags[id] & MODEL_RENDER)) {
+			continue;
+		}
+
+		Vector3 position = Vector3Lerp(components->prev_position[id], components->position[id],
+			engine.timestep.alpha);
+
+		if(he_engine_box_visible(he_engine_render_box(id, position))) {
+			components->flags[id] |= MODEL_VISIBLE;
+		}
+
+		else {
+			components->flags[id] &= ~MODEL_VISIBLE;
+		}
+
+		// animation rate by distance, nobody sees a far model skip keyframes
+		float distance = Vector3DistanceSqr(position, engine.camera.position);
+
+		components->anim_lod[id] = distance > ANIM_LOD_FAR * ANIM_LOD_FAR ? 2 :
+		distance > ANIM_LOD_NEAR * ANIM_LOD_NEAR ? 1 : 0;
+	}
+}
+
+hed_asset *
+he_engine_level_asset(hed_level *level, const char *name) {
+
+	// by file name, hero and map first like they are in the components
+
+	if(level->hero.asset != NULL && strcmp(level->hero.name, name) == 0) {
+		return level->hero.asset;
+	}
+
+	if(level->map.asset != NULL && strcmp(level->map.name, name) == 0) {
+		return level->map.asset;
+	}
+
+	for(u16 i = 0; i < level->entities_count; i++) {
+		if(level->entities[i].asset != NULL && strcmp(level->entities[i].name, name) == 0) {
+			return level->entities[i].asset;
+		}
+	}
+
+	return NULL;
+}
+
+void
+he_engine_bake_clip(hed_asset *asset, int c) {
+
+	// decoded into matrices once, while what the model baked so far leaves room under pose_cap
+	hed_clip *clip = &asset->clips[c];
+	size_t size = (size_t)clip->frames * asset->model.boneCount * sizeof(hed_bone_pose);
+
+	clip->tried = true;
+
+	if(clip->poses != NULL || size == 0 || asset->pose_bytes + size > asset->pose_cap) {
+		return;
+	}
+
+	clip->poses = malloc(size);
+	clip->pose_skinned = calloc(clip->frames * ANIM_BLEND_STEPS, sizeof(u16));
+	clip->pose_pass = calloc(clip->frames * ANIM_BLEND_STEPS, sizeof(u32));
+
+	if(clip->poses == NULL || clip->pose_skinned == NULL || clip->pose_pass == NULL) {
+		printf("Out of memory for %d baked poses of %s.\n", clip->frames, asset->path);
+		free(clip->poses); free(clip->pose_skinned); free(clip->pose_pass);
+		clip->poses = NULL; clip->pose_skinned = NULL; clip->pose_pass = NULL;
+		return;
+	}
+
+	asset->pose_bytes += size;
+
+	// frames are independent, long clips spread over the job threads
+	hed_bake bake = { asset, c };
+	he_jobs_for(he_engine_bake_range, &bake, clip->frames, 64);
+}
+
+void
+he_engine_bake_assets(void) {
+
+	// clips of every loaded model in file order while they fit, before the level's first frame
+	// so the skin pass only looks poses up. Headless never skins
+	if(engine.headless) {
+		return;
+	}
+
+	for(u16 i = 0; i < engine.assets.count; i++) {
+		hed_asset *asset = engine.assets.items[i];
+		int baked = 0, tried = 0;
+
+		for(int c = 0; c < asset->animCount && asset->clips != NULL && asset->model.boneCount > 0; c++) {
+			if(!asset->clips[c].tried) {
+				he_engine_bake_clip(asset, c);
+				tried++;
+			}
+
+			baked += asset->clips[c].poses != NULL;
+		}
+
+		// models kept from the last level were reported when they loaded
+		if(tried > 0 && engine.debug) {
+			printf("Baked %d of %d clips of %s in %.1f of %.1f KB.\n", baked, asset->animCount, asset->path,
+			asset->pose_bytes / 1024.0, asset->pose_cap / 1024.0);
+		}
+	}
+}
+
+void
+he_engine_bake_range(void *arg, u32 first, u32 count) {
+
+	hed_bake *bake = arg;
+	hed_clip *clip = &bake->asset->clips[bake->clip];
+
+	for(u32 frame = first; frame < first + count; frame++) {
+		he_engine_pose_bones(&bake->asset->model, clip, frame, 0.0f, &clip->poses[frame * bake->asset->model.boneCount]);
+	}
+}
+
+const hed_bone_pose *
+he_engine_baked_pose(const hed_asset *asset, int clip, int frame) {
+
+	if(asset->clips == NULL || clip < 0 || clip >= asset->animCount || asset->clips[clip].poses == NULL) {
+		return NULL;
+	}
+
+	return &asset->clips[clip].poses[(frame % asset->clips[clip].frames) * asset->model.boneCount];
+}
+
+u8
+he_engine_compress_clips(hed_asset *asset) {
+
+	// raw size counts what LoadModelAnimations keeps, pose tables, frame poses and bone infos
+	asset->clips = calloc(asset->animCount, sizeof(hed_clip));
+	if(asset->clips == NULL) {
+		return 1;
+	}
+
+	for(int c = 0; c < asset->animCount; c++) {
+		const ModelAnimation *anim = &asset->animations[c];
+
+		if(he_clip_compress(&asset->clips[c], anim)) {
+			he_engine_free_clips(asset);
+			return 1;
+		}
+
+		asset->raw_bytes += (size_t)anim->frameCount * (anim->boneCount * sizeof(Transform) + sizeof(Transform *)) +
+		anim->boneCount * sizeof(BoneInfo);
+		asset->clip_bytes += asset->clips[c].bones * 3 * sizeof(hed_track) +
+		asset->clips[c].keys * (sizeof(u16) + 3 * sizeof(u16));
+	}
+
+	return 0;
+}
+
+void
+he_engine_drop_poses(hed_asset *asset) {
+
+	// sampling only reads the compressed clips from here on
+	if(asset->animCount == 0) {
+		return;
+	}
+
+	u8 failed = he_engine_compress_clips(asset);
+
+	if(failed) {
+		printf("Out of memory for compressing animations of %s, it won't animate.\n", asset->path);
+	}
+
+	for(int c = 0; c < asset->animCount; c++) {
+		ModelAnimation *anim = &asset->animations[c];
+
+		// packed frames live in the mapped pack, only the pointer table is ours
+		if(asset->packed == NULL) {
+			for(int i = 0; i < anim->frameCount; i++) {
+				free(anim->framePoses[i]);
+			}
+
+			free(anim->bones);
+		}
+
+		free(anim->framePoses);
+		anim->framePoses = NULL;
+		anim->bones = NULL;
+	}
+
+	if(failed) {
+		asset->animCount = 0;
+	}
+}
+
+void
+he_engine_free_clips(hed_asset *asset) {
+
+	if(asset->clips == NULL) {
+		return;
+	}
+
+	for(int c = 0; c < asset->animCount; c++) {
+		he_clip_free(&asset->clips[c]);
+	}
+
+	free(asset->clips);
+	asset->clips = NULL;
+}
+
+u8
+he_clip_compress(hed_clip *clip, const ModelAnimation *anim) {
+
+	// every bone gets a translation, rotation and scale track, room for every frame
+	// is taken up front and given back once the keys are picked
+	size_t most = (size_t)anim->frameCount * anim->boneCount * 3;
+
+	if(anim->frameCount <= 0 || anim->frameCount > UINT16_MAX) {
+		return 1;
+	}
+
+	clip->frames = anim->frameCount;
+	clip->bones = anim->boneCount;
+	clip->keys = 0;
+	clip->tracks = malloc(clip->bones * 3 * sizeof(hed_track) + 1);
+	clip->times = malloc(most * sizeof(u16) + 1);
+	clip->values = malloc(most * 3 * sizeof(u16) + 1);
+
+	float *raw = malloc(clip->frames * 4 * sizeof(float));
+
+	if(clip->tracks == NULL || clip->times == NULL || clip->values == NULL || raw == NULL) {
+		free(raw);
+		he_clip_free(clip);
+		return 1;
+	}
+
+	for(int b = 0; b < clip->bones; b++) {
+		for(int channel = 0; channel < 3; channel++) {
+			for(int f = 0; f < clip->frames; f++) {
+				Transform pose = anim->framePoses[f][b];
+				float *out = &raw[f * 4];
+
+				if(channel == 1) {
+					Quaternion q = QuaternionNormalize(pose.rotation);
+
+					// same hemisphere as the frame before, interpolation takes the short way
+					if(f > 0 && q.x * out[-4] + q.y * out[-3] + q.z * out[-2] + q.w * out[-1] < 0.0f) {
+						q = (Quaternion) { -q.x, -q.y, -q.z, -q.w };
+					}
+
+					out[0] = q.x; out[1] = q.y; out[2] = q.z; out[3] = q.w;
+				}
+
+				else {
+					Vector3 v = channel == 0 ? pose.translation : pose.scale;
+					out[0] = v.x; out[1] = v.y; out[2] = v.z; out[3] = 0.0f;
+				}
+			}
+
+			he_clip_track(clip, &clip->tracks[b * 3 + channel], raw, clip->frames, channel == 1);
+		}
+	}
+
+	free(raw);
+
+	u16 *times = realloc(clip->times, clip->keys * sizeof(u16) + 1);
+	u16 *values = realloc(clip->values, clip->keys * 3 * sizeof(u16) + 1);
+
+	if(times != NULL) clip->times = times;
+	if(values != NULL) clip->values = values;
+
+	return 0;
+}
+
+void
+he_clip_track(hed_clip *clip, hed_track *track, const float *raw, int frames, bool rotation) {
+
+	track->first = clip->keys;
+	track->count = 0;
+	track->min = track->extent = (Vector3) { 0 };
+
+	if(!rotation) {
+		Vector3 max = { raw[0], raw[1], raw[2] };
+		track->min = max;
+
+		for(int f = 1; f < frames; f++) {
+			track->min = Vector3Min(track->min, (Vector3) { raw[f * 4], raw[f * 4 + 1], raw[f * 4 + 2] });
+			max = Vector3Max(max, (Vector3) { raw[f * 4], raw[f * 4 + 1], raw[f * 4 + 2] });
+		}
+
+		track->extent = Vector3Subtract(max, track->min);
+	}
+
+	// greedy, every key reaches as far as the frames in between still fit
+	int start = 0;
+
+	for(int key = 0; ; ) {
+		clip->times[clip->keys] = key;
+		he_clip_encode(track, &raw[key * 4], rotation, &clip->values[clip->keys * 3]);
+		clip->keys++;
+		track->count++;
+
+		if(key == frames - 1) {
+			break;
+		}
+
+		start = key;
+		key = start + 1;
+
+		while(key + 1 < frames && key + 1 - start <= CLIP_MAX_GAP && he_clip_fits(clip, track, raw, start, key + 1, rotation)) {
+			key++;
+		}
+	}
+
+	// a channel that never moves keeps one key
+	const u16 *values = &clip->values[track->first * 3];
+	u32 same = 1;
+
+	while(same < track->count && memcmp(values, &values[same * 3], 3 * sizeof(u16)) == 0) {
+		same++;
+	}
+
+	if(same == track->count) {
+		clip->keys -= track->count - 1;
+		track->count = 1;
+	}
+}
+
+bool
+he_clip_fits(const hed_clip *clip, const hed_track *track, const float *raw, int start, int end, bool rotation) {
+
+	// against the quantized keys, the sampler never sees anything else
+	float a[4], b[4], at[4];
+	u16 key[3];
+
+	he_clip_decode(track, &clip->values[(clip->keys - 1) * 3], rotation, a);
+	he_clip_encode(track, &raw[end * 4], rotation, key);
+	he_clip_decode(track, key, rotation, b);
+
+	for(int f = start + 1; f < end; f++) {
+		he_clip_mix(a, b, (float)(f - start) / (end - start), rotation, at);
+
+		// q and -q are the same turn
+		float error = 0.0f, flipped = 0.0f;
+
+		for(int i = 0; i < (rotation ? 4 : 3); i++) {
+			error = fmaxf(error, fabsf(at[i] - raw[f * 4 + i]));
+			flipped = fmaxf(flipped, fabsf(at[i] + raw[f * 4 + i]));
+		}
+
+		if(fminf(error, rotation ? flipped : error) > CLIP_TOLERANCE) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void
+he_clip_encode(const hed_track *track, const float *value, bool rotation, u16 *out) {
+
+	if(!rotation) {
+		const float *min = &track->min.x, *extent = &track->extent.x;
+
+		for(int i = 0; i < 3; i++) {
+			float t = extent[i] > 0.0f ? (value[i] - min[i]) / extent[i] : 0.0f;
+			out[i] = (u16)lroundf(fminf(fmaxf(t, 0.0f), 1.0f) * UINT16_MAX);
+		}
+
+		return;
+	}
+
+	// the largest component is left out and rebuilt from the unit length,
+	// the other three fit in +-1/sqrt(2) at 15 bits, its index goes in the top bits
+	int largest = 0;
+
+	for(int i = 1; i < 4; i++) {
+		if(fabsf(value[i]) > fabsf(value[largest])) {
+			largest = i;
+		}
+	}
+
+	float sign = value[largest] < 0.0f ? -1.0f : 1.0f;
+
+	for(int i = 0, k = 0; i < 4; i++) {
+		if(i == largest) {
+			continue;
+		}
+
+		float t = (value[i] * sign + CLIP_QUAT_RANGE) / (2.0f * CLIP_QUAT_RANGE);
+		out[k++] = (u16)lroundf(fminf(fmaxf(t, 0.0f), 1.0f) * 0x7fff);
+	}
+
+	out[0] |= (largest & 1) << 15;
+	out[1] |= (largest >> 1) << 15;
+}
+
+void
+he_clip_decode(const hed_track *track, const u16 *key, bool rotation, float *out) {
+
+	if(!rotation) {
+		const float *min = &track->min.x, *extent = &track->extent.x;
+
+		for(int i = 0; i < 3; i++) {
+			out[i] = min[i] + key[i] * (1.0f / UINT16_MAX) * extent[i];
+		}
+
+		out[3] = 0.0f;
+		return;
+	}
+
+	int largest = (key[0] >> 15) | ((key[1] >> 15) << 1);
+	float sum = 0.0f;
+
+	for(int i = 0, k = 0; i < 4; i++) {
+		if(i == largest) {
+			continue;
+		}
+
+		out[i] = (key[k++] & 0x7fff) * (2.0f * CLIP_QUAT_RANGE / 0x7fff) - CLIP_QUAT_RANGE;
+		sum += out[i] * out[i];
+	}
+
+	out[largest] = sqrtf(fmaxf(1.0f - sum, 0.0f));
+}
+
+void
+he_clip_mix(const float *a, const float *b, float t, bool rotation, float *out) {
+
+	if(!rotation) {
+		for(int i = 0; i < 3; i++) {
+			out[i] = a[i] + (b[i] - a[i]) * t;
+		}
+
+		out[3] = 0.0f;
+		return;
+	}
+
+	// nlerp on the short way round, keys are close enough for it to track slerp
+	float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+	float sign = dot < 0.0f ? -1.0f : 1.0f;
+	float length = 0.0f;
+
+	for(int i = 0; i < 4; i++) {
+		out[i] = a[i] + (b[i] * sign - a[i]) * t;
+		length += out[i] * out[i];
+	}
+
+	length = length > 0.0f ? 1.0f / sqrtf(length) : 1.0f;
+
+	for(int i = 0; i < 4; i++) {
+		out[i] *= length;
+	}
+}
+
+void
+he_clip_track_at(const hed_clip *clip, const hed_track *track, int frame, float blend, bool rotation, float *out) {
+
+	// last key at or before frame, past the last one the clip loops to the first.
+	// keys spread about evenly over a clip, a guess from where frame is in it
+	// lands a step or two off and walking from there beats a binary search
+	const u16 *times = clip->times + track->first;
+	const u16 *values = clip->values + track->first * 3;
+	u32 count = track->count, lo = 0;
+
+	if(count == 1) {
+		he_clip_decode(track, values, rotation, out);
+		return;
+	}
+
+	if(count > 2) {
+		lo = (u32)frame * (count - 1) / clip->frames;
+
+		while(lo > 0 && times[lo] > frame) {
+			lo--;
+		}
+	}
+
+	while(lo + 1 < count && times[lo + 1] <= frame) {
+		lo++;
+	}
+
+	he_clip_decode(track, &values[lo * 3], rotation, out);
+
+	if(times[lo] == frame && blend <= 0.0f) {
+		return;
+	}
+
+	u32 next = lo + 1 < count ? lo + 1 : 0;
+	int span = next > 0 ? times[next] - times[lo] : clip->frames - times[lo];
+	float a[4], b[4];
+
+	(void)memcpy(a, out, sizeof(a));
+	he_clip_decode(track, &values[next * 3], rotation, b);
+	he_clip_mix(a, b, (frame - times[lo] + blend) / span, rotation, out);
+}
+
+Transform
+he_clip_sample(const hed_clip *clip, int bone, int frame, float blend) {
+
+	const hed_track *tracks = &clip->tracks[bone * 3];
+	float t[4], r[4], s[4];
+
+	he_clip_track_at(clip, &tracks[0], frame, blend, false, t);
+	he_clip_track_at(clip, &tracks[1], frame, blend, true, r);
+	he_clip_track_at(clip, &tracks[2], frame, blend, false, s);
+
+	return (Transform) { { t[0], t[1], t[2] }, { r[0], r[1], r[2], r[3] }, { s[0], s[1], s[2] } };
+}
+
+void
+he_clip_free(hed_clip *clip) {
+
+	free(clip->tracks); free(clip->times); free(clip->values);
+	free(clip->poses); free(clip->pose_skinned); free(clip->pose_pass);
+	(void)memset(clip, 0, sizeof(*clip));
+}
+
+void
+he_engine_skin_models(void) {
+
+	// main thread picks models whose pose changed and gives new ones their buffers,
+	// the skinning itself is split over the job threads
+	hed_level *level = engine.current_level;
+	hed_components *components = &level->components;
+	const u8 skinned = MODEL_RENDER | MODEL_VISIBLE | MODEL_ANIMATE;
+
+	components->skinning_count = 0;
+	engine.skin_pass++;
+
+	for(u32 id = 0; id < components->count; id++) {
+		if((components->flags[id] & skinned) != skinned) {
+			continue;
+		}
+
+		hed_asset *asset = he_engine_model(engine.current_level, id)->asset;
+		hed_skin *skin = &components->skin[id];
+
+		skin->drawn = NULL;
+
+		if(components->clip[id] >= asset->animCount || asset->model.boneCount == 0 || asset->clips == NULL) {
+			continue;
+		}
+
+		if(skin->asset != asset) {
+			u32 size = he_engine_skin_size(&asset->model);
+
+			skin->vertices = he_arena_alloc(&level->arena, size * sizeof(float));
+			skin->bones = he_arena_alloc(&level->arena, asset->model.boneCount * sizeof(hed_bone_pose));
+
+			if(skin->vertices == NULL || skin->bones == NULL) {
+				skin->vertices = NULL;
+				continue;
+			}
+
+			skin->asset = asset;
+			skin->clip = -1;
+		}
+
+		// sampled where the clip time falls between two keyframes, in ANIM_BLEND_STEPS
+		float between = components->clip_time[id] * components->clip_rate[id] - components->frame[id];
+		int step = (int)(between * ANIM_BLEND_STEPS);
+
+		step = step < 0 ? 0 : step >= ANIM_BLEND_STEPS ? ANIM_BLEND_STEPS - 1 : step;
+
+		// first model on a baked pose and step skins it, later ones in lockstep draw its vertices
+		const hed_bone_pose *baked = he_engine_baked_pose(asset, components->clip[id], components->frame[id]);
+
+		if(baked != NULL) {
+			hed_clip *clip = &asset->clips[components->clip[id]];
+			u32 pose = (baked - clip->poses) / asset->model.boneCount * ANIM_BLEND_STEPS + step;
+
+			if(clip->pose_pass[pose] == engine.skin_pass) {
+				skin->drawn = components->skin[clip->pose_skinned[pose]].vertices;
+				continue;
+			}
+
+			clip->pose_pass[pose] = engine.skin_pass;
+			clip->pose_skinned[pose] = id;
+		}
+
+		skin->drawn = skin->vertices;
+
+		if(skin->clip == components->clip[id] && skin->frame == components->frame[id] && skin->step == step) {
+			continue;
+		}
+
+		skin->clip = components->clip[id];
+		skin->frame = components->frame[id];
+		skin->step = step;
+		skin->fresh = true;
+		components->skinning[components->skinning_count++] = id;
+	}
+
+	he_jobs_for(he_engine_skin_range, components, components->skinning_count, JOB_SKIN_GRAIN);
+}
+
+void
+he_engine_skin_range(void *arg, u32 first, u32 count) {
+
+	hed_components *components = arg;
+
+	for(u32 i = first; i < first + count; i++) {
+		hed_skin *skin = &components->skin[components->skinning[i]];
+		const Model *model = &skin->asset->model;
+		const hed_bone_pose *bones = he_engine_baked_pose(skin->asset, skin->clip, skin->frame);
+		float blend = (float)skin->step / ANIM_BLEND_STEPS;
+
+		// clips that didn't fit the cache are posed by every model playing them,
+		// baked keyframes a step apart are close enough to blend as matrices
+		if(bones == NULL) {
+			he_engine_pose_bones(model, &skin->asset->clips[skin->clip], skin->frame, blend, skin->bones);
+			bones = skin->bones;
+		}
+
+		else if(skin->step > 0) {
+			he_engine_blend_bones(bones, he_engine_baked_pose(skin->asset, skin->clip, skin->frame + 1),
+			blend, model->boneCount, skin->bones);
+			bones = skin->bones;
+		}
+
+		he_engine_skin_model(model, bones, skin->vertices);
+	}
+}
+
+u32
+he_engine_skin_size(const Model *model) {
+
+	u32 size = 0;
+
+	for(int m = 0; m < model->meshCount; m++) {
+		const Mesh *mesh = &model->meshes[m];
+
+		if(mesh->boneIds != NULL && mesh->boneWeights != NULL) {
+			size += mesh->vertexCount * 6;
+		}
+	}
+
+	return size;
+}
+
+void
+he_engine_pose_bones(const Model *model, const hed_clip *clip, int frame, float blend, hed_bone_pose *bones) {
+
+	// same transform UpdateModelAnimation does for every vertex, done once per bone:
+	// out of the bind pose, scaled, turned and moved to the pose sampled from the compressed clip,
+	// blend of the way to the next frame
+	frame %= clip->frames;
+
+	for(int b = 0; b < model->boneCount; b++) {
+		if(b >= clip->bones) {
+			bones[b].vertex = bones[b].normal = MatrixIdentity();
+			continue;
+		}
+
+		bones[b] = he_engine_bone_pose(model->bindPose[b], he_clip_sample(clip, b, frame, blend));
+	}
+}
+
+hed_bone_pose
+he_engine_bone_pose(Transform bind, Transform at) {
+
+	hed_bone_pose bone;
+	Quaternion rotation = QuaternionMultiply(at.rotation, QuaternionInvert(bind.rotation));
+
+	bone.normal = QuaternionToMatrix(rotation);
+	bone.vertex = MatrixMultiply(MatrixMultiply(MatrixMultiply(
+		MatrixTranslate(-bind.translation.x, -bind.translation.y, -bind.translation.z),
+		MatrixScale(at.scale.x, at.scale.y, at.scale.z)),
+		bone.normal),
+		MatrixTranslate(at.translation.x, at.translation.y, at.translation.z));
+
+	return bone;
+}
+
+void
+he_engine_blend_bones(const hed_bone_pose *from, const hed_bone_pose *to, float blend, int count, hed_bone_pose *bones) {
+
+	for(int b = 0; b < count; b++) {
+		bones[b].vertex = he_engine_lerp_matrix(from[b].vertex, to[b].vertex, blend);
+		bones[b].normal = he_engine_lerp_matrix(from[b].normal, to[b].normal, blend);
+	}
+}
+
+Matrix
+he_engine_lerp_matrix(Matrix a, Matrix b, float t) {
+
+	// raylib keeps the 16 floats in a row, MatrixToFloatV reads them the same way
+	Matrix m;
+	const float *x = &a.m0, *y = &b.m0;
+	float *out = &m.m0;
+
+	for(int i = 0; i < 16; i++) {
+		out[i] = x[i] + (y[i] - x[i]) * t;
+	}
+
+	return m;
+}
+
+void
+he_engine_skin_model(const Model *model, const hed_bone_pose *bones, float *vertices) {
+
+	// up to 4 weighted bones per vertex, weightless ones are skipped like raylib does
+	for(int m = 0; m < model->meshCount; m++) {
+		const Mesh *mesh = &model->meshes[m];
+
+		if(mesh->boneIds == NULL || mesh->boneWeights == NULL) {
+			continue;
+		}
+
+		float *normals = vertices + mesh->vertexCount * 3;
+
+		for(int v = 0; v < mesh->vertexCount; v++) {
+			Vector3 in = { mesh->vertices[v * 3], mesh->vertices[v * 3 + 1], mesh->vertices[v * 3 + 2] };
+			Vector3 in_normal = { 0 };
+			Vector3 out = { 0 }, out_normal = { 0 };
+
+			if(mesh->normals != NULL) {
+				in_normal = (Vector3) { mesh->normals[v * 3], mesh->normals[v * 3 + 1], mesh->normals[v * 3 + 2] };
+			}
+
+			for(int j = 0; j < 4; j++) {
+				float weight = mesh->boneWeights[v * 4 + j];
+
+				if(weight == 0.0f) {
+					continue;
+				}
+
+				const hed_bone_pose *bone = &bones[mesh->boneIds[v * 4 + j]];
+				out = Vector3Add(out, Vector3Scale(Vector3Transform(in, bone->vertex), weight));
+				out_normal = Vector3Add(out_normal, Vector3Scale(Vector3Transform(in_normal, bone->normal), weight));
+			}
+
+			vertices[v * 3] = out.x;
+			vertices[v * 3 + 1] = out.y;
+			vertices[v * 3 + 2] = out.z;
+
+			normals[v * 3] = out_normal.x;
+			normals[v * 3 + 1] = out_normal.y;
+			normals[v * 3 + 2] = out_normal.z;
+		}
+
+		vertices += mesh->vertexCount * 6;
+	}
+}
+
+void
+he_engine_upload_skin(const Model *model, const float *vertices) {
+
+	// only thing left on the render thread, positions and normals into the mesh buffers
+	for(int m = 0; m < model->meshCount; m++) {
+		const Mesh *mesh = &model->meshes[m];
+
+		if(mesh->boneIds == NULL || mesh->boneWeights == NULL) {
+			continue;
+		}
+
+		int size = mesh->vertexCount * 3 * sizeof(float);
+
+		UpdateMeshBuffer(*mesh, 0, vertices, size, 0);
+
+		if(mesh->normals != NULL) {
+			UpdateMeshBuffer(*mesh, 2, vertices + mesh->vertexCount * 3, size, 0);
+		}
+
+		vertices += mesh->vertexCount * 6;
+	}
+}
+
+BoundingBox
+he_engine_render_box(u16 id, Vector3 position) {
+
+	// model box scaled and grown to cover any turn around Y
+	hed_components *components = &engine.current_level->components;
+	Vector3 min = Vector3Multiply(components->box[id].min, components->scale[id]);
+	Vector3 max = Vector3Multiply(components->box[id].max, components->scale[id]);
+
+	float r = sqrtf(fmaxf(min.x * min.x, max.x * max.x) + fmaxf(min.z * min.z, max.z * max.z));
+
+	BoundingBox box = {
+		{ position.x - r, position.y + fminf(min.y, max.y), position.z - r },
+		{ position.x + r, position.y + fmaxf(min.y, max.y), position.z + r }
+	};
+
+	return box;
+}
+
+hed_model *
+he_engine_model(hed_level *level, u16 id) {
+
+	// model of an id from he_engine_check_model
+	if(id == HERO) {
+		return &level->hero;
+	}
+
+	if(id == MAP) {
+		return &level->map;
+	}
+
+	return &level->entities[id - ENTITY];
+}
+
+int
+he_engine_check_model(hed_level *level, const char *name, u32 len) {
+
+	// returns id of model in current level
+	// 0 = hero
+	// 1 = map
+	// >1 = entity
+	// -1 = doesn't exist
+	// name#n is the n-th copy of name counting from 0, plain name is the first one
+	hed_names *names = &level->names;
+	int found = he_engine_find_name(level, name, len);
+	u32 instance = 0;
+
+	if(found < 0) {
+		u32 mark = len;
+		while(mark > 0 && name[mark - 1] != '#') {
+			mark--;
+		}
+
+		if(mark == 0 || mark == len || mark == 1) {
+			return -1;
+		}
+
+		for(u32 i = mark; i < len; i++) {
+			if(name[i] < '0' || name[i] > '9' || instance > MAX_MODELS) {
+				return -1;
+			}
+
+			instance = instance * 10 + (name[i] - '0');
+		}
+
+		found = he_engine_find_name(level, name, mark - 1);
+	}
+
+	if(found < 0 || instance >= names->items[found].count) {
+		return -1;
+	}
+
+	return names->members[names->items[found].first + instance];
+}
+
+int
+he_engine_find_name(hed_level *level, const char *name, u32 len) {
+
+	hed_names *names = &level->names;
+
+	if(names->slot_count == 0) {
+		return -1;
+	}
+
+	u32 hash = he_engine_hash(name, len, 0);
+
+	for(u32 slot = hash & (names->slot_count - 1); names->slots[slot] != 0;
+	slot = (slot + 1) & (names->slot_count - 1)) {
+		hed_name *item = &names->items[names->slots[slot] - 1];
+
+		if(item->hash == hash && strncmp(item->str, name, len) == 0 && item->str[len] == 0) {
+			return names->slots[slot] - 1;
+		}
+	}
+
+	return -1;
+}
+
+u8
+he_engine_build_names(hed_level *level) {
+
+	// every model name interned once, logic then finds models in one probe
+	hed_names *names = &level->names;
+	u16 total = ENTITY + level->entities_count;
+
+	// a rebuild after hot reload leaves the old table behind in the arena
+	(void)memset(names, 0, sizeof(*names));
+
+	names->slot_count = 16;
+	while(names->slot_count < 2u * total) {
+		names->slot_count *= 2;
+	}
+
+	names->items = he_arena_alloc(&level->arena, total * sizeof(hed_name));
+	names->slots = he_arena_alloc(&level->arena, names->slot_count * sizeof(u16));
+	names->members = he_arena_alloc(&level->arena, total * sizeof(u16));
+
+	if(names->items == NULL || names->slots == NULL || names->members == NULL) {
+		printf("Out of memory for model names.\n");
+		(void)memset(names, 0, sizeof(*names));
+		return 1;
+	}
+
+	for(u16 id = 0; id < total; id++) {
+		hed_model *model = he_engine_model(level, id);
+		u32 len = model->name ? strlen(model->name) : 0;
+
+		// no MAP line, or a model that failed to load
+		if(len == 0) {
+			model->name_id = 0;
+			continue;
+		}
+
+		int found = he_engine_find_name(level, model->name, len);
+
+		if(found < 0) {
+			u32 hash = he_engine_hash(model->name, len, 0);
+			u32 slot = hash & (names->slot_count - 1);
+
+			while(names->slots[slot] != 0) {
+				slot = (slot + 1) & (names->slot_count - 1);
+			}
+
+			found = names->count++;
+			names->items[found] = (hed_name) { .str = model->name, .hash = hash };
+			names->slots[slot] = found + 1;
+		}
+
+		names->items[found].count++;
+		model->name_id = found;
+	}
+
+	// instances grouped by name, in id order
+	u16 first = 0;
+	for(u16 i = 0; i < names->count; i++) {
+		names->items[i].first = first;
+		first += names->items[i].count;
+		names->items[i].count = 0;
+	}
+
+	for(u16 id = 0; id < total; id++) {
+		hed_model *model = he_engine_model(level, id);
+
+		if(model->name != NULL && model->name[0] != 0) {
+			hed_name *item = &names->items[model->name_id];
+			names->members[item->first + item->count++] = id;
+		}
+	}
+
+	return 0;
+}
+
+u8
+he_engine_switch_animation(hed_model *model, int animation) {
+
+	int count = model->asset ? model->asset->animCount : 0;
+
+	// models without animations just stay still
+	if(animation >= count) {
+		if(count > 0) {
+			printf("Model animation error, animation number greater than number of animations.\n");
+			printf("Model %s anims: %d, Called anim num: %d\n", model->name, count, animation);
+		}
+
+		return 1;
+	}
+
+	else {
+		engine.current_level->components.clip[model->id] = animation;
+		engine.current_level->components.frame_count[model->id] = model->asset->animations[animation].frameCount;
+		engine.current_level->components.clip_rate[model->id] = he_engine_clip_rate(model->asset, animation);
+	}
+
+	return 0;
+}
+
+BoundingBox
+he_engine_combine_bbox(BoundingBox box1, BoundingBox box2) {
+	BoundingBox combined;
+
+	combined.min.x = fmin(box1.min.x, box2.min.x);
+	combined.min.y = fmin(box1.min.y, box2.min.y);
+	combined.min.z = fmin(box1.min.z, box2.min.z);
+	combined.max.x = fmax(box1.max.x, box2.max.x);
+	combined.max.y = fmax(box1.max.y, box2.max.y);
+	combined.max.z = fmax(box1.max.z, box2.max.z);
+
+	return combined;
+}
+
+BoundingBox
+he_engine_glb_bbox(const char *path) {
+
+	// glTF requires min/max on every POSITION accessor, so the bounds
+	// of all primitives can be read without decoding a single vertex.
+	// node transforms are not applied, same as mesh bounds in raylib.
+
+	BoundingBox box = { 0 };
+	bool first = true;
+
+	FILE *fp = fopen(path, "rb");
+	if(fp == NULL) {
+		printf("Cannot open %s for reading bounds.\n", path);
+		return box;
+	}
+
+	// 12 byte header, then JSON chunk length and type
+	u32 header[5];
+	if(fread(header, sizeof(u32), 5, fp) != 5 || header[0] != 0x46546C67 || header[4] != 0x4E4F534A) {
+		printf("%s is not a binary glTF, bounds unknown.\n", path);
+		fclose(fp);
+		return box;
+	}
+
+	// chunk length comes from the file, it can't be more than what follows the header
+	struct stat st;
+	char *json = NULL;
+
+	if(fstat(fileno(fp), &st) != 0 || header[3] > (u64)st.st_size - sizeof(header) ||
+	(json = malloc((size_t)header[3] + 1)) == NULL || fread(json, 1, header[3], fp) != header[3]) {
+		printf("Cannot read glTF header of %s.\n", path);
+		free(json);
+		fclose(fp);
+		return box;
+	}
+
+	fclose(fp);
+
+	json[header[3]] = 0;
+	const char *end = json + header[3];
+
+	const char *meshes = he_json_key(json, end, "meshes");
+	const char *accessors = he_json_key(json, end, "accessors");
+
+	for(const char *mesh = he_json_enter(meshes, end); mesh != NULL; mesh = he_json_next(mesh, end)) {
+		const char *primitives = he_json_key(mesh, end, "primitives");
+
+		for(const char *prim = he_json_enter(primitives, end); prim != NULL; prim = he_json_next(prim, end)) {
+			const char *position = he_json_key(he_json_key(prim, end, "attributes"), end, "POSITION");
+			if(position == NULL) {
+				continue;
+			}
+
+			const char *accessor = he_json_index(accessors, end, atoi(position));
+			BoundingBox current;
+
+			// positions have three components, anything else doesn't bound them
+			if(he_json_floats(he_json_key(accessor, end, "min"), end, &current.min.x, 3) != 3 ||
+			he_json_floats(he_json_key(accessor, end, "max"), end, &current.max.x, 3) != 3) {
+				continue;
+			}
+
+			box = first ? current : he_engine_combine_bbox(box, current);
+			first = false;
+		}
+	}
+
+	free(json);
+
+	return box;
+}
+
+u8
+he_engine_decode_model(hed_asset *asset) {
+
+	// what raylib's LoadGLTF builds before LoadModel uploads it: one mesh per triangle primitive,
+	// material 0 the default and one per glTF material after it, bones and bind pose of the skin
+	const char *ext = strrchr(asset->path, '.');
+
+	if(ext == NULL || (strcmp(ext, ".glb") != 0 && strcmp(ext, ".gltf") != 0)) {
+		return 1;
+	}
+
+	// cgltf is the parser raylib's LoadGLTF runs, so a file it rejects has nowhere else to go.
+	// Files cgltf reads but the decoder doesn't support are refused too, raylib would load them wrong
+	cgltf_options options = { 0 };
+	cgltf_data *data = NULL;
+	cgltf_result result = cgltf_parse_file(&options, asset->path, &data);
+
+	if(result == cgltf_result_success) {
+		result = cgltf_load_buffers(&options, data, asset->path);
+	}
+
+	if(result == cgltf_result_success) {
+		result = cgltf_validate(data);
+	}
+
+	asset->model.transform = MatrixIdentity();
+
+	// headless never draws, materials and their images are left out
+	u8 failed = result != cgltf_result_success || he_gltf_meshes(data, asset) ||
+	(!engine.headless && he_gltf_materials(data, asset)) || he_gltf_skin(data, asset);
+
+	if(result != cgltf_result_success) {
+		printf("glTF %s is unreadable(cgltf error %d).\n", asset->path, (int)result);
+	}
+
+	cgltf_free(data);
+
+	// the asset stays without meshes, drawn as nothing
+	if(failed) {
+		printf("Cannot decode %s, it is left without meshes.\n", asset->path);
+		he_engine_free_staged(asset);
+		asset->model.transform = MatrixIdentity();
+	}
+
+	asset->staged = true;
+
+	return 0;
+}
+
+void
+he_engine_upload_staged(hed_asset *asset) {
+
+	Model *model = &asset->model;
+
+	for(int i = 0; i < model->meshCount; i++) {
+		UploadMesh(&model->meshes[i], false);
+	}
+
+	for(int i = 0; i < asset->material_count; i++) {
+		hed_material *material = &asset->materials[i];
+
+		MaterialMap *maps;
+
+		model->materials[i] = LoadMaterialDefault();
+		maps = model->materials[i].maps;
+		maps[MATERIAL_MAP_ALBEDO].color = material->color;
+		maps[MATERIAL_MAP_METALNESS].value = material->metalness;
+		maps[MATERIAL_MAP_ROUGHNESS].value = material->roughness;
+		maps[MATERIAL_MAP_EMISSION].color = material->emission;
+
+		for(int m = 0; m <= MATERIAL_MAP_EMISSION; m++) {
+			if(material->images[m].data != NULL) {
+				maps[m].texture = LoadTextureFromImage(material->images[m]);
+			}
+
+			UnloadImage(material->images[m]);
+		}
+	}
+
+	free(asset->materials);
+	asset->materials = NULL;
+	asset->material_count = 0;
+	asset->staged = false;
+}
+
+void
+he_engine_free_staged(hed_asset *asset) {
+
+	Model *model = &asset->model;
+
+	for(int i = 0; model->meshes != NULL && i < model->meshCount; i++) {
+		Mesh *mesh = &model->meshes[i];
+
+		free(mesh->vertices); free(mesh->texcoords); free(mesh->texcoords2); free(mesh->normals);
+		free(mesh->tangents); free(mesh->colors); free(mesh->indices); free(mesh->animVertices);
+		free(mesh->animNormals); free(mesh->boneIds); free(mesh->boneWeights);
+	}
+
+	for(int i = 0; asset->materials != NULL && i < asset->material_count; i++) {
+		for(int m = 0; m <= MATERIAL_MAP_EMISSION; m++) {
+			UnloadImage(asset->materials[i].images[m]);
+		}
+	}
+
+	free(model->meshes); free(model->meshMaterial); free(model->materials); free(model->bones); free(model->bindPose);
+	free(asset->materials);
+
+	(void)memset(model, 0, sizeof(*model));
+	asset->materials = NULL;
+	asset->material_count = 0;
+	asset->staged = false;
+}
+
+u8
+he_gltf_meshes(const cgltf_data *data, hed_asset *asset) {
+
+	// points and lines are skipped like raylib does. Joints index the file's one skin,
+	// bone ids are bytes in raylib so there are never more than 256 of them
+	Model *model = &asset->model;
+	cgltf_size bones = data->skins_count == 1 && data->skins[0].joints_count < 256 ? data->skins[0].joints_count : 256;
+	int count = 0;
+
+	for(cgltf_size m = 0; m < data->meshes_count; m++) {
+		for(cgltf_size p = 0; p < data->meshes[m].primitives_count; p++) {
+			count += data->meshes[m].primitives[p].type == cgltf_primitive_type_triangles;
+		}
+	}
+
+	if(count == 0) {
+		printf("glTF %s has no triangles.\n", asset->path);
+		return 1;
+	}
+
+	model->meshes = calloc(count, sizeof(Mesh));
+	model->meshMaterial = calloc(count, sizeof(int));
+
+	if(model->meshes == NULL || model->meshMaterial == NULL) {
+		printf("Out of memory for meshes of %s.\n", asset->path);
+		return 1;
+	}
+
+	for(cgltf_size m = 0; m < data->meshes_count; m++) {
+		for(cgltf_size p = 0; p < data->meshes[m].primitives_count; p++) {
+			const cgltf_primitive *primitive = &data->meshes[m].primitives[p];
+
+			if(primitive->type != cgltf_primitive_type_triangles) {
+				continue;
+			}
+
+			// counted before decoding so a failed one is freed with the rest
+			Mesh *out = &model->meshes[model->meshCount++];
+
+			if(he_gltf_primitive(primitive, bones, out, asset->path)) {
+				return 1;
+			}
+
+			model->meshMaterial[model->meshCount - 1] = primitive->material != NULL ?
+				(int)(primitive->material - data->materials) + 1 : 0;
+		}
+	}
+
+	return 0;
+}
+
+u8
+he_gltf_primitive(const cgltf_primitive *primitive, cgltf_size bones, Mesh *mesh, const char *path) {
+
+	const cgltf_accessor *position = NULL, *normal = NULL, *texcoord = NULL, *texcoord2 = NULL;
+	const cgltf_accessor *tangent = NULL, *color = NULL, *joints = NULL, *weights = NULL;
+
+	if(primitive->has_draco_mesh_compression) {
+		printf("glTF %s has a Draco compressed primitive, those aren't supported.\n", path);
+		return 1;
+	}
+
+	// first set of every attribute raylib keeps, the second texcoords too
+	for(cgltf_size a = 0; a < primitive->attributes_count; a++) {
+		const cgltf_attribute *attribute = &primitive->attributes[a];
+		const cgltf_accessor **slot = NULL;
+
+		switch(attribute->type) {
+			case cgltf_attribute_type_position: slot = &position; break;
+			case cgltf_attribute_type_normal: slot = &normal; break;
+			case cgltf_attribute_type_tangent: slot = &tangent; break;
+			case cgltf_attribute_type_texcoord: slot = attribute->index == 0 ? &texcoord : attribute->index == 1 ? &texcoord2 : NULL; break;
+			case cgltf_attribute_type_color: slot = attribute->index == 0 ? &color : NULL; break;
+			case cgltf_attribute_type_joints: slot = attribute->index == 0 ? &joints : NULL; break;
+			case cgltf_attribute_type_weights: slot = attribute->index == 0 ? &weights : NULL; break;
+			default: break;
+		}
+
+		if(slot != NULL) {
+			*slot = attribute->data;
+		}
+	}
+
+	if(position == NULL) {
+		printf("glTF %s has a primitive without positions.\n", path);
+		return 1;
+	}
+
+	cgltf_size count = position->count;
+	float *colors = NULL, *ids = NULL;
+
+	if(count > INT32_MAX) {
+		printf("glTF %s has a primitive of %zu vertices, too many for a mesh.\n", path, count);
+		return 1;
+	}
+
+	mesh->vertexCount = (int)count;
+
+	// colors without alpha are opaque, either layout unpacks to floats first
+	u8 failed = he_gltf_floats(position, count, cgltf_type_vec3, &mesh->vertices, path) ||
+	he_gltf_floats(normal, count, cgltf_type_vec3, &mesh->normals, path) ||
+	he_gltf_floats(texcoord, count, cgltf_type_vec2, &mesh->texcoords, path) ||
+	he_gltf_floats(texcoord2, count, cgltf_type_vec2, &mesh->texcoords2, path) ||
+	he_gltf_floats(tangent, count, cgltf_type_vec4, &mesh->tangents, path) ||
+	he_gltf_floats(weights, count, cgltf_type_vec4, &mesh->boneWeights, path) ||
+	he_gltf_floats(joints, count, cgltf_type_vec4, &ids, path) ||
+	he_gltf_floats(color, count, color != NULL && color->type == cgltf_type_vec3 ? cgltf_type_vec3 : cgltf_type_vec4,
+		&colors, path);
+
+	if(!failed && colors != NULL && (mesh->colors = malloc(count * 4)) != NULL) {
+		int components = color->type == cgltf_type_vec3 ? 3 : 4;
+
+		for(cgltf_size i = 0; i < count; i++) {
+			for(int c = 0; c < 4; c++) {
+				float value = c < components ? colors[i * components + c] : 1.0f;
+				mesh->colors[i * 4 + c] = (u8)(fminf(fmaxf(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	// a joint past the skin would pose the vertex with some other bone
+	if(!failed && ids != NULL && (mesh->boneIds = malloc(count * 4)) != NULL) {
+		for(cgltf_size i = 0; i < count * 4 && !failed; i++) {
+			if(ids[i] < 0.0f || ids[i] >= (float)bones) {
+				printf("glTF %s binds a vertex to joint %.0f, the skin has %zu.\n", path, ids[i], bones);
+				failed = 1;
+				break;
+			}
+
+			mesh->boneIds[i] = (u8)ids[i];
+		}
+	}
+
+	failed = failed || (colors != NULL && mesh->colors == NULL) || (ids != NULL && mesh->boneIds == NULL);
+
+	free(colors);
+	free(ids);
+
+	if(failed) {
+		return 1;
+	}
+
+	if(primitive->indices == NULL) {
+		mesh->triangleCount = (int)(count / 3);
+	}
+
+	// 16 bit indices like raylib meshes take, cgltf reads indices only from a plain view
+	else {
+		const cgltf_accessor *indices = primitive->indices;
+
+		if(indices->is_sparse || indices->buffer_view == NULL || indices->buffer_view->has_meshopt_compression ||
+		indices->type != cgltf_type_scalar || indices->component_type == cgltf_component_type_r_32f) {
+			printf("glTF %s has an index accessor that isn't a plain list of integers.\n", path);
+			return 1;
+		}
+
+		mesh->indices = malloc(indices->count * sizeof(unsigned short));
+
+		if(mesh->indices == NULL) {
+			printf("Out of memory for indices of %s.\n", path);
+			return 1;
+		}
+
+		for(cgltf_size i = 0; i < indices->count; i++) {
+			cgltf_size index = cgltf_accessor_read_index(indices, i);
+
+			if(index >= count || index > UINT16_MAX) {
+				printf("glTF %s has vertex index %zu, meshes take %zu vertices and 16 bit indices.\n", path, index, count);
+				return 1;
+			}
+
+			mesh->indices[i] = (unsigned short)index;
+		}
+
+		mesh->triangleCount = (int)(indices->count / 3);
+	}
+
+	// skinned meshes get the arrays animation writes into
+	if(mesh->boneIds != NULL && mesh->boneWeights != NULL) {
+		mesh->animVertices = malloc(count * 3 * sizeof(float));
+
+		if(mesh->animVertices == NULL) {
+			printf("Out of memory for skinned vertices of %s.\n", path);
+			return 1;
+		}
+
+		(void)memcpy(mesh->animVertices, mesh->vertices, count * 3 * sizeof(float));
+
+		if(mesh->normals != NULL) {
+			mesh->animNormals = malloc(count * 3 * sizeof(float));
+
+			if(mesh->animNormals == NULL) {
+				printf("Out of memory for skinned vertices of %s.\n", path);
+				return 1;
+			}
+
+			(void)memcpy(mesh->animNormals, mesh->normals, count * 3 * sizeof(float));
+		}
+	}
+
+	return 0;
+}
+
+u8
+he_gltf_floats(const cgltf_accessor *accessor, cgltf_size count, cgltf_type type, float **out, const char *path) {
+
+	// a missing attribute stays NULL. cgltf unpacks every component type, normalized and sparse
+	// accessors, what it can't is an attribute of another shape or in a meshopt compressed view
+	if(accessor == NULL) {
+		return 0;
+	}
+
+	cgltf_size floats = count * cgltf_num_components(type);
+
+	if(accessor->type != type || accessor->count != count ||
+	(accessor->buffer_view != NULL && accessor->buffer_view->has_meshopt_compression)) {
+		printf("glTF %s has a vertex accessor of an unsupported layout.\n", path);
+		return 1;
+	}
+
+	*out = malloc(floats * sizeof(float));
+
+	if(*out == NULL) {
+		printf("Out of memory for vertices of %s.\n", path);
+		return 1;
+	}
+
+	if(cgltf_accessor_unpack_floats(accessor, *out, floats) != floats) {
+		printf("glTF %s has a vertex accessor cgltf can't read.\n", path);
+		return 1;
+	}
+
+	return 0;
+}
+
+u8
+he_gltf_materials(const cgltf_data *data, hed_asset *asset) {
+
+	int count = (int)data->materials_count + 1;
+
+	// filled with raylib's defaults on upload, shaders and textures need the GL context
+	asset->model.materials = calloc(count, sizeof(Material));
+	asset->materials = calloc(count, sizeof(hed_material));
+
+	if(asset->model.materials == NULL || asset->materials == NULL) {
+		printf("Out of memory for materials of %s.\n", asset->path);
+		return 1;
+	}
+
+	asset->model.materialCount = count;
+	asset->material_count = count;
+	asset->materials[0].color = WHITE;
+
+	// the maps LoadGLTF fills, images are decoded here and uploaded with the meshes
+	for(int i = 1; i < count; i++) {
+		const cgltf_material *material = &data->materials[i - 1];
+		const cgltf_pbr_metallic_roughness *pbr = &material->pbr_metallic_roughness;
+		hed_material *out = &asset->materials[i];
+		const float *factor = pbr->base_color_factor;
+
+		out->color = (Color) { (u8)(fminf(fmaxf(factor[0], 0.0f), 1.0f) * 255.0f),
+			(u8)(fminf(fmaxf(factor[1], 0.0f), 1.0f) * 255.0f), (u8)(fminf(fmaxf(factor[2], 0.0f), 1.0f) * 255.0f),
+			(u8)(fminf(fmaxf(factor[3], 0.0f), 1.0f) * 255.0f) };
+		out->metalness = pbr->metallic_factor;
+		out->roughness = pbr->roughness_factor;
+
+		factor = material->emissive_factor;
+		out->emission = (Color) { (u8)(fminf(fmaxf(factor[0], 0.0f), 1.0f) * 255.0f),
+			(u8)(fminf(fmaxf(factor[1], 0.0f), 1.0f) * 255.0f), (u8)(fminf(fmaxf(factor[2], 0.0f), 1.0f) * 255.0f), 255 };
+
+		const cgltf_texture *textures[MATERIAL_MAP_EMISSION + 1] = { 0 };
+
+		textures[MATERIAL_MAP_ALBEDO] = pbr->base_color_texture.texture;
+		textures[MATERIAL_MAP_ROUGHNESS] = pbr->metallic_roughness_texture.texture;
+		textures[MATERIAL_MAP_NORMAL] = material->normal_texture.texture;
+		textures[MATERIAL_MAP_OCCLUSION] = material->occlusion_texture.texture;
+		textures[MATERIAL_MAP_EMISSION] = material->emissive_texture.texture;
+
+		for(int m = 0; m <= MATERIAL_MAP_EMISSION; m++) {
+			if(textures[m] != NULL && textures[m]->image != NULL) {
+				out->images[m] = he_gltf_image(textures[m]->image, asset->path);
+			}
+		}
+	}
+
+	return 0;
+}
+
+Image
+he_gltf_image(const cgltf_image *image, const char *path) {
+
+	// images are buffer views, data uris or files next to the glTF, raylib's image loaders only touch memory
+	const char *type = image->mime_type != NULL && strcmp(image->mime_type, "image/jpeg") == 0 ? ".jpg" : ".png";
+	Image out = { 0 };
+
+	if(image->uri == NULL) {
+		const cgltf_buffer_view *view = image->buffer_view;
+
+		if(view != NULL && view->buffer->data != NULL && view->size <= INT32_MAX) {
+			out = LoadImageFromMemory(type, (const u8 *)view->buffer->data + view->offset, (int)view->size);
+		}
+	}
+
+	else if(strncmp(image->uri, "data:", 5) == 0) {
+		const char *base64 = strchr(image->uri, ',');
+		cgltf_options options = { 0 };
+		void *bytes = NULL;
+
+		if(base64 != NULL) {
+			size_t length = strlen(++base64);
+
+			while(length > 0 && base64[length - 1] == '=') {
+				length--;
+			}
+
+			size_t size = length * 6 / 8;
+
+			if(size > 0 && size <= INT32_MAX && cgltf_load_buffer_base64(&options, size, base64, &bytes) == cgltf_result_success) {
+				type = strncmp(image->uri, "data:image/jpeg", 15) == 0 ? ".jpg" : ".png";
+				out = LoadImageFromMemory(type, bytes, (int)size);
+			}
+		}
+
+		free(bytes);
+	}
+
+	else {
+		// relative to the glTF, escapes like %20 decoded
+		const char *slash = strrchr(path, SEP[0]);
+		int dir = slash != NULL ? (int)(slash - path + 1) : 0;
+		char file[U8];
+
+		if(snprintf(file, sizeof(file), "%.*s%s", dir, path, image->uri) < (int)sizeof(file)) {
+			(void)cgltf_decode_uri(file + dir);
+			out = LoadImage(file);
+		}
+	}
+
+	if(out.data == NULL) {
+		printf("glTF %s has an image that can't be read, its map keeps the default texture.\n", path);
+	}
+
+	return out;
+}
+
+u8
+he_gltf_skin(const cgltf_data *data, hed_asset *asset) {
+
+	// raylib takes bones from a file with exactly one skin
+	if(data->skins_count != 1) {
+		return 0;
+	}
+
+	const cgltf_skin *skin = &data->skins[0];
+	Model *model = &asset->model;
+	int count = (int)skin->joints_count;
+
+	if(skin->joints_count > 256) {
+		printf("glTF %s has a skin of %zu joints, bone ids are bytes.\n", asset->path, skin->joints_count);
+		return 1;
+	}
+
+	model->bones = calloc(count + 1, sizeof(BoneInfo));
+	model->bindPose = calloc(count + 1, sizeof(Transform));
+
+	if(model->bones == NULL || model->bindPose == NULL) {
+		printf("Out of memory for bones of %s.\n", asset->path);
+		return 1;
+	}
+
+	for(int b = 0; b < count; b++) {
+		const cgltf_node *joint = skin->joints[b];
+		BoneInfo *bone = &model->bones[b];
+
+		(void)snprintf(bone->name, sizeof(bone->name), "%s", joint->name != NULL ? joint->name : "");
+		bone->parent = -1;
+
+		for(int k = 0; k < count; k++) {
+			if(joint->parent != NULL && skin->joints[k] == joint->parent) {
+				bone->parent = k;
+				break;
+			}
+		}
+
+		// bind pose is the joint's world transform, node transforms up to the root
+		float m[16];
+		cgltf_node_transform_world(joint, m);
+
+		Matrix world = { m[0], m[4], m[8], m[12], m[1], m[5], m[9], m[13],
+			m[2], m[6], m[10], m[14], m[3], m[7], m[11], m[15] };
+
+		Vector3 x = { world.m0, world.m1, world.m2 }, y = { world.m4, world.m5, world.m6 }, z = { world.m8, world.m9, world.m10 };
+		Vector3 scale = { Vector3Length(x), Vector3Length(y), Vector3Length(z) };
+		Matrix rotation = MatrixIdentity();
+
+		if(scale.x > 0.0f && scale.y > 0.0f && scale.z > 0.0f) {
+			rotation.m0 = x.x / scale.x; rotation.m1 = x.y / scale.x; rotation.m2 = x.z / scale.x;
+			rotation.m4 = y.x / scale.y; rotation.m5 = y.y / scale.y; rotation.m6 = y.z / scale.y;
+			rotation.m8 = z.x / scale.z; rotation.m9 = z.y / scale.z; rotation.m10 = z.z / scale.z;
+		}
+
+		model->bindPose[b] = (Transform) { { world.m12, world.m13, world.m14 },
+			QuaternionNormalize(QuaternionFromMatrix(rotation)), scale };
+	}
+
+	model->boneCount = count;
+
+	return 0;
+}
+
+u8
+he_bvh_load_map(hed_bvh *bvh, const char *path, Model *model) {
+
+	// cache sits next to the .glb and is valid while the .glb is unchanged
+	char cache[U8];
+	(void)snprintf(cache, sizeof(cache), "%s.bvh", path);
+
+	struct stat source;
+	if(stat(path, &source) != 0) {
+		return 1;
+	}
+
+	double start = he_engine_clock();
+	FILE *fp = fopen(cache, "rb");
+
+	if(fp != NULL) {
+		hed_bvh_header header;
+
+		if(fread(&header, sizeof(header), 1, fp) == 1 &&
+		memcmp(header.magic, BVH_MAGIC, sizeof(header.magic)) == 0 &&
+		header.source_mtime == (int64_t)source.st_mtime &&
+		header.source_size == (int64_t)source.st_size) {
+			bvh->nodes = malloc(header.node_count * sizeof(hed_bvh_node));
+			bvh->tris = malloc(header.tri_count * sizeof(hed_triangle));
+
+			if(bvh->nodes != NULL && bvh->tris != NULL &&
+			fread(bvh->nodes, sizeof(hed_bvh_node), header.node_count, fp) == header.node_count &&
+			fread(bvh->tris, sizeof(hed_triangle), header.tri_count, fp) == header.tri_count) {
+				bvh->node_count = header.node_count;
+				bvh->tri_count = header.tri_count;
+
+				if(he_bvh_check(bvh) == 0) {
+					fclose(fp);
+
+					printf("Map BVH loaded from %s, %u triangles, %u nodes in %.1f ms.\n",
+					cache, bvh->tri_count, bvh->node_count, (he_engine_clock() - start) * 1000.0);
+					return 0;
+				}
+
+				printf("Map BVH cache %s is corrupt, rebuilding it.\n", cache);
+			}
+
+			he_bvh_free(bvh);
+		}
+
+		fclose(fp);
+	}
+
+	// headless only has vertices of what the decoder or the pack read
+	if(model->meshCount == 0) {
+		printf("No map BVH cache for %s and no vertices to build it from.\n", path);
+		return 1;
+	}
+
+	u32 count = 0;
+	for(int i = 0; i < model->meshCount; i++) {
+		count += model->meshes[i].triangleCount;
+	}
+
+	hed_triangle *tris = malloc((count ? count : 1) * sizeof(hed_triangle));
+	if(tris == NULL) {
+		printf("Out of memory for map triangles.\n");
+		return 1;
+	}
+
+	// flatten every mesh, indexed or not
+	u32 n = 0;
+	for(int i = 0; i < model->meshCount; i++) {
+		Mesh *mesh = &model->meshes[i];
+
+		if(mesh->vertices == NULL) {
+			continue;
+		}
+
+		for(int t = 0; t < mesh->triangleCount; t++) {
+			Vector3 *corner[3] = { &tris[n].a, &tris[n].b, &tris[n].c };
+
+			for(int k = 0; k < 3; k++) {
+				int v = mesh->indices ? mesh->indices[t * 3 + k] : t * 3 + k;
+				*corner[k] = (Vector3){ mesh->vertices[v * 3], mesh->vertices[v * 3 + 1], mesh->vertices[v * 3 + 2] };
+			}
+
+			n++;
+		}
+	}
+
+	if(he_bvh_build(bvh, tris, n)) {
+		return 1;
+	}
+
+	printf("Map BVH built for %s, %u triangles, %u nodes in %.1f ms.\n",
+	path, bvh->tri_count, bvh->node_count, (he_engine_clock() - start) * 1000.0);
+
+	hed_bvh_header header = { BVH_MAGIC, bvh->node_count, bvh->tri_count,
+		(int64_t)source.st_mtime, (int64_t)source.st_size };
+
+	if( (fp = fopen(cache, "wb")) == NULL ) {
+		printf("Cannot write map BVH cache %s.\n", cache);
+		return 0;
+	}
+
+	(void)fwrite(&header, sizeof(header), 1, fp);
+	(void)fwrite(bvh->nodes, sizeof(hed_bvh_node), bvh->node_count, fp);
+	(void)fwrite(bvh->tris, sizeof(hed_triangle), bvh->tri_count, fp);
+	fclose(fp);
+
+	return 0;
+}
+
+u8
+he_bvh_build(hed_bvh *bvh, hed_triangle *tris, u32 count) {
+
+	// takes ownership of tris, they get reordered so leaves are contiguous
+	bvh->tris = tris;
+	bvh->tri_count = count;
+	bvh->node_count = 0;
+
+	if(count == 0) {
+		bvh->nodes = NULL;
+		return 0;
+	}
+
+	// median splits, never more than 2n nodes
+	bvh->nodes = malloc(2 * count * sizeof(hed_bvh_node));
+	Vector3 *centroids = malloc(count * sizeof(Vector3));
+
+	if(bvh->nodes == NULL || centroids == NULL) {
+		printf("Out of memory for map BVH.\n");
+		free(centroids);
+		he_bvh_free(bvh);
+		return 1;
+	}
+
+	for(u32 i = 0; i < count; i++) {
+		centroids[i] = Vector3Scale(Vector3Add(Vector3Add(tris[i].a, tris[i].b), tris[i].c), 1.0f / 3.0f);
+	}
+
+	he_bvh_split(bvh, centroids, 0, count);
+
+	free(centroids);
+	return 0;
+}
+
+u32
+he_bvh_split(hed_bvh *bvh, Vector3 *centroids, u32 first, u32 count) {
+
+	u32 index = bvh->node_count++;
+	hed_bvh_node *node = &bvh->nodes[index];
+
+	Vector3 cmin = centroids[first], cmax = centroids[first];
+	node->min = bvh->tris[first].a;
+	node->max = bvh->tris[first].a;
+
+	for(u32 i = first; i < first + count; i++) {
+		node->min = Vector3Min(node->min, Vector3Min(bvh->tris[i].a, Vector3Min(bvh->tris[i].b, bvh->tris[i].c)));
+		node->max = Vector3Max(node->max, Vector3Max(bvh->tris[i].a, Vector3Max(bvh->tris[i].b, bvh->tris[i].c)));
+		cmin = Vector3Min(cmin, centroids[i]);
+		cmax = Vector3Max(cmax, centroids[i]);
+	}
+
+	if(count <= BVH_LEAF_SIZE) {
+		node->offset = first;
+		node->count = count;
+		return index;
+	}
+
+	// split the longest axis at the median centroid, keeps the tree balanced
+	Vector3 extent = Vector3Subtract(cmax, cmin);
+	int axis = 0;
+	if(extent.y > extent.x) axis = 1;
+	if(extent.z > he_axis(extent, axis)) axis = 2;
+
+	u32 half = count / 2;
+	he_bvh_select(bvh->tris, centroids, first, first + count, first + half, axis);
+
+	node->count = 0;
+
+	// left child is always the next node
+	he_bvh_split(bvh, centroids, first, half);
+	u32 right = he_bvh_split(bvh, centroids, first + half, count - half);
+
+	bvh->nodes[index].offset = right;
+
+	return index;
+}
+
+void
+he_bvh_select(hed_triangle *tris, Vector3 *centroids, long lo, long hi, long nth, int axis) {
+
+	// quickselect, after it every centroid before nth is <= every one after
+	hi--;
+
+	while(lo < hi) {
+		float pivot = he_axis(centroids[(lo + hi) / 2], axis);
+		long i = lo, j = hi;
+
+		while(i <= j) {
+			while(he_axis(centroids[i], axis) < pivot) i++;
+			while(he_axis(centroids[j], axis) > pivot) j--;
+
+			if(i <= j) {
+				hed_triangle t = tris[i]; tris[i] = tris[j]; tris[j] = t;
+				Vector3 c = centroids[i]; centroids[i] = centroids[j]; centroids[j] = c;
+				i++;
+				j--;
+			}
+		}
+
+		if(nth <= j) hi = j;
+		else if(nth >= i) lo = i;
+		else break;
+	}
+}
+
+bool
+he_bvh_raycast(const hed_bvh *bvh, Ray ray, float max_distance, RayCollision *hit) {
+
+	// nearest hit within max_distance, only nodes the ray passes through are visited
+	if(bvh->node_count == 0) {
+		return false;
+	}
+
+	Vector3 inv = { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+	u32 stack[BVH_STACK];
+	u32 top = 0;
+	float best = max_distance;
+	bool found = false;
+
+	stack[top++] = 0;
+
+	while(top > 0) {
+		const hed_bvh_node *node = &bvh->nodes[stack[--top]];
+
+		// slab test against node box, fminf/fmaxf drop the NaNs of axis parallel rays
+		float x0 = (node->min.x - ray.position.x) * inv.x, x1 = (node->max.x - ray.position.x) * inv.x;
+		float y0 = (node->min.y - ray.position.y) * inv.y, y1 = (node->max.y - ray.position.y) * inv.y;
+		float z0 = (node->min.z - ray.position.z) * inv.z, z1 = (node->max.z - ray.position.z) * inv.z;
+
+		float t0 = fmaxf(fmaxf(0.0f, fminf(x0, x1)), fmaxf(fminf(y0, y1), fminf(z0, z1)));
+		float t1 = fminf(fminf(best, fmaxf(x0, x1)), fminf(fmaxf(y0, y1), fmaxf(z0, z1)));
+
+		if(t0 > t1) {
+			continue;
+		}
+
+		if(node->count == 0) {
+			// he_bvh_check keeps loaded trees within the stack, built ones are balanced
+			if(top + 2 <= BVH_STACK) {
+				stack[top++] = node->offset;
+				stack[top++] = (u32)(node - bvh->nodes) + 1;
+			}
+
+			continue;
+		}
+
+		// Moller-Trumbore
+		for(u32 i = node->offset; i < node->offset + node->count; i++) {
+			const hed_triangle *tri = &bvh->tris[i];
+			Vector3 e1 = Vector3Subtract(tri->b, tri->a);
+			Vector3 e2 = Vector3Subtract(tri->c, tri->a);
+			Vector3 p = Vector3CrossProduct(ray.direction, e2);
+			float det = Vector3DotProduct(e1, p);
+
+			if(fabsf(det) < 1e-8f) {
+				continue;
+			}
+
+			float inv_det = 1.0f / det;
+			Vector3 s = Vector3Subtract(ray.position, tri->a);
+			float u = Vector3DotProduct(s, p) * inv_det;
+
+			if(u < 0.0f || u > 1.0f) {
+				continue;
+			}
+
+			Vector3 q = Vector3CrossProduct(s, e1);
+			float v = Vector3DotProduct(ray.direction, q) * inv_det;
+
+			if(v < 0.0f || u + v > 1.0f) {
+				continue;
+			}
+
+			float t = Vector3DotProduct(e2, q) * inv_det;
+
+			if(t >= 0.0f && t <= best) {
+				best = t;
+				found = true;
+
+				hit->hit = true;
+				hit->distance = t;
+				hit->point = Vector3Add(ray.position, Vector3Scale(ray.direction, t));
+				hit->normal = Vector3Normalize(Vector3CrossProduct(e1, e2));
+			}
+		}
+	}
+
+	return found;
+}
+
+bool
+he_bvh_overlap_box(const hed_bvh *bvh, BoundingBox box) {
+
+	if(bvh->node_count == 0) {
+		return false;
+	}
+
+	Vector3 center = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+	Vector3 half = Vector3Scale(Vector3Subtract(box.max, box.min), 0.5f);
+	u32 stack[BVH_STACK];
+	u32 top = 0;
+
+	stack[top++] = 0;
+
+	while(top > 0) {
+		const hed_bvh_node *node = &bvh->nodes[stack[--top]];
+
+		if(node->min.x > box.max.x || node->max.x < box.min.x ||
+		node->min.y > box.max.y || node->max.y < box.min.y ||
+		node->min.z > box.max.z || node->max.z < box.min.z) {
+			continue;
+		}
+
+		if(node->count == 0) {
+			// he_bvh_check keeps loaded trees within the stack, built ones are balanced
+			if(top + 2 <= BVH_STACK) {
+				stack[top++] = node->offset;
+				stack[top++] = (u32)(node - bvh->nodes) + 1;
+			}
+
+			continue;
+		}
+
+		for(u32 i = node->offset; i < node->offset + node->count; i++) {
+			if(he_bvh_tri_box(&bvh->tris[i], center, half)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool
+he_bvh_overlap_sphere(const hed_bvh *bvh, Vector3 center, float radius) {
+
+	if(bvh->node_count == 0) {
+		return false;
+	}
+
+	u32 stack[BVH_STACK];
+	u32 top = 0;
+
+	stack[top++] = 0;
+
+	while(top > 0) {
+		const hed_bvh_node *node = &bvh->nodes[stack[--top]];
+
+		// closest point of node box to the center
+		Vector3 closest = Vector3Min(Vector3Max(center, node->min), node->max);
+		if(Vector3DistanceSqr(closest, center) > radius * radius) {
+			continue;
+		}
+
+		if(node->count == 0) {
+			// he_bvh_check keeps loaded trees within the stack, built ones are balanced
+			if(top + 2 <= BVH_STACK) {
+				stack[top++] = node->offset;
+				stack[top++] = (u32)(node - bvh->nodes) + 1;
+			}
+
+			continue;
+		}
+
+		for(u32 i = node->offset; i < node->offset + node->count; i++) {
+			closest = he_bvh_closest_point(&bvh->tris[i], center);
+
+			if(Vector3DistanceSqr(closest, center) <= radius * radius) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool
+he_bvh_tri_box(const hed_triangle *tri, Vector3 center, Vector3 half) {
+
+	// separating axis test, box axes, triangle normal and 9 edge crosses
+	Vector3 v[3] = {
+		Vector3Subtract(tri->a, center),
+		Vector3Subtract(tri->b, center),
+		Vector3Subtract(tri->c, center)
+	};
+
+	Vector3 edges[3] = {
+		Vector3Subtract(v[1], v[0]),
+		Vector3Subtract(v[2], v[1]),
+		Vector3Subtract(v[0], v[2])
+	};
+
+	for(int axis = 0; axis < 3; axis++) {
+		float lo = fminf(he_axis(v[0], axis), fminf(he_axis(v[1], axis), he_axis(v[2], axis)));
+		float hi = fmaxf(he_axis(v[0], axis), fmaxf(he_axis(v[1], axis), he_axis(v[2], axis)));
+
+		if(lo > he_axis(half, axis) || hi < -he_axis(half, axis)) {
+			return false;
+		}
+	}
+
+	const Vector3 units[3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+
+	for(int i = 0; i < 4; i++) {
+		for(int j = 0; j < 3; j++) {
+
+			// last round is the triangle normal alone
+			Vector3 axis = i < 3 ? Vector3CrossProduct(units[i], edges[j]) :
+				Vector3CrossProduct(edges[0], edges[1]);
+
+			float p0 = Vector3DotProduct(v[0], axis);
+			float p1 = Vector3DotProduct(v[1], axis);
+			float p2 = Vector3DotProduct(v[2], axis);
+			float r = half.x * fabsf(axis.x) + half.y * fabsf(axis.y) + half.z * fabsf(axis.z);
+
+			if(fminf(p0, fminf(p1, p2)) > r || fmaxf(p0, fmaxf(p1, p2)) < -r) {
+				return false;
+			}
+
+			if(i == 3) {
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+Vector3
+he_bvh_closest_point(const hed_triangle *tri, Vector3 p) {
+
+	// Ericson, Real-Time Collision Detection 5.1.5
+	Vector3 ab = Vector3Subtract(tri->b, tri->a);
+	Vector3 ac = Vector3Subtract(tri->c, tri->a);
+	Vector3 ap = Vector3Subtract(p, tri->a);
+
+	float d1 = Vector3DotProduct(ab, ap), d2 = Vector3DotProduct(ac, ap);
+	if(d1 <= 0.0f && d2 <= 0.0f) return tri->a;
+
+	Vector3 bp = Vector3Subtract(p, tri->b);
+	float d3 = Vector3DotProduct(ab, bp), d4 = Vector3DotProduct(ac, bp);
+	if(d3 >= 0.0f && d4 <= d3) return tri->b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		return Vector3Add(tri->a, Vector3Scale(ab, d1 / (d1 - d3)));
+	}
+
+	Vector3 cp = Vector3Subtract(p, tri->c);
+	float d5 = Vector3DotProduct(ab, cp), d6 = Vector3DotProduct(ac, cp);
+	if(d6 >= 0.0f && d5 <= d6) return tri->c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		return Vector3Add(tri->a, Vector3Scale(ac, d2 / (d2 - d6)));
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		return Vector3Add(tri->b, Vector3Scale(Vector3Subtract(tri->c, tri->b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+	}
+
+	float denom = 1.0f / (va + vb + vc);
+	return Vector3Add(tri->a, Vector3Add(Vector3Scale(ab, vb * denom), Vector3Scale(ac, vc * denom)));
+}
+
+void
+he_bvh_free(hed_bvh *bvh) {
+	free(bvh->nodes);
+	free(bvh->tris);
+	(void)memset(bvh, 0, sizeof(*bvh));
+}
+
+u8
+he_bvh_check(const hed_bvh *bvh) {
+
+	// a cache is trusted only as a tree the builder could have made: left child right after
+	// its parent, right child past it, every node reached once, leaves inside the triangles
+	// and no path deeper than the traversal stack
+	if(bvh->node_count == 0) {
+		return 0;
+	}
+
+	u8 *seen = calloc(bvh->node_count, sizeof(u8));
+	if(seen == NULL) {
+		return 1;
+	}
+
+	u32 stack[BVH_STACK];
+	u32 top = 0, visited = 0;
+	u8 failed = 0;
+
+	stack[top++] = 0;
+
+	while(!failed && top > 0) {
+		u32 index = stack[--top];
+		const hed_bvh_node *node = &bvh->nodes[index];
+
+		if(seen[index]) {
+			failed = 1;
+			break;
+		}
+
+		seen[index] = 1;
+		visited++;
+
+		if(node->count > 0) {
+			failed = node->count > bvh->tri_count || node->offset > bvh->tri_count - node->count;
+			continue;
+		}
+
+		failed = top + 2 > BVH_STACK || index + 1 >= bvh->node_count ||
+		node->offset <= index + 1 || node->offset >= bvh->node_count;
+
+		if(!failed) {
+			stack[top++] = node->offset;
+			stack[top++] = index + 1;
+		}
+	}
+
+	free(seen);
+
+	return failed || visited != bvh->node_count;
+}
+
+u8
+he_index_load(void) {
+
+	hed_index *index = &engine.index;
+	struct stat folder;
+
+	if(stat(engine.config.level, &folder) != 0 || !S_ISDIR(folder.st_mode)) {
+		printf("Unable to open base folder.\n");
+		return 1;
+	}
+
+	char path[U8];
+	(void)snprintf(path, sizeof(path),
+	"%s%s%s", engine.config.base, SEP, INDEX_FILE);
+
+	FILE *fp = fopen(path, "rb");
+
+	if(fp != NULL) {
+		hed_index_header header;
+
+		if(fread(&header, sizeof(header), 1, fp) == 1 &&
+		memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+		header.level_count <= MAX_LEVELS &&
+		fread(index->levels, sizeof(hed_index_level), header.level_count, fp) == header.level_count) {
+			index->count = header.level_count;
+			index->next_id = header.next_id;
+			index->assets = malloc((header.asset_count ? header.asset_count : 1) * sizeof(hed_index_asset));
+			index->asset_count = index->asset_capacity = header.asset_count;
+
+			if(index->assets != NULL &&
+			fread(index->assets, sizeof(hed_index_asset), header.asset_count, fp) == header.asset_count &&
+			he_index_valid(index)) {
+				// levels folder untouched, nothing to scan
+				if(header.mtime == he_mtime(folder)) {
+					index->mtime = header.mtime;
+					fclose(fp);
+					return 0;
+				}
+			}
+
+			else {
+				printf("Index %s is corrupt or from another version, rebuilding it.\n", path);
+				free(index->assets);
+				index->assets = NULL;
+				index->asset_count = index->asset_capacity = 0;
+				index->count = 0;
+			}
+		}
+
+		fclose(fp);
+	}
+
+	// ids of levels still there are kept from the old index
+	return he_index_build(he_mtime(folder));
+}
+
+bool
+he_index_valid(const hed_index *index) {
+
+	// preload and prefetch walk level asset ranges and open asset names as they are
+	for(u16 i = 0; i < index->count; i++) {
+		const hed_index_level *level = &index->levels[i];
+
+		if(memchr(level->name, '\0', sizeof(level->name)) == NULL ||
+		level->asset_first > index->asset_count ||
+		level->asset_count > index->asset_count - level->asset_first) {
+			return false;
+		}
+	}
+
+	for(u32 i = 0; i < index->asset_count; i++) {
+		if(memchr(index->assets[i].name, '\0', sizeof(index->assets[i].name)) == NULL) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+u8
+he_index_build(int64_t mtime) {
+
+	hed_index *index = &engine.index;
+	hed_index old = *index;
+
+	double start = he_engine_clock();
+
+	DIR *dir = opendir(engine.config.level);
+	if(dir == NULL) {
+		printf("Unable to open base folder.\n");
+		return 1;
+	}
+
+	index->count = 0;
+	index->assets = NULL;
+	index->asset_count = index->asset_capacity = 0;
+
+	struct dirent *entry;
+	struct stat statbuf;
+	u8 failed = 0;
+
+	while(!failed && (entry = readdir(dir)) != NULL) {
+
+		// skip . and ..
+		if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+		char full_path[U8];
+		(void)snprintf(full_path, sizeof(full_path),
+		"%s%s%s", engine.config.level, SEP, entry->d_name);
+
+		// check if file is actually a folder
+		if(stat(full_path, &statbuf) != 0 || !S_ISDIR(statbuf.st_mode)) {
+			printf("File %s is not a folder, put only levels inside levels folder.\n", full_path);
+			failed = 1;
+			break;
+		}
+
+		if(index->count == MAX_LEVELS || strlen(entry->d_name) >= sizeof(index->levels[0].name)) {
+			printf("Level %s skipped, up to %d levels with names under %zu characters.\n",
+			entry->d_name, MAX_LEVELS, sizeof(index->levels[0].name));
+			continue;
+		}
+
+		hed_index_level *level = &index->levels[index->count++];
+		(void)memset(level, 0, sizeof(*level));
+		(void)snprintf(level->name, sizeof(level->name),
+		"%s", entry->d_name);
+
+		level->id = 0;
+		for(u16 i = 0; i < old.count; i++) {
+			if(strcmp(old.levels[i].name, level->name) == 0) {
+				level->id = old.levels[i].id;
+				break;
+			}
+		}
+
+		// 0 is never an id, saves use it for no level
+		if(level->id == 0) {
+			level->id = ++old.next_id;
+		}
+
+		(void)he_index_scan(level);
+	}
+
+	closedir(dir);
+	free(old.assets);
+
+	index->next_id = old.next_id;
+	index->mtime = mtime;
+
+	if(failed) {
+		return 1;
+	}
+
+	he_index_save();
+
+	printf("Level index built, %u levels, %u assets in %.1f ms.\n",
+	index->count, index->asset_count, (he_engine_clock() - start) * 1000.0);
+
+	return 0;
+}
+
+u8
+he_index_scan(hed_index_level *level) {
+
+	// media files cfg.resources names, each one once
+	hed_index *index = &engine.index;
+
+	level->asset_first = index->asset_count;
+	level->asset_count = 0;
+	level->missing = 0;
+	level->bytes = 0;
+	level->resources_mtime = level->resources_size = -1;
+
+	char resources[U8];
+	(void)snprintf(resources, sizeof(resources),
+	"%s%s%s%s%s", engine.config.level, SEP, level->name, SEP, CFG_RESOURCES);
+
+	struct stat source;
+	hed_lexer lex;
+
+	if(stat(resources, &source) != 0 || he_lex_open(&lex, resources)) {
+		printf("Level %s has no %s.\n", level->name, CFG_RESOURCES);
+		return 1;
+	}
+
+	level->resources_mtime = he_mtime(source);
+	level->resources_size = (int64_t)source.st_size;
+
+	hed_token tok;
+	int skip = -1; // tokens until a file name, -1 outside of HERO, MAP or ENTITY
+
+	while(he_lex_next(&lex, &tok)) {
+		int key = he_keywords_find(&Resources_Table, &tok);
+
+		if(key == RES_HERO || key == RES_MAP) {
+			skip = 0;
+			continue;
+		}
+
+		if(key == RES_ENTITY) {
+			skip = 1;
+			continue;
+		}
+
+		if(skip != 0) {
+			skip = skip > 0 ? skip - 1 : -1;
+			continue;
+		}
+
+		skip = -1;
+		he_index_add_asset(level, &tok);
+	}
+
+	he_lex_close(&lex);
+	return 0;
+}
+
+void
+he_index_add_asset(hed_index_level *level, const hed_token *tok) {
+
+	hed_index *index = &engine.index;
+
+	for(u32 i = level->asset_first; i < level->asset_first + level->asset_count; i++) {
+		if(he_lex_is(tok, index->assets[i].name)) {
+			return;
+		}
+	}
+
+	if(tok->len >= sizeof(index->assets[0].name)) {
+		printf("Level %s names %.*s, longer than %zu characters.\n", level->name,
+		(int)tok->len, tok->str, sizeof(index->assets[0].name) - 1);
+		level->missing++;
+		return;
+	}
+
+	if(index->asset_count == index->asset_capacity) {
+		u32 capacity = index->asset_capacity ? index->asset_capacity * 2 : 64;
+		hed_index_asset *assets = realloc(index->assets, capacity * sizeof(hed_index_asset));
+
+		if(assets == NULL) {
+			printf("Out of memory for level index.\n");
+			level->missing++;
+			return;
+		}
+
+		index->assets = assets;
+		index->asset_capacity = capacity;
+	}
+
+	hed_index_asset *asset = &index->assets[index->asset_count++];
+	level->asset_count++;
+
+	(void)memcpy(asset->name, tok->str, tok->len);
+	asset->name[tok->len] = 0;
+
+	char path[U8];
+	(void)snprintf(path, sizeof(path),
+	"%s%s%s", engine.config.resources, SEP, asset->name);
+
+	struct stat source;
+
+	if(stat(path, &source) != 0) {
+		printf("Level %s names %s, which is not in %s.\n", level->name, asset->name, BASE_MEDIA);
+		asset->size = -1;
+		level->missing++;
+		return;
+	}
+
+	asset->size = (int64_t)source.st_size;
+	level->bytes += source.st_size;
+}
+
+void
+he_index_save(void) {
+
+	// assets of rescanned levels were appended, written back packed
+	hed_index *index = &engine.index;
+
+	char path[U8];
+	(void)snprintf(path, sizeof(path),
+	"%s%s%s", engine.config.base, SEP, INDEX_FILE);
+
+	FILE *fp = fopen(path, "wb");
+	if(fp == NULL) {
+		printf("Cannot write level index %s.\n", path);
+		return;
+	}
+
+	hed_index_header header = { INDEX_MAGIC, index->count, 0, index->next_id, index->mtime };
+
+	for(u16 i = 0; i < index->count; i++) {
+		header.asset_count += index->levels[i].asset_count;
+	}
+
+	(void)fwrite(&header, sizeof(header), 1, fp);
+
+	u32 first = 0;
+	for(u16 i = 0; i < index->count; i++) {
+		hed_index_level level = index->levels[i];
+		level.asset_first = first;
+		first += level.asset_count;
+
+		(void)fwrite(&level, sizeof(level), 1, fp);
+	}
+
+	for(u16 i = 0; i < index->count; i++) {
+		(void)fwrite(&index->assets[index->levels[i].asset_first], sizeof(hed_index_asset),
+		index->levels[i].asset_count, fp);
+	}
+
+	fclose(fp);
+}
+
+hed_index_level *
+he_index_find(const char *path) {
+
+	// level folder path or plain level name, lookup only
+	const char *name = strrchr(path, SEP[0]);
+	name = name ? name + 1 : path;
+
+	for(u16 i = 0; i < engine.index.count; i++) {
+		if(strcmp(engine.index.levels[i].name, name) == 0) {
+			return &engine.index.levels[i];
+		}
+	}
+
+	return NULL;
+}
+
+hed_index_level *
+he_index_find_id(u32 id) {
+
+	for(u16 i = 0; i < engine.index.count; i++) {
+		if(engine.index.levels[i].id == id) {
+			return &engine.index.levels[i];
+		}
+	}
+
+	return NULL;
+}
+
+u8
+he_index_check(hed_index_level *level) {
+
+	// edited resources or media that was missing last time, scanned again.
+	// main thread only, preloading reads the index while a level runs
+	char resources[U8];
+	(void)snprintf(resources, sizeof(resources),
+	"%s%s%s%s%s", engine.config.level, SEP, level->name, SEP, CFG_RESOURCES);
+
+	struct stat source;
+	bool changed = stat(resources, &source) != 0 ||
+	he_mtime(source) != level->resources_mtime ||
+	(int64_t)source.st_size != level->resources_size;
+
+	if(changed || level->missing > 0) {
+		(void)he_index_scan(level);
+		he_index_save();
+	}
+
+	if(level->resources_mtime < 0) {
+		return 1;
+	}
+
+	if(level->missing > 0) {
+		printf("Level %s names %u files that cannot be loaded.\n", level->name, level->missing);
+		return 1;
+	}
+
+	return 0;
+}
+
+void
+he_index_prefetch(const hed_index_level *level) {
+
+	// kernel starts reading files in while configs are parsed,
+	// models the pack holds are already mapped
+	for(u32 i = level->asset_first; i < level->asset_first + level->asset_count; i++) {
+		char path[U8];
+		(void)snprintf(path, sizeof(path),
+		"%s%s%s", engine.config.resources, SEP, engine.index.assets[i].name);
+
+		if(engine.pack.data != NULL && he_pack_find(path, PACK_MODEL) != NULL) {
+			continue;
+		}
+
+		int fd = open(path, O_RDONLY);
+		if(fd < 0) {
+			continue;
+		}
+
+		(void)posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+}
+
+u8
+he_pack_open(void) {
+
+	char path[U8];
+	(void)snprintf(path, sizeof(path),
+	"%s%s%s", engine.config.base, SEP, PACK_FILE);
+
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
+		return 1;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(hed_pack_header)) {
+		close(fd);
+		return 1;
+	}
+
+	// private writable pages, skinning writes anim vertices in place without touching the file
+	u8 *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(data == MAP_FAILED) {
+		printf("Cannot map %s.\n", path);
+		return 1;
+	}
+
+	const hed_pack_header *header = (const hed_pack_header *)(void *)data;
+
+	engine.pack.data = data;
+	engine.pack.size = st.st_size;
+
+	if(memcmp(header->magic, PACK_MAGIC, sizeof(header->magic)) != 0 ||
+	!he_pack_fits(header->entries, header->entry_count, sizeof(hed_pack_entry))) {
+		printf("Pack %s is corrupt or from another version, ignoring it.\n", path);
+		he_pack_close();
+		return 1;
+	}
+
+	engine.pack.entries = he_pack_at(header->entries);
+	engine.pack.entry_count = header->entry_count;
+
+	// every offset the loaders follow is checked once here, a truncated or stale pack
+	// is dropped as a whole and everything loads from the files
+	for(u32 i = 0; i < engine.pack.entry_count; i++) {
+		const hed_pack_entry *entry = &engine.pack.entries[i];
+		u8 failed = memchr(entry->path, '\0', sizeof(entry->path)) == NULL || entry->offset == 0;
+
+		if(!failed && entry->kind == PACK_MODEL) {
+			failed = he_pack_check_model(entry->offset);
+		}
+
+		else if(!failed) {
+			failed = entry->kind != PACK_CONFIG || !he_pack_fits(entry->offset, entry->size, 1);
+		}
+
+		if(failed) {
+			printf("Pack %s is corrupt at entry %u, ignoring it.\n", path, i);
+			he_pack_close();
+			return 1;
+		}
+	}
+
+	if(he_pack_index()) {
+		printf("Out of memory indexing %s, ignoring it.\n", path);
+		he_pack_close();
+		return 1;
+	}
+
+	printf("Pack %s mapped, %u entries.\n", path, engine.pack.entry_count);
+
+	return 0;
+}
+
+void
+he_pack_close(void) {
+
+	if(engine.pack.data != NULL) {
+		(void)munmap(engine.pack.data, engine.pack.size);
+	}
+
+	free(engine.pack.slots);
+	free(engine.pack.checked);
+	(void)memset(&engine.pack, 0, sizeof(engine.pack));
+}
+
+const hed_pack_entry *
+he_pack_find(const char *path, u32 kind) {
+
+	if(engine.pack.slots == NULL) {
+		return NULL;
+	}
+
+	u32 mask = engine.pack.slot_count - 1;
+
+	for(u32 slot = he_engine_hash(path, strlen(path), kind) & mask; engine.pack.slots[slot] != 0; slot = (slot + 1) & mask) {
+		u32 i = engine.pack.slots[slot] - 1;
+		const hed_pack_entry *entry = &engine.pack.entries[i];
+
+		if(entry->kind != kind || strcmp(entry->path, path) != 0) {
+			continue;
+		}
+
+		// edited since the bake, load the file itself, the answer is kept until a hot reload
+		// clears it, loader threads may ask at the same time and reach the same answer
+		u8 checked = __atomic_load_n(&engine.pack.checked[i], __ATOMIC_RELAXED);
+
+		if(checked == 0) {
+			struct stat source;
+			checked = stat(path, &source) == 0 &&
+			(entry->source_mtime != (int64_t)source.st_mtime ||
+			entry->source_size != (int64_t)source.st_size) ? 2 : 1;
+
+			__atomic_store_n(&engine.pack.checked[i], checked, __ATOMIC_RELAXED);
+		}
+
+		return checked == 1 ? entry : NULL;
+	}
+
+	return NULL;
+}
+
+bool
+he_pack_fits(u64 offset, u64 count, u64 stride) {
+
+	// missing arrays are fine, present ones are aligned and lie past the header inside the file
+	if(offset == 0) {
+		return true;
+	}
+
+	return offset >= sizeof(hed_pack_header) && offset % PACK_ALIGN == 0 && offset <= engine.pack.size &&
+	count <= (engine.pack.size - offset) / stride;
+}
+
+u8
+he_pack_check_model(u64 offset) {
+
+	// every section decode and upload follow, arrays with a count are required to be there
+	#define he_needs(at, count, stride) \
+		(((count) > 0 && (at) == 0) || !he_pack_fits((at), (count), (stride)))
+
+	if(he_needs(offset, 1, sizeof(hed_pack_model))) {
+		return 1;
+	}
+
+	const hed_pack_model *packed = he_pack_at(offset);
+	u64 bones = packed->bone_count;
+
+	if(he_needs(packed->meshes, packed->mesh_count, sizeof(hed_pack_mesh)) ||
+	he_needs(packed->materials, packed->material_count, sizeof(hed_pack_material)) ||
+	he_needs(packed->mesh_material, packed->mesh_count, sizeof(int)) ||
+	he_needs(packed->bones, bones, sizeof(BoneInfo)) ||
+	he_needs(packed->bind_pose, bones, sizeof(Transform)) ||
+	he_needs(packed->anims, packed->anim_count, sizeof(hed_pack_anim)) ||
+	packed->mesh_count > INT32_MAX || packed->material_count > INT32_MAX ||
+	packed->bone_count > INT32_MAX || packed->anim_count > INT32_MAX) {
+		return 1;
+	}
+
+	const hed_pack_mesh *meshes = he_pack_at(packed->meshes);
+	const int *mesh_material = he_pack_at(packed->mesh_material);
+
+	for(u32 i = 0; i < packed->mesh_count; i++) {
+		const hed_pack_mesh *mesh = &meshes[i];
+		u64 v = mesh->vertex_count;
+
+		if(mesh_material[i] < 0 || (u32)mesh_material[i] >= packed->material_count ||
+		mesh->vertex_count > INT32_MAX || mesh->triangle_count > INT32_MAX ||
+		he_needs(mesh->vertices, v, 3 * sizeof(float)) ||
+		!he_pack_fits(mesh->texcoords, v, 2 * sizeof(float)) ||
+		!he_pack_fits(mesh->texcoords2, v, 2 * sizeof(float)) ||
+		!he_pack_fits(mesh->normals, v, 3 * sizeof(float)) ||
+		!he_pack_fits(mesh->tangents, v, 4 * sizeof(float)) ||
+		!he_pack_fits(mesh->colors, v, 4) ||
+		!he_pack_fits(mesh->indices, (u64)mesh->triangle_count * 3, sizeof(unsigned short)) ||
+		!he_pack_fits(mesh->anim_vertices, v, 3 * sizeof(float)) ||
+		!he_pack_fits(mesh->anim_normals, v, 3 * sizeof(float)) ||
+		!he_pack_fits(mesh->bone_ids, v, 4) ||
+		!he_pack_fits(mesh->bone_weights, v, 4 * sizeof(float))) {
+			return 1;
+		}
+
+		// unindexed triangles walk the vertices three at a time
+		if(mesh->indices == 0 && (u64)mesh->triangle_count * 3 > v) {
+			return 1;
+		}
+
+		// the map BVH reads corners through the indices, skinning reads bones through the ids
+		const unsigned short *indices = he_pack_at(mesh->indices);
+
+		for(u64 k = 0; indices != NULL && k < (u64)mesh->triangle_count * 3; k++) {
+			if(indices[k] >= v) {
+				return 1;
+			}
+		}
+
+		const u8 *ids = he_pack_at(mesh->bone_ids);
+		const float *weights = he_pack_at(mesh->bone_weights);
+
+		for(u64 k = 0; ids != NULL && weights != NULL && k < v * 4; k++) {
+			if(weights[k] != 0.0f && ids[k] >= packed->bone_count) {
+				return 1;
+			}
+		}
+	}
+
+	const hed_pack_material *materials = he_pack_at(packed->materials);
+
+	for(u32 i = 0; i < packed->material_count; i++) {
+		const hed_pack_material *material = &materials[i];
+
+		if(material->pixels == 0) {
+			continue;
+		}
+
+		if(material->width == 0 || material->width > INT16_MAX || material->height == 0 || material->height > INT16_MAX ||
+		material->format > INT32_MAX || he_needs(material->pixels,
+		(u64)GetPixelDataSize(material->width, material->height, material->format), 1)) {
+			return 1;
+		}
+	}
+
+	// clips are sampled over the model bones, every animation has to cover at least those
+	const hed_pack_anim *anims = he_pack_at(packed->anims);
+
+	for(u32 a = 0; a < packed->anim_count; a++) {
+		const hed_pack_anim *anim = &anims[a];
+
+		if(anim->bone_count < packed->bone_count || anim->bone_count > INT32_MAX || anim->frame_count > INT32_MAX ||
+		he_needs(anim->bones, anim->bone_count, sizeof(BoneInfo)) ||
+		he_needs(anim->poses, (u64)anim->frame_count * anim->bone_count, sizeof(Transform))) {
+			return 1;
+		}
+	}
+
+	#undef he_needs
+
+	return 0;
+}
+
+u8
+he_pack_index(void) {
+
+	// twice the entries rounded to a power of two, probes stay short
+	u32 slots = 16;
+
+	while(slots < engine.pack.entry_count * 2) {
+		slots *= 2;
+	}
+
+	engine.pack.slots = calloc(slots, sizeof(u32));
+	engine.pack.checked = calloc(engine.pack.entry_count + 1, sizeof(u8));
+
+	if(engine.pack.slots == NULL || engine.pack.checked == NULL) {
+		return 1;
+	}
+
+	engine.pack.slot_count = slots;
+
+	for(u32 i = 0; i < engine.pack.entry_count; i++) {
+		const hed_pack_entry *entry = &engine.pack.entries[i];
+		u32 slot = he_engine_hash(entry->path, strlen(entry->path), entry->kind) & (slots - 1);
+
+		while(engine.pack.slots[slot] != 0) {
+			slot = (slot + 1) & (slots - 1);
+		}
+
+		engine.pack.slots[slot] = i + 1;
+	}
+
+	return 0;
+}
+
+u8
+he_pack_bake(void) {
+
+	// every model in media and every level config into one file,
+	// models as raylib would hold them right before upload
+	double start = he_engine_clock();
+
+	hed_pack_writer writer = { 0 };
+	hed_pack_header header = { 0 };
+	(void)he_pack_put(&writer, &header, sizeof(header));
+
+	hed_pack_entry *entries = NULL;
+	u32 count = 0, capacity = 0;
+
+	const char *folders[] = { engine.config.resources, engine.config.level };
+
+	for(u8 f = 0; f < 2; f++) {
+		DIR *dir = opendir(folders[f]);
+
+		if(dir == NULL) {
+			printf("Cannot open %s for baking.\n", folders[f]);
+			free(entries);
+			free(writer.data);
+			return 1;
+		}
+
+		struct dirent *item;
+
+		while( (item = readdir(dir)) != NULL ) {
+			if(item->d_name[0] == '.') continue;
+
+			// media holds models, levels hold one folder with two configs each
+			const char *files[2] = { item->d_name, NULL };
+			u32 kind = PACK_MODEL;
+
+			if(f == 0) {
+				const char *ext = strrchr(item->d_name, '.');
+
+				if(ext == NULL || (strcmp(ext, ".glb") != 0 && strcmp(ext, ".gltf") != 0 &&
+				strcmp(ext, ".obj") != 0 && strcmp(ext, ".iqm") != 0 &&
+				strcmp(ext, ".vox") != 0 && strcmp(ext, ".m3d") != 0)) {
+					continue;
+				}
+			}
+
+			else {
+				files[0] = CFG_RESOURCES;
+				files[1] = CFG_printfIC;
+				kind = PACK_CONFIG;
+			}
+
+			for(u8 i = 0; i < 2 && files[i] != NULL; i++) {
+				char path[U8];
+
+				if(f == 0) {
+					(void)snprintf(path, sizeof(path),
+					"%s%s%s", folders[f], SEP, files[i]);
+				}
+
+				else {
+					(void)snprintf(path, sizeof(path),
+					"%s%s%s%s%s", folders[f], SEP, item->d_name, SEP, files[i]);
+				}
+
+				if(count == capacity) {
+					capacity = capacity ? capacity * 2 : 64;
+					hed_pack_entry *grown = realloc(entries, capacity * sizeof(hed_pack_entry));
+
+					if(grown == NULL) {
+						printf("Out of memory while baking.\n");
+						closedir(dir);
+						free(entries);
+						free(writer.data);
+						return 1;
+					}
+
+					entries = grown;
+				}
+
+				if(he_pack_put_entry(&writer, &entries[count], path, kind) == 0) {
+					count++;
+				}
+			}
+		}
+
+		closedir(dir);
+	}
+
+	(void)memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+	header.entry_count = count;
+	header.entries = he_pack_put(&writer, entries, count * sizeof(hed_pack_entry));
+	free(entries);
+
+	if(writer.failed) {
+		printf("Out of memory while baking.\n");
+		free(writer.data);
+		return 1;
+	}
+
+	(void)memcpy(writer.data, &header, sizeof(header));
+
+	// written aside and renamed, a running engine never maps half a pack
+	char path[U8], tmp[U8 + 4];
+	(void)snprintf(path, sizeof(path),
+	"%s%s%s", engine.config.base, SEP, PACK_FILE);
+	(void)snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+	FILE *fp = fopen(tmp, "wb");
+	if(fp == NULL || fwrite(writer.data, 1, writer.size, fp) != writer.size) {
+		printf("Cannot write %s.\n", tmp);
+
+		if(fp != NULL) {
+			fclose(fp);
+		}
+
+		free(writer.data);
+		return 1;
+	}
+
+	fclose(fp);
+	free(writer.data);
+
+	if(rename(tmp, path) != 0) {
+		printf("Cannot replace %s.\n", path);
+		return 1;
+	}
+
+	printf("Baked %u entries into %s, %.1f MB in %.1f ms.\n",
+	count, path, writer.size / (1024.0 * 1024.0), (he_engine_clock() - start) * 1000.0);
+
+	return 0;
+}
+
+u64
+he_pack_put(hed_pack_writer *writer, const void *src, u64 bytes) {
+
+	// missing arrays stay at offset 0, the header owns it
+	if(src == NULL || writer->failed) {
+		return 0;
+	}
+
+	u64 offset = (writer->size + PACK_ALIGN - 1) & ~(u64)(PACK_ALIGN - 1);
+
+	if(offset + bytes > writer->capacity) {
+		u64 capacity = writer->capacity ? writer->capacity * 2 : 1 << 20;
+
+		while(capacity < offset + bytes) {
+			capacity *= 2;
+		}
+
+		u8 *data = realloc(writer->data, capacity);
+		if(data == NULL) {
+			writer->failed = true;
+			return 0;
+		}
+
+		writer->data = data;
+		writer->capacity = capacity;
+	}
+
+	(void)memset(writer->data + writer->size, 0, offset - writer->size);
+	(void)memcpy(writer->data + offset, src, bytes);
+	writer->size = offset + bytes;
+
+	return offset;
+}
+
+u8
+he_pack_put_entry(hed_pack_writer *writer, hed_pack_entry *entry, const char *path, u32 kind) {
+
+	struct stat source;
+	if(stat(path, &source) != 0) {
+		return 1;
+	}
+
+	(void)memset(entry, 0, sizeof(*entry));
+	(void)snprintf(entry->path, sizeof(entry->path),
+	"%s", path);
+
+	entry->kind = kind;
+	entry->source_mtime = (int64_t)source.st_mtime;
+	entry->source_size = (int64_t)source.st_size;
+
+	if(kind == PACK_MODEL) {
+		entry->offset = he_pack_put_model(writer, path);
+		entry->size = sizeof(hed_pack_model);
+	}
+
+	else {
+		FILE *fp = fopen(path, "rb");
+		char *text = malloc(source.st_size + 1);
+
+		if(fp == NULL || text == NULL || fread(text, 1, source.st_size, fp) != (size_t)source.st_size) {
+			printf("Cannot bake %s.\n", path);
+
+			if(fp != NULL) {
+				fclose(fp);
+			}
+
+			free(text);
+			return 1;
+		}
+
+		fclose(fp);
+
+		entry->offset = he_pack_put(writer, text, source.st_size);
+		entry->size = source.st_size;
+		free(text);
+	}
+
+	return entry->offset == 0;
+}
+
+u64
+he_pack_put_model(hed_pack_writer *writer, const char *path) {
+
+	Model model = LoadModel(path);
+
+	if(model.meshCount == 0 || model.meshes == NULL) {
+		printf("Cannot bake %s.\n", path);
+		return 0;
+	}
+
+	int anim_count = 0;
+	ModelAnimation *anims = LoadModelAnimations(path, &anim_count);
+
+	hed_pack_model packed = {
+		.transform = model.transform,
+		.mesh_count = model.meshCount,
+		.material_count = model.materialCount,
+		.bone_count = model.boneCount,
+		.anim_count = anim_count,
+	};
+
+	// same bounds the loader would compute
+	const char *ext = strrchr(path, '.');
+
+	if(ext != NULL && strcmp(ext, ".glb") == 0) {
+		packed.box = he_engine_glb_bbox(path);
+	}
+
+	else {
+		packed.box = GetMeshBoundingBox(model.meshes[0]);
+
+		for(int i = 1; i < model.meshCount; i++) {
+			packed.box = he_engine_combine_bbox(packed.box, GetMeshBoundingBox(model.meshes[i]));
+		}
+	}
+
+	hed_pack_mesh *meshes = calloc(model.meshCount, sizeof(hed_pack_mesh));
+	hed_pack_material *materials = calloc(model.materialCount, sizeof(hed_pack_material));
+	hed_pack_anim *packed_anims = calloc(anim_count + 1, sizeof(hed_pack_anim));
+
+	if(meshes == NULL || materials == NULL || packed_anims == NULL) {
+		writer->failed = true;
+	}
+
+	for(int i = 0; i < model.meshCount && !writer->failed; i++) {
+		Mesh *mesh = &model.meshes[i];
+		u64 v = mesh->vertexCount;
+
+		meshes[i].vertex_count = mesh->vertexCount;
+		meshes[i].triangle_count = mesh->triangleCount;
+		meshes[i].vertices = he_pack_put(writer, mesh->vertices, v * 3 * sizeof(float));
+		meshes[i].texcoords = he_pack_put(writer, mesh->texcoords, v * 2 * sizeof(float));
+		meshes[i].texcoords2 = he_pack_put(writer, mesh->texcoords2, v * 2 * sizeof(float));
+		meshes[i].normals = he_pack_put(writer, mesh->normals, v * 3 * sizeof(float));
+		meshes[i].tangents = he_pack_put(writer, mesh->tangents, v * 4 * sizeof(float));
+		meshes[i].colors = he_pack_put(writer, mesh->colors, v * 4);
+		meshes[i].indices = he_pack_put(writer, mesh->indices, (u64)mesh->triangleCount * 3 * sizeof(unsigned short));
+		meshes[i].anim_vertices = he_pack_put(writer, mesh->animVertices, v * 3 * sizeof(float));
+		meshes[i].anim_normals = he_pack_put(writer, mesh->animNormals, v * 3 * sizeof(float));
+		meshes[i].bone_ids = he_pack_put(writer, mesh->boneIds, v * 4);
+		meshes[i].bone_weights = he_pack_put(writer, mesh->boneWeights, v * 4 * sizeof(float));
+	}
+
+	for(int i = 0; i < model.materialCount && !writer->failed; i++) {
+		MaterialMap *map = &model.materials[i].maps[MATERIAL_MAP_DIFFUSE];
+		materials[i].color = map->color;
+
+		// textures are read back from the GPU, baking needs the window for this
+		if(map->texture.id != 0 && map->texture.id != rlGetTextureIdDefault()) {
+			Image image = LoadImageFromTexture(map->texture);
+
+			materials[i].width = image.width;
+			materials[i].height = image.height;
+			materials[i].format = image.format;
+			materials[i].pixels = he_pack_put(writer, image.data,
+				GetPixelDataSize(image.width, image.height, image.format));
+
+			UnloadImage(image);
+		}
+	}
+
+	for(int a = 0; a < anim_count && !writer->failed; a++) {
+		ModelAnimation *anim = &anims[a];
+		u64 frame = (u64)anim->boneCount * sizeof(Transform);
+
+		(void)memcpy(packed_anims[a].name, anim->name, sizeof(packed_anims[a].name));
+		packed_anims[a].bone_count = anim->boneCount;
+		packed_anims[a].frame_count = anim->frameCount;
+		packed_anims[a].bones = he_pack_put(writer, anim->bones, anim->boneCount * sizeof(BoneInfo));
+
+		// frames back to back, one section per animation
+		u8 *poses = malloc(frame * anim->frameCount + 1);
+		if(poses == NULL) {
+			writer->failed = true;
+			break;
+		}
+
+		for(int i = 0; i < anim->frameCount; i++) {
+			(void)memcpy(poses + i * frame, anim->framePoses[i], frame);
+		}
+
+		packed_anims[a].poses = he_pack_put(writer, poses, frame * anim->frameCount);
+		free(poses);
+	}
+
+	packed.meshes = he_pack_put(writer, meshes, model.meshCount * sizeof(hed_pack_mesh));
+	packed.materials = he_pack_put(writer, materials, model.materialCount * sizeof(hed_pack_material));
+	packed.mesh_material = he_pack_put(writer, model.meshMaterial, model.meshCount * sizeof(int));
+	packed.bones = he_pack_put(writer, model.bones, model.boneCount * sizeof(BoneInfo));
+	packed.bind_pose = he_pack_put(writer, model.bindPose, model.boneCount * sizeof(Transform));
+	packed.anims = anim_count ? he_pack_put(writer, packed_anims, anim_count * sizeof(hed_pack_anim)) : 0;
+
+	free(meshes);
+	free(materials);
+	free(packed_anims);
+
+	UnloadModelAnimations(anims, anim_count);
+	UnloadModel(model);
+
+	return writer->failed ? 0 : he_pack_put(writer, &packed, sizeof(packed));
+}
+
+void
+he_pack_decode_model(hed_asset *asset) {
+
+	// animation frames are used in place, only the pointer tables are built
+	const hed_pack_model *packed = he_pack_at(asset->packed->offset);
+	const hed_pack_anim *anims = he_pack_at(packed->anims);
+
+	asset->box = packed->box;
+	asset->boxed = true;
+
+	asset->animations = packed->anim_count ? calloc(packed->anim_count, sizeof(ModelAnimation)) : NULL;
+	asset->animCount = asset->animations ? (int)packed->anim_count : 0;
+
+	for(int a = 0; a < asset->animCount; a++) {
+		ModelAnimation *anim = &asset->animations[a];
+		Transform *poses = he_pack_at(anims[a].poses);
+
+		(void)memcpy(anim->name, anims[a].name, sizeof(anim->name));
+		anim->boneCount = anims[a].bone_count;
+		anim->bones = he_pack_at(anims[a].bones);
+		anim->framePoses = malloc(anims[a].frame_count * sizeof(Transform *) + 1);
+
+		if(anim->framePoses == NULL) {
+			continue;
+		}
+
+		anim->frameCount = anims[a].frame_count;
+
+		for(int i = 0; i < anim->frameCount; i++) {
+			anim->framePoses[i] = poses + (u64)i * anim->boneCount;
+		}
+	}
+
+	// meshes point at the mapped pages, headless queries them and upload sends them to the GPU
+	const hed_pack_mesh *meshes = he_pack_at(packed->meshes);
+	Model *model = &asset->model;
+
+	model->transform = packed->transform;
+	model->meshes = calloc(packed->mesh_count, sizeof(Mesh));
+	model->meshMaterial = calloc(packed->mesh_count, sizeof(int));
+
+	if(model->meshes == NULL || model->meshMaterial == NULL) {
+		printf("Out of memory decoding %s.\n", asset->path);
+		free(model->meshes);
+		free(model->meshMaterial);
+		(void)memset(model, 0, sizeof(*model));
+		return;
+	}
+
+	model->meshCount = packed->mesh_count;
+	(void)memcpy(model->meshMaterial, engine.pack.data + packed->mesh_material, packed->mesh_count * sizeof(int));
+
+	model->boneCount = packed->bone_count;
+	model->bones = he_pack_at(packed->bones);
+	model->bindPose = he_pack_at(packed->bind_pose);
+
+	for(int i = 0; i < model->meshCount; i++) {
+		Mesh *mesh = &model->meshes[i];
+
+		mesh->vertexCount = meshes[i].vertex_count;
+		mesh->triangleCount = meshes[i].triangle_count;
+		mesh->vertices = he_pack_at(meshes[i].vertices);
+		mesh->texcoords = he_pack_at(meshes[i].texcoords);
+		mesh->texcoords2 = he_pack_at(meshes[i].texcoords2);
+		mesh->normals = he_pack_at(meshes[i].normals);
+		mesh->tangents = he_pack_at(meshes[i].tangents);
+		mesh->colors = he_pack_at(meshes[i].colors);
+		mesh->indices = he_pack_at(meshes[i].indices);
+		mesh->animVertices = he_pack_at(meshes[i].anim_vertices);
+		mesh->animNormals = he_pack_at(meshes[i].anim_normals);
+		mesh->boneIds = he_pack_at(meshes[i].bone_ids);
+		mesh->boneWeights = he_pack_at(meshes[i].bone_weights);
+	}
+}
+
+void
+he_pack_upload_model(hed_asset *asset) {
+
+	// vertex arrays are the mapped pages decode pointed the meshes at, the GPU copy is the only copy made
+	const hed_pack_model *packed = he_pack_at(asset->packed->offset);
+	const hed_pack_material *materials = he_pack_at(packed->materials);
+	Model *model = &asset->model;
+
+	model->materials = calloc(packed->material_count, sizeof(Material));
+
+	if(model->meshes == NULL || model->materials == NULL) {
+		printf("Out of memory uploading %s.\n", asset->path);
+		free(model->meshes);
+		free(model->materials);
+		free(model->meshMaterial);
+		(void)memset(model, 0, sizeof(*model));
+		return;
+	}
+
+	model->materialCount = packed->material_count;
+
+	for(int i = 0; i < model->meshCount; i++) {
+		UploadMesh(&model->meshes[i], false);
+	}
+
+	for(int i = 0; i < model->materialCount; i++) {
+		model->materials[i] = LoadMaterialDefault();
+		model->materials[i].maps[MATERIAL_MAP_DIFFUSE].color = materials[i].color;
+
+		if(materials[i].pixels != 0) {
+			Image image = {
+				.data = he_pack_at(materials[i].pixels),
+				.width = materials[i].width,
+				.height = materials[i].height,
+				.mipmaps = 1,
+				.format = materials[i].format
+			};
+
+			model->materials[i].maps[MATERIAL_MAP_DIFFUSE].texture = LoadTextureFromImage(image);
+		}
+	}
+}
+
+void
+he_pack_unload_model(hed_asset *asset) {
+
+	Model *model = &asset->model;
+
+	// raylib frees only what it allocated, arrays in the pack are unmapped with it
+	if(asset->uploaded) {
+		for(int i = 0; i < model->meshCount; i++) {
+			Mesh *mesh = &model->meshes[i];
+
+			mesh->vertices = mesh->texcoords = mesh->texcoords2 = NULL;
+			mesh->normals = mesh->tangents = NULL;
+			mesh->animVertices = mesh->animNormals = mesh->boneWeights = NULL;
+			mesh->colors = mesh->boneIds = NULL;
+			mesh->indices = NULL;
+		}
+
+		model->bones = NULL;
+		model->bindPose = NULL;
+
+		UnloadModel(*model);
+	}
+
+	// headless only has the mesh table
+	else {
+		free(model->meshes);
+		free(model->meshMaterial);
+	}
+
+	for(int a = 0; a < asset->animCount; a++) {
+		free(asset->animations[a].framePoses);
+	}
+
+	free(asset->animations);
+}
+
+bool
+he_engine_raycast(Ray ray, float max_distance, RayCollision *hit) {
+
+	// world space wrappers, the map BVH is built around the map origin
+	hed_level *level = engine.current_level;
+	ray.position = Vector3Subtract(ray.position, level->components.position[MAP]);
+
+	if(!he_bvh_raycast(&level->map_bvh, ray, max_distance, hit)) {
+		return false;
+	}
+
+	hit->point = Vector3Add(hit->point, level->components.position[MAP]);
+	return true;
+}
+
+bool
+he_engine_overlap_box(BoundingBox box) {
+	hed_level *level = engine.current_level;
+
+	box.min = Vector3Subtract(box.min, level->components.position[MAP]);
+	box.max = Vector3Subtract(box.max, level->components.position[MAP]);
+
+	return he_bvh_overlap_box(&level->map_bvh, box);
+}
+
+bool
+he_engine_overlap_sphere(Vector3 center, float radius) {
+	hed_level *level = engine.current_level;
+
+	return he_bvh_overlap_sphere(&level->map_bvh,
+		Vector3Subtract(center, level->components.position[MAP]), radius);
+}
+
+bool
+he_engine_ground_height(Vector3 from, float reach, float *height) {
+
+	// first surface straight below from, at most reach away
+	RayCollision hit = { 0 };
+	Ray ray = { from, { 0.0f, -1.0f, 0.0f } };
+
+	if(!he_engine_raycast(ray, reach, &hit)) {
+		return false;
+	}
+
+	*height = hit.point.y;
+	return true;
+}
+
+bool
+he_engine_hero_blocked(Vector3 position) {
+
+	// hero box without its feet, floors and small steps don't block
+	BoundingBox hero = engine.current_level->components.box[HERO];
+	BoundingBox box = { Vector3Add(hero.min, position), Vector3Add(hero.max, position) };
+	box.min.y += HERO_STEP_HEIGHT;
+
+	if(box.min.y >= box.max.y) {
+		return false;
+	}
+
+	return he_engine_overlap_box(box);
+}
+
+void
+he_engine_move_hero(Vector3 delta) {
+
+	Vector3 position = engine.current_level->components.position[HERO];
+	BoundingBox hero = engine.current_level->components.box[HERO];
+	Vector3 target = Vector3Add(position, delta);
+
+	// no map geometry, move freely like before
+	if(engine.current_level->map_bvh.node_count == 0) {
+		he_engine_place_model(engine.current_level, HERO, target);
+		return;
+	}
+
+	// blocked, slide along whichever axis is free
+	if((delta.x != 0.0f || delta.z != 0.0f) && he_engine_hero_blocked(target)) {
+		Vector3 x_only = { position.x + delta.x, position.y, position.z };
+		Vector3 z_only = { position.x, position.y, position.z + delta.z };
+
+		if(delta.x != 0.0f && !he_engine_hero_blocked(x_only)) {
+			target = x_only;
+		}
+
+		else if(delta.z != 0.0f && !he_engine_hero_blocked(z_only)) {
+			target = z_only;
+		}
+
+		else {
+			target = position;
+		}
+	}
+
+	// stand on whatever is under the feet, step up small ledges
+	float ground;
+	Vector3 feet = { target.x, target.y + hero.min.y + HERO_STEP_HEIGHT, target.z };
+
+	if(he_engine_ground_height(feet, HERO_STEP_HEIGHT + HERO_MAX_DROP, &ground)) {
+		target.y = ground - hero.min.y;
+	}
+
+	he_engine_place_model(engine.current_level, HERO, target);
+}
+
+void
+he_engine_update_bounds(void) {
+
+	he_jobs_for(he_engine_bounds_range, NULL, engine.current_level->components.count, JOB_GRAIN);
+}
+
+void
+he_engine_bounds_range(void *arg, u32 first, u32 count) {
+
+	// only models placed since the last tick, a still one costs a flag test
+	hed_level *level = engine.current_level;
+	hed_components *components = &level->components;
+	hed_boxes *boxes = &level->boxes;
+	const u8 moved = MODEL_RENDER | MODEL_DIRTY;
+
+	(void)arg;
+
+	for(u32 id = first; id < first + count; id++) {
+
+		// hidden models keep their last box and stay dirty until shown
+		if((components->flags[id] & moved) != moved) {
+			continue;
+		}
+
+		components->flags[id] &= ~MODEL_DIRTY;
+
+		Vector3 position = components->position[id];
+		BoundingBox *world = &components->world[id];
+
+		world->min = Vector3Add(components->box[id].min, position);
+		world->max = Vector3Add(components->box[id].max, position);
+
+		boxes->min_x[id] = world->min.x;
+		boxes->min_y[id] = world->min.y;
+		boxes->min_z[id] = world->min.z;
+		boxes->max_x[id] = world->max.x;
+		boxes->max_y[id] = world->max.y;
+		boxes->max_z[id] = world->max.z;
+
+		// moved entity invalidates the broad phase and its batch transforms,
+		// other ranges may set the same flags at once
+		if(id >= ENTITY) {
+			hed_model *entity = &level->entities[id - ENTITY];
+			__atomic_store_n(&level->grid.dirty, true, __ATOMIC_RELAXED);
+
+			if(entity->batch != NO_BATCH) {
+				__atomic_store_n(&level->batches.items[entity->batch].moving, true, __ATOMIC_RELAXED);
+				__atomic_store_n(&level->batches.items[entity->batch].dirty, true, __ATOMIC_RELAXED);
+			}
+		}
+	}
+}
+
+u8
+he_engine_load_game(const char *file) {
+
+	// levels are saved by index id, folders can be renamed or reordered
+	hed_lexer lex;
+
+	if(access(file, F_OK) != 0 || he_lex_open(&lex, file)) {
+		printf("Cannot open save file '%s'.\n", file);
+		return 1;
+	}
+
+	hed_token tok, arg;
+	u8 failed = 0;
+	char level[U8] = "";
+
+	while(!failed && he_lex_next(&lex, &tok)) {
+		int id = 0;
+
+		if(!he_lex_is(&tok, "LEVEL")) {
+			he_lex_error(&lex, &tok, "syntax error while reading save file");
+			failed = 1;
+		}
+
+		else if(he_lex_expect(&lex, &arg, "a level id") || he_lex_int(&lex, &arg, &id)) {
+			failed = 1;
+		}
+
+		else if(he_index_find_id(id) == NULL) {
+			he_lex_error(&lex, &arg, "saved level %d doesn't exist anymore", id);
+			failed = 1;
+		}
+
+		else {
+			(void)snprintf(level, sizeof(level),
+			"%s%s%s", engine.config.level, SEP, he_index_find_id(id)->name);
+		}
+	}
+
+	he_lex_close(&lex);
+
+	// a bad save leaves NEW_GAME_START in place
+	if(!failed && level[0] != 0) {
+		(void)snprintf(engine.starting_level, sizeof(engine.starting_level),
+		"%s", level);
+	}
+
+	return failed;
+}
+
+u8
+he_engine_save_game(const char *file) {
+
+	const hed_index_level *level = engine.current_level ? he_index_find(engine.current_level->name) : NULL;
+
+	if(level == NULL) {
+		printf("Nothing to save, no level is running.\n");
+		return 1;
+	}
+
+	FILE *fp = fopen(file, "w");
+	if(fp == NULL) {
+		printf("Cannot write save file '%s'.\n", file);
+		return 1;
+	}
+
+	fprintf(fp, "LEVEL %u\n", level->id);
+	fclose(fp);
+
+	return 0;
+}
+
+void
+he_processor(const hed_event *event) {
+
+	hed_level *level = engine.current_level;
+	hed_components *components = &level->components;
+	const hed_program *program = &level->program;
+	const u32 *pc = &program->code[level->col_code[event->rule]];
+
+	// operands were checked when compiled, nothing here looks at names
+	while(1) {
+		hed_model *model;
+		u32 op = *pc++;
+
+		switch(op) {
+			case PRINT:
+				printf("%s\n", &program->strings[*pc++]);
+			break;
+
+			// level ends after this tick, next one is run in its place
+			case LOAD_LEVEL:
+				(void)snprintf(engine.next_level, sizeof(engine.next_level),
+				"%s", &program->strings[*pc++]);
+			break;
+
+			// teleport, no interpolation from the old spot
+			case SET_POSITION:
+				model = he_processor_model(*pc++, event);
+				he_engine_place_model(level, model->id, (Vector3) {
+					program->numbers[pc[0]], program->numbers[pc[1]], program->numbers[pc[2]]
+				});
+				components->prev_position[model->id] = components->position[model->id];
+				pc += 3;
+			break;
+
+			// hidden models are not drawn and don't collide
+			case HIDE:
+			case SHOW:
+				model = he_processor_model(*pc++, event);
+
+				// a model that never loaded stays hidden
+				if(op == SHOW && model->asset != NULL) {
+					components->flags[model->id] |= MODEL_RENDER;
+				}
+
+				else {
+					components->flags[model->id] &= ~MODEL_RENDER;
+				}
+
+				level->grid.dirty = true;
+
+				if(model->batch != NO_BATCH) {
+					level->batches.items[model->batch].dirty = true;
+				}
+			break;
+
+			case PLAY_ANIMATION:
+				model = he_processor_model(*pc++, event);
+
+				// OTHER may be a model without that many animations
+				if(model->asset != NULL && *pc < (u32)model->asset->animCount) {
+					components->clip[model->id] = *pc;
+					components->frame_count[model->id] = model->asset->animations[*pc].frameCount;
+					components->frame[model->id] = 0;
+					components->clip_time[model->id] = 0.0f;
+				}
+
+				pc++;
+			break;
+
+			default:
+				return;
+		}
+	}
+}
+
+hed_model *
+he_processor_model(u32 operand, const hed_event *event) {
+
+	if(operand == MODEL_SELF) {
+		return he_engine_model(engine.current_level, event->a);
+	}
+
+	if(operand == MODEL_OTHER) {
+		return he_engine_model(engine.current_level, event->b);
+	}
+
+	return he_engine_model(engine.current_level, operand);
+}
+
+u8
+he_processor_compile(hed_level *level, hed_lexer *lex, const hed_token *verb) {
+
+	// one action with its arguments into the level program
+	hed_program *program = &level->program;
+	hed_token arg;
+	char tmp[U8], path[U8];
+	u32 model;
+	int animation, count = 0, len;
+
+	int op = he_engine_exists_keyword(verb);
+
+	if(op < 0) {
+		he_lex_error(lex, verb, "keyword %.*s doesn't exist", (int)verb->len, verb->str);
+		return 1;
+	}
+
+	switch(op) {
+		case PRINT:
+			he_lex_rest(lex, &arg);
+			he_processor_emit(level, PRINT);
+			he_processor_emit(level, he_processor_string(level, arg.str, arg.len));
+		break;
+
+		// path is built here, running it only copies
+		case LOAD_LEVEL:
+			if(he_lex_expect(lex, &arg, "a level name") || he_lex_copy(lex, &arg, tmp, sizeof(tmp))) {
+				return 1;
+			}
+
+			len = snprintf(path, sizeof(path),
+			"%s%s%s", engine.config.level, SEP, tmp);
+
+			if(len >= (int)sizeof(path)) {
+				he_lex_error(lex, &arg, "level path of %s is too long", tmp);
+				return 1;
+			}
+
+			if(he_index_find(tmp) == NULL) {
+				he_lex_error(lex, &arg, "level %s doesn't exist", tmp);
+				return 1;
+			}
+
+			he_processor_emit(level, LOAD_LEVEL);
+			he_processor_emit(level, he_processor_string(level, path, len));
+		break;
+
+		case SET_POSITION:
+			if(he_processor_operand(level, lex, &model)) {
+				return 1;
+			}
+
+			he_processor_emit(level, SET_POSITION);
+			he_processor_emit(level, model);
+
+			for(u8 i = 0; i < 3; i++) {
+				float v;
+				if(he_lex_expect(lex, &arg, "x y z") || he_lex_float(lex, &arg, &v)) {
+					return 1;
+				}
+
+				he_processor_emit(level, he_processor_number(level, v));
+			}
+		break;
+
+		case HIDE:
+		case SHOW:
+			if(he_processor_operand(level, lex, &model)) {
+				return 1;
+			}
+
+			he_processor_emit(level, op);
+			he_processor_emit(level, model);
+		break;
+
+		case PLAY_ANIMATION:
+			if(he_processor_operand(level, lex, &model) ||
+			he_lex_expect(lex, &arg, "an animation number") || he_lex_int(lex, &arg, &animation)) {
+				return 1;
+			}
+
+			// named models are checked now, SELF and OTHER when they play
+			if(model < MODEL_SELF && he_engine_model(level, model)->asset != NULL) {
+				count = he_engine_model(level, model)->asset->animCount;
 			}
 
-			else {
-				printf("Level %s doesn't exist.\n", tmp);
+			if(animation < 0 || (model < MODEL_SELF && animation >= count)) {
+				he_lex_error(lex, &arg, "animation %d out of range, model has %d", animation, count);
 				return 1;
 			}
 
-			continue;
+			he_processor_emit(level, PLAY_ANIMATION);
+			he_processor_emit(level, model);
+			he_processor_emit(level, animation);
+		break;
+	}
+
+	if(program->oom) {
+		printf("Out of memory compiling collision responses.\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+u8
+he_processor_operand(hed_level *level, hed_lexer *lex, u32 *model) {
+
+	// model name, SELF for the first model of the rule or OTHER for the one it touched
+	hed_token tok;
+
+	if(he_lex_expect(lex, &tok, "a model name")) {
+		return 1;
+	}
+
+	if(he_lex_is(&tok, "SELF")) {
+		*model = MODEL_SELF;
+		return 0;
+	}
+
+	if(he_lex_is(&tok, "OTHER")) {
+		*model = MODEL_OTHER;
+		return 0;
+	}
+
+	int id = he_engine_check_model(level, tok.str, tok.len);
+
+	if(id < 0) {
+		he_lex_error(lex, &tok, "model named %.*s doesn't exist", (int)tok.len, tok.str);
+		return 1;
+	}
+
+	*model = id;
+	return 0;
+}
+
+void
+he_processor_emit(hed_level *level, u32 word) {
+
+	hed_program *program = &level->program;
+
+	if(program->count == program->capacity) {
+		u32 capacity = program->capacity ? program->capacity * 2 : 256;
+		u32 *code = he_arena_alloc(&level->arena, capacity * sizeof(u32));
+
+		if(code == NULL) {
+			program->oom = true;
+			return;
 		}
 
-		else {
-			printf("Syntax error in cfg.root, instruction '%s' not recognized.\n", tmp);
-			return 1;
+		// old words stay behind in the arena until the level ends
+		if(program->count > 0) {
+			(void)memcpy(code, program->code, program->count * sizeof(u32));
 		}
+
+		program->code = code;
+		program->capacity = capacity;
 	}
-	
-	fclose(fp);
+
+	program->code[program->count++] = word;
+}
+
+u32
+he_processor_string(hed_level *level, const char *str, u32 len) {
+
+	hed_program *program = &level->program;
+
+	if(program->strings_size + len + 1 > program->strings_capacity) {
+		u32 capacity = program->strings_capacity ? program->strings_capacity : 1024;
+
+		while(program->strings_size + len + 1 > capacity) {
+			capacity *= 2;
+		}
+
+		char *strings = he_arena_alloc(&level->arena, capacity);
+
+		if(strings == NULL) {
+			program->oom = true;
+			return 0;
+		}
+
+		if(program->strings_size > 0) {
+			(void)memcpy(strings, program->strings, program->strings_size);
+		}
+
+		program->strings = strings;
+		program->strings_capacity = capacity;
+	}
+
+	u32 offset = program->strings_size;
+	(void)memcpy(&program->strings[offset], str, len);
+	program->strings[offset + len] = 0;
+	program->strings_size += len + 1;
+
+	return offset;
+}
+
+u32
+he_processor_number(hed_level *level, float value) {
+
+	hed_program *program = &level->program;
+
+	if(program->number_count == program->number_capacity) {
+		u32 capacity = program->number_capacity ? program->number_capacity * 2 : 64;
+		float *numbers = he_arena_alloc(&level->arena, capacity * sizeof(float));
+
+		if(numbers == NULL) {
+			program->oom = true;
+			return 0;
+		}
+
+		if(program->number_count > 0) {
+			(void)memcpy(numbers, program->numbers, program->number_count * sizeof(float));
+		}
+
+		program->numbers = numbers;
+		program->number_capacity = capacity;
+	}
+
+	program->numbers[program->number_count] = value;
+	return program->number_count++;
+}
+
+void
+he_engine_die(void) {
+	return;
+}
+
+void
+he_engine_cleanup_level(void) {
+
+	he_engine_free_level(engine.current_level);
+	engine.current_level = NULL;
+}
+
+void
+he_engine_free_level(hed_level *level) {
+
+	hed_grid *grid = &level->grid;
+	free(grid->bucket_start);
+	free(grid->bucket_fill);
+	free(grid->items);
+	free(grid->large);
+	free(grid->stamp);
+	free(grid->candidates);
+	(void)memset(grid, 0, sizeof(*grid));
+
+	hed_pairs *pairs = &level->pairs;
+	free(pairs->a);
+	free(pairs->b);
+	free(pairs->rule);
+	free(pairs->hits);
+	(void)memset(pairs, 0, sizeof(*pairs));
+
+	free(level->boxes.min_x);
+	(void)memset(&level->boxes, 0, sizeof(hed_boxes));
+
+	he_bvh_free(&level->map_bvh);
+
+	free(level->batches.items);
+	free(level->batches.members);
+	free(level->batches.transforms);
+
+	hed_events *events = &level->events;
+	free(events->queue);
+	free(events->contacts);
+	free(events->current);
+	(void)memset(events, 0, sizeof(*events));
+
+	// assets stay resident until the next level says it doesn't need them
+	he_engine_release_asset(level->hero.asset);
+	he_engine_release_asset(level->map.asset);
+
+	for(int i = 0; i < level->entities_count; i++) {
+		he_engine_release_asset(level->entities[i].asset);
+	}
+
+	// entities, names, rules and responses all go with the arena
+	he_arena_free(&level->arena);
+
+	// next level starts from an empty one
+	(void)memset(level, 0, sizeof(hed_level));
+}
+
+u8
+he_arena_init(hed_arena *arena, size_t size) {
+
+	(void)memset(arena, 0, sizeof(*arena));
+
+	size = he_arena_round(size);
+	hed_arena_block *block = malloc(he_arena_round(sizeof(hed_arena_block)) + size);
+
+	if(block == NULL) {
+		printf("Out of memory for level arena.\n");
+		return 1;
+	}
+
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+
+	arena->head = block;
+	arena->blocks = 1;
+	arena->reserved = size;
+
 	return 0;
 }
 
+void *
+he_arena_alloc(hed_arena *arena, size_t size) {
+
+	size = he_arena_round(size);
+	hed_arena_block *block = arena->head;
+
+	// whatever is left in a full block is given up, blocks never shrink
+	if(block == NULL || block->used + size > block->size) {
+		size_t grow = block != NULL && block->size > size ? block->size : size;
+
+		if(grow == 0) {
+			grow = 4096;
+		}
+
+		block = malloc(he_arena_round(sizeof(hed_arena_block)) + grow);
+
+		if(block == NULL) {
+			return NULL;
+		}
+
+		block->next = arena->head;
+		block->size = grow;
+		block->used = 0;
+
+		arena->head = block;
+		arena->blocks++;
+		arena->reserved += grow;
+	}
+
+	u8 *data = (u8 *)block + he_arena_round(sizeof(hed_arena_block)) + block->used;
+	block->used += size;
+	arena->used += size;
+
+	(void)memset(data, 0, size);
+	return data;
+}
+
+const char *
+he_arena_strdup(hed_arena *arena, const char *str, size_t len) {
+
+	char *copy = he_arena_alloc(arena, len + 1);
+
+	if(copy != NULL) {
+		(void)memcpy(copy, str, len);
+		copy[len] = 0;
+	}
+
+	return copy;
+}
+
+void
+he_arena_free(hed_arena *arena) {
+
+	hed_arena_block *block = arena->head;
+
+	while(block != NULL) {
+		hed_arena_block *next = block->next;
+		free(block);
+		block = next;
+	}
+
+	(void)memset(arena, 0, sizeof(*arena));
+}
+
 u8
-he_engine_parse_level(const char *path) {
+he_jobs_init(u32 threads) {
 
-	char resources[U8], logic[U8];
+	hed_jobs *jobs = &engine.jobs;
 
-	(void)snprintf(resources, sizeof(resources),
-	"%s%s%s", path, SEP, CFG_RESOURCES);
+	if(threads == 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cores < 1 ? 1 : (u32)cores;
+	}
 
-	(void)snprintf(logic, sizeof(logic),
-	"%s%s%s", path, SEP, CFG_printfIC);
+	if(threads > JOB_THREADS) {
+		threads = JOB_THREADS;
+	}
 
-	FILE *fp = NULL;
-	char tmp[U6];
-	#define ff fscanf(fp, "%60s", tmp)
+	(void)memset(jobs, 0, sizeof(*jobs));
 
-	static hed_level level;
+	jobs->workers = calloc(threads, sizeof(hed_worker));
+	if(jobs->workers == NULL) {
+		printf("Out of memory for %u job threads.\n", threads);
+		return 1;
+	}
 
-	(void)snprintf(level.name, sizeof(level.name),
-	"%s", path);
+	(void)pthread_mutex_init(&jobs->graph, NULL);
+	(void)pthread_mutex_init(&jobs->sleep_lock, NULL);
+	(void)pthread_cond_init(&jobs->wake, NULL);
 
-	engine.current_level = &level;
+	for(u32 i = 0; i < threads; i++) {
+		jobs->workers[i].index = i;
+		(void)pthread_mutex_init(&jobs->workers[i].lock, NULL);
+	}
 
-	// parsing resources
-	if(access(resources, F_OK) == 0 && access(logic, F_OK) == 0) {
-		if( (fp = fopen(resources, "r")) == NULL ) {
-			printf("Failed to open resources config for the level.\n");
-			return 1;
+	// main thread is worker 0, fewer threads than asked is still a working pool,
+	// started ones already steal while the rest come up
+	jobs->count = 1;
+
+	while(jobs->count < threads &&
+	pthread_create(&jobs->workers[jobs->count].thread, NULL, he_jobs_thread, &jobs->workers[jobs->count]) == 0) {
+		__atomic_add_fetch(&jobs->count, 1, __ATOMIC_RELEASE);
+	}
+
+	return 0;
+}
+
+void
+he_jobs_shutdown(void) {
+
+	hed_jobs *jobs = &engine.jobs;
+
+	if(jobs->workers == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&jobs->sleep_lock);
+	__atomic_store_n(&jobs->quit, true, __ATOMIC_SEQ_CST);
+	pthread_cond_broadcast(&jobs->wake);
+	pthread_mutex_unlock(&jobs->sleep_lock);
+
+	for(u32 i = 1; i < jobs->count; i++) {
+		(void)pthread_join(jobs->workers[i].thread, NULL);
+	}
+
+	for(u32 i = 0; i < jobs->count; i++) {
+		(void)pthread_mutex_destroy(&jobs->workers[i].lock);
+	}
+
+	(void)pthread_mutex_destroy(&jobs->graph);
+	(void)pthread_mutex_destroy(&jobs->sleep_lock);
+	(void)pthread_cond_destroy(&jobs->wake);
+
+	free(jobs->workers);
+	(void)memset(jobs, 0, sizeof(*jobs));
+}
+
+hed_job *
+he_jobs_create(hed_job_fn run, void *data, u32 count, u32 grain) {
+
+	// main thread only, the job waits for he_jobs_submit and its dependencies
+	hed_worker *worker = &engine.jobs.workers[0];
+	hed_job *job = &worker->ring[worker->next++ & (JOB_QUEUE - 1)];
+
+	// halving stops at more than half the grain, so this keeps it under JOB_RANGES
+	u32 least = (u32)(((u64)count * 2 + JOB_RANGES - 1) / JOB_RANGES);
+
+	*job = (hed_job) {
+		.run = run,
+		.data = data,
+		.count = count,
+		.grain = grain > least ? grain : least > 0 ? least : 1,
+		.unfinished = 1,
+		.waiting = 1,
+	};
+
+	return job;
+}
+
+void
+he_jobs_depend(hed_job *job, hed_job *before) {
+
+	hed_jobs *jobs = &engine.jobs;
+	bool full = false;
+
+	pthread_mutex_lock(&jobs->graph);
+
+	if(!before->done) {
+		full = before->dependent_count == JOB_DEPENDENTS;
+
+		if(!full) {
+			before->dependents[before->dependent_count++] = job;
+			__atomic_add_fetch(&job->waiting, 1, __ATOMIC_SEQ_CST);
+		}
+	}
+
+	pthread_mutex_unlock(&jobs->graph);
+
+	// no room to be told, wait it out before the job is submitted
+	if(full) {
+		he_jobs_wait(before);
+	}
+}
+
+void
+he_jobs_submit(hed_job *job) {
+
+	hed_worker *worker = &engine.jobs.workers[0];
+
+	if(__atomic_sub_fetch(&job->waiting, 1, __ATOMIC_SEQ_CST) == 0 && he_jobs_push(worker, job)) {
+		he_jobs_execute(worker, job);
+	}
+}
+
+void
+he_jobs_wait(hed_job *job) {
+
+	// main thread works through whatever is queued instead of blocking
+	hed_worker *worker = &engine.jobs.workers[0];
+
+	while(!__atomic_load_n(&job->done, __ATOMIC_SEQ_CST)) {
+		hed_job *next = he_jobs_find(worker);
+
+		if(next != NULL) {
+			he_jobs_execute(worker, next);
 		}
 
 		else {
-			while(ff == 1) {
-				if(strcmp(tmp, "HERO") == 0) {
-					ff;
-					char p[U8];
-					(void)snprintf(p, sizeof(p),
-					"%s%s%s", engine.config.resources, SEP, tmp);
-					
-					if(access(p, F_OK) == 0) {
-						// load hero
-						level.hero = he_engine_load_model(p);
-						
-						(void)snprintf(level.hero.name, sizeof(level.hero.name),
-						"%s", tmp);
-
-						level.hero.type = HERO;
-					}
+			(void)sched_yield();
+		}
+	}
+}
 
-					else {
-						printf("Hero model %s cannot be loaded.\n", tmp);
-						return 1;
-					}
+void
+he_jobs_for(hed_job_fn run, void *data, u32 count, u32 grain) {
 
-					continue;
-				}
+	// one thread or one slice, no reason to go through the queues
+	if(engine.jobs.count < 2 || count <= grain) {
+		run(data, 0, count);
+		return;
+	}
 
-				else if(strcmp(tmp, "MAP") == 0) {
-					ff;
+	hed_job *job = he_jobs_create(run, data, count, grain);
+	he_jobs_submit(job);
+	he_jobs_wait(job);
+}
 
-					char p[U8];
-					(void)snprintf(p, sizeof(p),
-					"%s%s%s", engine.config.resources, SEP, tmp);
-					
-					if(access(p, F_OK) == 0) {
-						// load map
-						level.map = he_engine_load_model(p);
+u8
+he_jobs_push(hed_worker *worker, hed_job *job) {
 
-						(void)snprintf(level.map.name, sizeof(level.map.name),
-						"%s", tmp);
+	hed_jobs *jobs = &engine.jobs;
 
-						level.map.type = MAP;
-					}
+	pthread_mutex_lock(&worker->lock);
 
-					else {
-						printf("Map model %s cannot be loaded.\n", tmp);
-						return 1;
-					}
+	if(worker->bottom - worker->top == JOB_QUEUE) {
+		pthread_mutex_unlock(&worker->lock);
+		return 1;
+	}
+
+	worker->queue[worker->bottom++ & (JOB_QUEUE - 1)] = job;
+	pthread_mutex_unlock(&worker->lock);
+
+	__atomic_add_fetch(&jobs->pending, 1, __ATOMIC_SEQ_CST);
+
+	// a sleeper checks pending under the lock, taking it here means none misses this
+	if(__atomic_load_n(&jobs->sleeping, __ATOMIC_SEQ_CST) > 0) {
+		pthread_mutex_lock(&jobs->sleep_lock);
+		pthread_cond_broadcast(&jobs->wake);
+		pthread_mutex_unlock(&jobs->sleep_lock);
+	}
+
+	return 0;
+}
+
+hed_job *
+he_jobs_find(hed_worker *worker) {
+
+	hed_jobs *jobs = &engine.jobs;
+	hed_job *job = NULL;
+	u32 count = __atomic_load_n(&jobs->count, __ATOMIC_ACQUIRE);
+
+	// newest own job first, it is the smallest and its data still in cache
+	pthread_mutex_lock(&worker->lock);
+	if(worker->bottom != worker->top) {
+		job = worker->queue[--worker->bottom & (JOB_QUEUE - 1)];
+	}
+	pthread_mutex_unlock(&worker->lock);
+
+	// then the oldest of someone else's, the biggest half they split off
+	for(u32 i = 1; job == NULL && i < count; i++) {
+		hed_worker *victim = &jobs->workers[(worker->index + i) % count];
+
+		pthread_mutex_lock(&victim->lock);
+		if(victim->bottom != victim->top) {
+			job = victim->queue[victim->top++ & (JOB_QUEUE - 1)];
+			worker->stolen++;
+		}
+		pthread_mutex_unlock(&victim->lock);
+	}
+
+	if(job != NULL) {
+		__atomic_sub_fetch(&jobs->pending, 1, __ATOMIC_SEQ_CST);
+	}
+
+	return job;
+}
+
+void
+he_jobs_execute(hed_worker *worker, hed_job *job) {
+
+	hed_job *group = job->group != NULL ? job->group : job;
+	u32 first = job->first, count = job->count;
+
+	// upper halves go on this queue until what is left fits the grain
+	while(count > job->grain) {
+		u32 half = count / 2;
+		hed_job *split = &worker->ring[worker->next++ & (JOB_QUEUE - 1)];
+
+		*split = (hed_job) {
+			.run = job->run,
+			.data = job->data,
+			.first = first + count - half,
+			.count = half,
+			.grain = job->grain,
+			.group = group,
+		};
+
+		// counted before a thief can finish it
+		__atomic_add_fetch(&group->unfinished, 1, __ATOMIC_SEQ_CST);
+
+		if(he_jobs_push(worker, split)) {
+			__atomic_sub_fetch(&group->unfinished, 1, __ATOMIC_SEQ_CST);
+			break;
+		}
+
+		count -= half;
+	}
+
+	job->run(job->data, first, count);
+	he_jobs_finish(worker, group);
+}
+
+void
+he_jobs_finish(hed_worker *worker, hed_job *job) {
+
+	hed_jobs *jobs = &engine.jobs;
+
+	if(__atomic_sub_fetch(&job->unfinished, 1, __ATOMIC_SEQ_CST) > 0) {
+		return;
+	}
+
+	hed_job *dependents[JOB_DEPENDENTS];
+
+	pthread_mutex_lock(&jobs->graph);
+	u8 count = job->dependent_count;
+	(void)memcpy(dependents, job->dependents, count * sizeof(hed_job *));
+	__atomic_store_n(&job->done, true, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&jobs->graph);
+
+	// last dependency out releases the job, on this thread's queue
+	for(u8 i = 0; i < count; i++) {
+		if(__atomic_sub_fetch(&dependents[i]->waiting, 1, __ATOMIC_SEQ_CST) == 0 &&
+		he_jobs_push(worker, dependents[i])) {
+			he_jobs_execute(worker, dependents[i]);
+		}
+	}
+}
+
+void *
+he_jobs_thread(void *arg) {
+
+	hed_worker *worker = arg;
+	hed_jobs *jobs = &engine.jobs;
+	u32 idle = 0;
+
+	while(!__atomic_load_n(&jobs->quit, __ATOMIC_SEQ_CST)) {
+		hed_job *job = he_jobs_find(worker);
+
+		if(job != NULL) {
+			he_jobs_execute(worker, job);
+			idle = 0;
+			continue;
+		}
+
+		// phases come every tick, spin a while before paying for a wake up
+		if(++idle < JOB_SPIN) {
+			(void)sched_yield();
+			continue;
+		}
+
+		pthread_mutex_lock(&jobs->sleep_lock);
+		__atomic_add_fetch(&jobs->sleeping, 1, __ATOMIC_SEQ_CST);
+
+		while(__atomic_load_n(&jobs->pending, __ATOMIC_SEQ_CST) == 0 &&
+		!__atomic_load_n(&jobs->quit, __ATOMIC_SEQ_CST)) {
+			pthread_cond_wait(&jobs->wake, &jobs->sleep_lock);
+		}
+
+		__atomic_sub_fetch(&jobs->sleeping, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&jobs->sleep_lock);
+		idle = 0;
+	}
 
-					continue;
-				}
+	return NULL;
+}
 
-				if(strcmp(tmp, "ENTITY") == 0) {
-					ff;
-					
-					if(strcmp(tmp, "STATIC") == 0) {
-						ff;
-
-						char full_path[U8];
-						(void)snprintf(full_path, sizeof(full_path),
-						"%s%s%s%s%s", engine.config.base, SEP, BASE_MEDIA, SEP, tmp);
-						
-						if(access(full_path, F_OK) == 0) {
-							FILE *fpp = fopen(full_path, "r");
-
-							if(fpp == NULL) {
-								printf("Cannot open %s entity.\n", tmp);
-								return 1;
-							}
-
-							else {
-								engine.current_level->entities[engine.current_level->entities_count] = he_engine_load_model(full_path);
-								engine.current_level->entities_count++;
-							}
-						}
+int
+he_engine_exists_keyword(const hed_token *keyword) {
 
-						else {
-							printf("Cannot access %s entity.\n", tmp);
-							return 1;
-						}
-					}
+	// returns index of keyword if exists, -1 otherwise
+	return he_keywords_find(&Processor_Table, keyword);
+}
 
-					else {
-						printf("Unknown entity type '%s' in level config.\n", tmp);
-						return 1;
-					}
+u8
+he_lex_open(hed_lexer *lex, const char *path) {
 
-					continue;
-				}
+	(void)memset(lex, 0, sizeof(*lex));
+	lex->path = path;
+	lex->line = 1;
 
-				else {
-					printf("Syntax error in resources config, %s unrecognized.\n", tmp);
-					return 1;
-				}
-			}
-		}
+	// baked configs are read straight from the mapped pages
+	const hed_pack_entry *entry = he_pack_find(path, PACK_CONFIG);
+
+	if(entry != NULL) {
+		lex->data = he_pack_at(entry->offset);
+		lex->size = entry->size;
+		return 0;
 	}
 
-	else {
-		printf("Cannot open config file for resources or logic.\n");
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
 		return 1;
 	}
 
-	// parsing logic
-	if( (fp = fopen(logic, "r")) == NULL) {
-		printf("Cannot open logic for current level.\n");
+	struct stat source;
+	if(fstat(fd, &source) != 0) {
+		close(fd);
 		return 1;
 	}
 
-	else {
-		while(ff == 1) {
-			if(strcmp(tmp, "POSITION") == 0) {
+	// empty files map nothing and lex to no tokens
+	if(source.st_size > 0) {
+		void *data = mmap(NULL, source.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-				// get model name
-				ff;
-				
-				// check if model exists in array
-				int counter = he_engine_check_model(tmp);
+		if(data == MAP_FAILED) {
+			close(fd);
+			return 1;
+		}
 
-				if(counter < 0) {
-					printf("Syntax error in level logic, model doesn't exist.\n");
-					return 1;
-				}
+		lex->data = data;
+		lex->size = source.st_size;
+		lex->mapped = true;
+	}
 
-				else {
-					float x,y,z;
-					fscanf(fp, "%f %f %f", &x, &y, &z);
+	close(fd);
+	return 0;
+}
 
-					if(counter == HERO) {
-						he_vec3_modify(engine.current_level->hero.position, x,y,z);
-					}
+void
+he_lex_close(hed_lexer *lex) {
 
-					else if(counter == MAP) {
-						he_vec3_modify(engine.current_level->map.position, x,y,z);
-					}
+	if(lex->mapped) {
+		(void)munmap((void *)lex->data, lex->size);
+	}
 
-					else {
-						he_vec3_modify(engine.current_level->entities[counter-ENTITY].position,
-						x,y,z);
-					}
-				}
+	lex->data = NULL;
+	lex->size = lex->at = 0;
+	lex->mapped = false;
+}
 
-				continue;
-			}
+bool
+he_lex_next(hed_lexer *lex, hed_token *tok) {
 
-			else if(strcmp(tmp, "COLLISION") == 0) {
-				char first_model[U8], second_model[U8];
+	while(lex->at < lex->size) {
+		char c = lex->data[lex->at];
 
-				// getting first model
-				ff;
-				(void)snprintf(first_model, sizeof(first_model),
-				"%s", tmp);
+		if(c == '\n') {
+			lex->line++;
+			lex->line_start = lex->at + 1;
+		}
 
-				// getting second model
-				ff;
-				(void)snprintf(second_model, sizeof(second_model),
-				"%s", tmp);
+		else if(c != ' ' && c != '\t' && c != '\r' && c != '\v' && c != '\f') {
+			break;
+		}
 
-				// checking if not the same, you can never know
-				if(strcmp(first_model, second_model) == 0) {
-					printf("Syntax error, collision detection on same model is not possible.\n");
-					return 1;
-				}
+		lex->at++;
+	}
 
-				// checking if both models are loaded in program
-				int counter = he_engine_check_model(first_model);
-				
-				if(counter < 0) {
-					printf("Error, model named %s doesn't exists", tmp);
-					return 1;
-				}
+	if(lex->at == lex->size) {
+		return false;
+	}
 
-				else {
-					if(counter == HERO) {
-						engine.current_level->col_one[engine.current_level->col_count] =
-						&engine.current_level->hero.transformedBox;
-					}
+	tok->str = lex->data + lex->at;
+	tok->line = lex->line;
+	tok->column = lex->at - lex->line_start + 1;
 
-					else if(counter == MAP) {
-						engine.current_level->col_one[engine.current_level->col_count] =
-						&engine.current_level->map.transformedBox;
-					}
+	while(lex->at < lex->size) {
+		char c = lex->data[lex->at];
 
-					else {
-						engine.current_level->col_one[engine.current_level->col_count] =
-						&engine.current_level->entities[counter-ENTITY].transformedBox;
-					}
-				}
+		if(c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f') {
+			break;
+		}
 
-				counter = he_engine_check_model(second_model);
+		lex->at++;
+	}
 
-				// repeating this crap because i am stupid
-				if(counter < 0) {
-					printf("Error, model named %s doesn't exists", tmp);
-					return 1;
-				}
+	tok->len = lex->data + lex->at - tok->str;
+	return true;
+}
 
-				else {
-					if(counter == HERO) {
-						engine.current_level->col_two[engine.current_level->col_count] =
-						&engine.current_level->hero.transformedBox;
-					}
+bool
+he_lex_inline(hed_lexer *lex, hed_token *tok) {
 
-					else if(counter == MAP) {
-						engine.current_level->col_two[engine.current_level->col_count] =
-						&engine.current_level->map.transformedBox;
-					}
+	// next token only if it is on the current line
+	while(lex->at < lex->size &&
+	(lex->data[lex->at] == ' ' || lex->data[lex->at] == '\t' || lex->data[lex->at] == '\r')) {
+		lex->at++;
+	}
 
-					else {
-						engine.current_level->col_two[engine.current_level->col_count] =
-						&engine.current_level->entities[counter-ENTITY].transformedBox;
-					}
-				}
+	if(lex->at == lex->size || lex->data[lex->at] == '\n') {
+		return false;
+	}
 
-				// getting response to collision
-				ff;
+	return he_lex_next(lex, tok);
+}
 
-				// checking if keyword exists
-				int kword = he_engine_exists_keyword(tmp);
+void
+he_lex_rest(hed_lexer *lex, hed_token *tok) {
 
-				if(kword) {
-					printf("Syntax error, keyword %s doesn't exist.\n", tmp);
-					return 1;
-				}
+	// rest of the line without leading blanks, can be empty
+	while(lex->at < lex->size && (lex->data[lex->at] == ' ' || lex->data[lex->at] == '\t')) {
+		lex->at++;
+	}
 
-				else {
-					// take arguments accordingly for every instruction
-
-					switch(kword) {
-						case PRINT:
-							he_engine_getline(fp, tmp, sizeof(tmp));
-							
-							engine.current_level->col_action_instruction[engine.current_level->col_count] = kword;
-							
-							(void)snprintf(engine.current_level->col_action_arg1[engine.current_level->col_count],
-							sizeof(engine.current_level->col_action_arg1[engine.current_level->col_count]),
-							"%s", tmp);
-						break;
-					}
-				}
-				
-				engine.current_level->col_count++;
-			}
+	tok->str = lex->data + lex->at;
+	tok->line = lex->line;
+	tok->column = lex->at - lex->line_start + 1;
 
-			else {
-				printf("Syntax error, %s is unknown keyword in logic.\n", tmp);
-				return 1;
-			}
+	while(lex->at < lex->size && lex->data[lex->at] != '\n') {
+		lex->at++;
+	}
 
-			
-		}
+	tok->len = lex->data + lex->at - tok->str;
+
+	while(tok->len > 0 && (tok->str[tok->len - 1] == '\r' || tok->str[tok->len - 1] == ' ')) {
+		tok->len--;
 	}
+}
 
-	fclose(fp);
-	return 0;
+u8
+he_lex_expect(hed_lexer *lex, hed_token *tok, const char *what) {
+
+	if(he_lex_next(lex, tok)) {
+		return 0;
+	}
+
+	hed_token end = { .str = "", .line = lex->line, .column = lex->at - lex->line_start + 1 };
+	he_lex_error(lex, &end, "expected %s, file ended", what);
+	return 1;
 }
 
-hed_model
-he_engine_load_model(const char *path) {
+u8
+he_lex_copy(const hed_lexer *lex, const hed_token *tok, char *dst, size_t size) {
 
-	hed_model model = {
-		.animCount = 0,
-		.currentFrame = 0,
-		.currentAnimation = IDLE,
-		.animate = false,
-		.position = (Vector3) { 0.0f, 0.0f, 0.0f },
-		.tint = WHITE,
-		.angle = 0.0f,
-		.scale = (Vector3) { 1.0f, 1.0f, 1.0f },
-		.render = true,
-	};
+	// long names are an error instead of being cut
+	if(tok->len >= size) {
+		he_lex_error(lex, tok, "'%.*s' is longer than %zu characters",
+		(int)tok->len, tok->str, size - 1);
+		return 1;
+	}
+
+	(void)memcpy(dst, tok->str, tok->len);
+	dst[tok->len] = 0;
+	return 0;
+}
 
-	model.model = LoadModel(path);
-	model.animations = LoadModelAnimations(path, &model.animCount);
+u8
+he_lex_int(const hed_lexer *lex, const hed_token *tok, int *out) {
 
-	// check if model actually contains animations, animate
-	if(model.animCount > 0) {
-		model.animate = true;
+	char tmp[U6], *end;
+	if(he_lex_copy(lex, tok, tmp, sizeof(tmp))) {
+		return 1;
 	}
 
-	// if it doesn't contain then ditch animations
-	else {
-		UnloadModelAnimations(model.animations, model.animCount);
+	long value = strtol(tmp, &end, 10);
+
+	if(end == tmp || *end != 0) {
+		he_lex_error(lex, tok, "expected a whole number, got '%s'", tmp);
+		return 1;
 	}
 
-	// getting only model name from path
-	(void)snprintf(model.name, sizeof(model.name),
-	"%s", basename((char *)path));
+	*out = (int)value;
+	return 0;
+}
+
+u8
+he_lex_float(const hed_lexer *lex, const hed_token *tok, float *out) {
 
-	printf("Num of animations for model %s is %d.\n", model.name, model.animCount);
+	char tmp[U6], *end;
+	if(he_lex_copy(lex, tok, tmp, sizeof(tmp))) {
+		return 1;
+	}
 
-	// generating bounding box
-	model.box = GetMeshBoundingBox(model.model.meshes[0]);
+	*out = strtof(tmp, &end);
 
-	for(size_t i = 1; (int)i < model.model.meshCount; i++) {
-		BoundingBox currentBox = GetMeshBoundingBox(model.model.meshes[i]);
-		model.box = he_engine_combine_bbox(model.box, currentBox);
+	if(end == tmp || *end != 0) {
+		he_lex_error(lex, tok, "expected a number, got '%s'", tmp);
+		return 1;
 	}
 
-	return model;
+	return 0;
 }
 
-u8
-he_engine_draw_model(hed_model *model) {
+void
+he_lex_error(const hed_lexer *lex, const hed_token *tok, const char *fmt, ...) {
 
-	if(model->render) {
+	va_list args;
+	va_start(args, fmt);
 
-		if(model->animate) {
-			model->currentFrame++;
+	printf("%s:%u:%u: ", lex->path, tok->line, tok->column);
+	vprintf(fmt, args);
+	printf(".\n");
 
-			if(model->currentFrame == model->animations[model->currentAnimation].frameCount) {
-				model->currentFrame = 1;
-			}
-			
-			UpdateModelAnimation(model->model,
-				model->animations[model->currentAnimation],
-				model->currentFrame);
-		}
-		
-		he_engine_update_tbbox(model);
+	va_end(args);
+}
 
-		DrawModelEx(model->model, model->position, (Vector3){0.0f, 1.0f, 0.0f},
-		model->angle, model->scale, model->tint);
+bool
+he_lex_is(const hed_token *tok, const char *word) {
+	return strncmp(tok->str, word, tok->len) == 0 && word[tok->len] == 0;
+}
 
-		if(engine.debug) {
-			DrawBoundingBox(model->transformedBox, GREEN);
-		}
-	}
+u32
+he_engine_hash(const char *str, u32 len, u32 seed) {
 
-	else {
-		return 0;
+	// fnv-1a, seeded
+	u32 hash = 2166136261u ^ seed;
+
+	for(u32 i = 0; i < len; i++) {
+		hash ^= (u8)str[i];
+		hash *= 16777619u;
 	}
-	
-	return 0;
+
+	return hash ^ (hash >> 15);
 }
 
-int
-he_engine_check_model(const char *name) {
+u32
+he_keywords_slot(const char *str, u32 len, u32 seed) {
+	return he_engine_hash(str, len, seed) & (KEYWORD_SLOTS - 1);
+}
 
-	// returns index of model in current level
-	// 0 = hero
-	// 1 = map
-	// >1 = entity
-	// -1 = doesn't exist
+void
+he_keywords_build(hed_keywords *table) {
 
-	if(strcmp(name, engine.current_level->hero.name) == 0) {
-		return HERO;
-	}
+	// tries seeds until every word gets its own slot, a lookup is then
+	// one hash and one compare. few hundred tries at most for our lists
+	for(u32 seed = 1; ; seed++) {
+		(void)memset(table->slots, 0, sizeof(table->slots));
 
-	else if(strcmp(name, engine.current_level->map.name) == 0) {
-		return MAP;
-	}
+		u8 i;
+		for(i = 0; i < table->count; i++) {
+			u32 slot = he_keywords_slot(table->words[i], strlen(table->words[i]), seed);
 
-	else {
-		for(size_t i = 0; i < engine.current_level->entities_count; i++) {
-			if(strcmp(name, engine.current_level->entities[i].name) == 0) {
-				return i + ENTITY;
+			if(table->slots[slot] != 0) {
+				break;
 			}
+
+			table->slots[slot] = i + 1;
 		}
-	}
 
-	return -1;
+		if(i == table->count) {
+			table->seed = seed;
+			return;
+		}
+	}
 }
 
-u8
-he_engine_switch_animation(hed_model *model, int animation) {
+int
+he_keywords_find(const hed_keywords *table, const hed_token *tok) {
 
-	if(animation > model->animCount) {
-		printf("Model animation error, animation number greater than number of animations.\n");
-		printf("Model %s anims: %d, Called anim num: %d\n", model->name, model->animCount, animation);
-		return 1;
-	}
+	u8 slot = table->slots[he_keywords_slot(tok->str, tok->len, table->seed)];
 
-	else {
-		model->currentAnimation = animation;
+	if(slot == 0 || !he_lex_is(tok, table->words[slot - 1])) {
+		return -1;
 	}
 
-	return 0;
+	return slot - 1;
 }
 
-BoundingBox
-he_engine_combine_bbox(BoundingBox box1, BoundingBox box2) {
-	BoundingBox combined;
-
-	combined.min.x = fmin(box1.min.x, box2.min.x);
-	combined.min.y = fmin(box1.min.y, box2.min.y);
-	combined.min.z = fmin(box1.min.z, box2.min.z);
-	combined.max.x = fmax(box1.max.x, box2.max.x);
-	combined.max.y = fmax(box1.max.y, box2.max.y);
-	combined.max.z = fmax(box1.max.z, box2.max.z);
+const char *
+he_json_ws(const char *p, const char *end) {
+	while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+		p++;
+	}
 
-	return combined;
+	return p;
 }
 
-void
-he_engine_update_tbbox(hed_model *model) {
-	model->transformedBox.min = Vector3Add(model->box.min, model->position);
-	model->transformedBox.max = Vector3Add(model->box.max, model->position);
-}
+const char *
+he_json_skip(const char *p, const char *end) {
 
-u8
-he_engine_load_game(const char *file) {
+	// skips one value of any kind, returns what follows it
+	p = he_json_ws(p, end);
+	if(p >= end) {
+		return end;
+	}
 
-	FILE *fp = NULL;
+	if(*p == '"') {
+		for(p++; p < end && *p != '"'; p++) {
+			if(*p == '\\') {
+				p++;
+			}
+		}
 
-	if(access(file, F_OK) == 0) {
+		return p < end ? p + 1 : end;
+	}
 
-		fp = fopen(file, "r");
-		if(fp == NULL) {
-			printf("Failed to open file.");
-			return 1;
-		}
+	if(*p == '{' || *p == '[') {
+		int depth = 0;
 
-		else {
-			char tmp[U8];
-			while(fscanf(fp, "%60s", tmp) == 1) {
-				if(strcmp(tmp, "LEVEL") == 0) {
-					fscanf(fp, "%60s", tmp);
-					if(atoi(tmp) == 0) {
-						printf("Loading saved file failed.\n");
-						return 1;
-					}
+		for(; p < end; p++) {
+			if(*p == '"') {
+				p = he_json_skip(p, end) - 1;
+			}
 
-					else {
-						//engine.current_level = &engine.levels[atoi(tmp)];
-					}
-				}
+			else if(*p == '{' || *p == '[') {
+				depth++;
+			}
 
-				else {
-					printf("Syntax error while reading save file.");
-					return 1;
+			else if(*p == '}' || *p == ']') {
+				if(--depth == 0) {
+					return p + 1;
 				}
 			}
 		}
-	}
 
-	else {
-		printf("Cannot not open file '%s'\n", file);
-		return 1;
+		return end;
 	}
 
-	fclose(fp);
-	return 0;
-}
+	// numbers, true, false, null
+	while(p < end && *p != ',' && *p != '}' && *p != ']' &&
+	*p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+		p++;
+	}
 
-u8
-he_engine_save_game(const char *file) {
-	printf("%s\n", file);
-	return 0;
+	return p;
 }
 
-void
-he_processor(int count, ...) {
+const char *
+he_json_enter(const char *p, const char *end) {
 
-	va_list args;
-	va_start(args, count);
+	// first element of array or first member of object, NULL if empty
+	if(p == NULL) {
+		return NULL;
+	}
 
-	switch(va_arg(args, int)) {
-		case PRINT:
-			printf("%s\n", va_arg(args, const char *));
-		break;
+	p = he_json_ws(p, end);
+	if(p >= end || (*p != '[' && *p != '{')) {
+		return NULL;
 	}
 
-	va_end(args);
-}
+	p = he_json_ws(p + 1, end);
+	if(p >= end || *p == ']' || *p == '}') {
+		return NULL;
+	}
 
-void
-he_engine_die(void) {
-	return;
+	return p;
 }
 
-void
-he_engine_cleanup_level(void) {
+const char *
+he_json_next(const char *p, const char *end) {
 
-	UnloadModel(engine.current_level->hero.model);
-	UnloadModel(engine.current_level->map.model);
+	// object members are "key": value, skip both
+	p = he_json_skip(p, end);
+	p = he_json_ws(p, end);
 
-	for(int i = 0; i < engine.current_level->entities_count; i++) {
-		UnloadModel(engine.current_level->entities[i].model);
+	if(p < end && *p == ':') {
+		p = he_json_skip(p + 1, end);
+		p = he_json_ws(p, end);
 	}
 
-	engine.current_level = NULL;
+	if(p >= end || *p != ',') {
+		return NULL;
+	}
 
-	return;
+	return he_json_ws(p + 1, end);
 }
 
-void
-he_engine_getline(FILE *fp, char *dst, size_t size) {
+const char *
+he_json_key(const char *p, const char *end, const char *key) {
 
-	(void)memset(dst, 0, size);
-	
-	u16 i = 0;
-	char c = 0;
-	u8 skip = 0;
-	
-	while(i != size) {
-		fscanf(fp, "%c", &c);
+	// value of member key in object p, NULL if missing
+	size_t len = strlen(key);
 
-		// skip first whitespace
-		if(skip == 0) {
-			skip++;
-			continue;
-		}
-		
-		if(c == 0x0A) {
-			break;
-		}
-		
-		else {
-			dst[i] = c;
+	for(p = he_json_enter(p, end); p != NULL; p = he_json_next(p, end)) {
+		if(*p == '"' && p + len + 1 < end && strncmp(p + 1, key, len) == 0 && p[len + 1] == '"') {
+			const char *value = he_json_ws(p + len + 2, end);
+
+			if(value < end && *value == ':') {
+				return he_json_ws(value + 1, end);
+			}
 		}
-		
-		i++;
 	}
 
-	return;
+	return NULL;
 }
 
-u8
-he_engine_exists_keyword(const char *keyword) {
+const char *
+he_json_index(const char *p, const char *end, int index) {
 
-	// returns index of keyword if exists
-	for(size_t i = 0; i < NUM_PROCESSOR_KEYWORDS; i++) {
-		if(strcmp(keyword, Processor_Keywords[i][0]) == 0) {
-			return i;
-		}
+	if(index < 0) {
+		return NULL;
 	}
 
-	return 1;
+	for(p = he_json_enter(p, end); p != NULL && index > 0; index--) {
+		p = he_json_next(p, end);
+	}
+
+	return p;
+}
+
+int
+he_json_floats(const char *p, const char *end, float *out, int most) {
+
+	// numbers of array p, how many were read
+	int count = 0;
+
+	for(p = he_json_enter(p, end); p != NULL && count < most; p = he_json_next(p, end)) {
+		out[count++] = strtof(p, NULL);
+	}
+
+	return count;
 }
 
 #endif // HAMMER_ENGINE_IMPLEMENTATION end